@@ -751,6 +751,11 @@ int crowd_main(int argc, char * argv[])
     auto verticesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("vertices", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 64 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // allocate 80 MB memory for 24 compressed textures and for font textures
     auto texturesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("textures", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 80 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    // register allocators in viewer, so that memory statistics may be collected
+    viewer->registerDeviceMemoryAllocator(buffersAllocator);
+    viewer->registerDeviceMemoryAllocator(localBuffersAllocator);
+    viewer->registerDeviceMemoryAllocator(verticesAllocator);
+    viewer->registerDeviceMemoryAllocator(texturesAllocator);
     // create common descriptor pool
     std::shared_ptr<pumex::DescriptorPool> descriptorPool = std::make_shared<pumex::DescriptorPool>();
 
@@ -21,6 +21,7 @@
 //
 
 #include <iomanip>
+#include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <args.hxx>
@@ -224,6 +225,8 @@ int deferred_main( int argc, char * argv[] )
   args::ValueFlag<uint32_t>                         updatesPerSecond(parser, "update_frequency", "number of update calls per second", { 'u' }, 60);
   args::Flag                                        skipDepthPrepass(parser, "nodp", "skip depth prepass", { 'n' });
   args::MapFlag<std::string, uint32_t>              samplesPerPixel(parser, "samples", "samples per pixel (1,2,4,8)", { 's' }, availableSamplesPerPixel, DEFAULT_SAMPLES_PER_PIXEL);
+  args::ValueFlag<uint32_t>                         textureBudget(parser, "texture_budget", "texture memory budget in MB ( enables texture residency manager )", { 'b' }, 0);
+  args::ValueFlag<std::string>                      exportGraph(parser, "export_graph", "after rendering write compiled render graph to <export_graph>.dot and <export_graph>.json", { 'g' }, "");
   try
   {
     parser.ParseCLI(argc, argv);
@@ -251,6 +254,7 @@ int deferred_main( int argc, char * argv[] )
   VkPresentModeKHR presentMode = args::get(presentationMode);
   uint32_t updateFrequency     = std::max(1U, args::get(updatesPerSecond));
   uint32_t sampleCount         = args::get(samplesPerPixel);
+  VkDeviceSize textureBudgetMB = args::get(textureBudget);
 
   LOG_INFO << "Deferred rendering with physically based rendering and antialiasing : ";
   if (enableDebugging)
@@ -362,6 +366,10 @@ int deferred_main( int argc, char * argv[] )
     std::shared_ptr<pumex::DeviceMemoryAllocator> verticesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("vertices", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 64 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // allocate 80 MB memory for textures
     std::shared_ptr<pumex::DeviceMemoryAllocator> texturesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("textures", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 80 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    // register allocators in viewer, so that memory statistics may be collected
+    viewer->registerDeviceMemoryAllocator(buffersAllocator);
+    viewer->registerDeviceMemoryAllocator(verticesAllocator);
+    viewer->registerDeviceMemoryAllocator(texturesAllocator);
     // create common descriptor pool
     std::shared_ptr<pumex::DescriptorPool> descriptorPool = std::make_shared<pumex::DescriptorPool>();
 
@@ -380,6 +388,13 @@ int deferred_main( int argc, char * argv[] )
     textureRegistry->setSampledImage(1);
     textureRegistry->setSampledImage(2);
     textureRegistry->setSampledImage(3);
+    std::shared_ptr<pumex::TextureResidencyManager> residencyManager;
+    if (textureBudgetMB > 0)
+    {
+      residencyManager = std::make_shared<pumex::TextureResidencyManager>(texturesAllocator, textureBudgetMB * 1024 * 1024);
+      textureRegistry->setResidencyManager(residencyManager);
+      viewer->addTextureResidencyManager(residencyManager);
+    }
     std::shared_ptr<pumex::MaterialRegistry<MaterialData>> materialRegistry = std::make_shared<pumex::MaterialRegistry<MaterialData>>(buffersAllocator);
     std::shared_ptr<pumex::MaterialSet> materialSet = std::make_shared<pumex::MaterialSet>(viewer, materialRegistry, textureRegistry, buffersAllocator, textureSemantic);
 
@@ -615,6 +630,9 @@ int deferred_main( int argc, char * argv[] )
     tbb::flow::continue_node< tbb::flow::continue_msg > update(viewer->updateGraph, [=](tbb::flow::continue_msg)
     {
       applicationData->update(viewer);
+      // sponza is always visible, so all its textures are reported as used
+      if (residencyManager != nullptr)
+        materialSet->reportMaterialTypeUsage(MODEL_SPONZA_ID, viewer->getFrameNumber());
     });
     tbb::flow::make_edge(viewer->opStartUpdateGraph, update);
     tbb::flow::make_edge(update, viewer->opEndUpdateGraph);
@@ -625,6 +643,19 @@ int deferred_main( int argc, char * argv[] )
     surface->setEventSurfacePrepareStatistics(std::bind(&pumex::TimeStatisticsHandler::collectData, tsHandler, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 
     viewer->run();
+
+    // export is done after rendering, because memory statistics are known only after images were created for the surface
+    if (!args::get(exportGraph).empty())
+    {
+      auto executable = viewer->getRenderGraphExecutable(renderGraph->name);
+      if (executable != nullptr)
+      {
+        std::ofstream dotFile(args::get(exportGraph) + ".dot");
+        executable->exportGraphviz(*renderGraph, dotFile);
+        std::ofstream jsonFile(args::get(exportGraph) + ".json");
+        executable->exportJSON(*renderGraph, surface->getID(), jsonFile);
+      }
+    }
   }
   catch (const std::exception& e)
   {
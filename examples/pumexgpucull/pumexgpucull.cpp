@@ -1368,6 +1368,10 @@ int gpucull_main(int argc, char * argv[])
     std::shared_ptr<pumex::DeviceMemoryAllocator> verticesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("vertices", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 32 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // allocate 4 MB memory for font textures
     std::shared_ptr<pumex::DeviceMemoryAllocator> texturesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("textures", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 4 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    // register allocators in viewer, so that memory statistics may be collected
+    viewer->registerDeviceMemoryAllocator(buffersAllocator);
+    viewer->registerDeviceMemoryAllocator(verticesAllocator);
+    viewer->registerDeviceMemoryAllocator(texturesAllocator);
     // create common descriptor pool
     std::shared_ptr<pumex::DescriptorPool> descriptorPool = std::make_shared<pumex::DescriptorPool>();
 
@@ -1385,6 +1389,7 @@ int gpucull_main(int argc, char * argv[])
     pumex::ResourceDefinition indirectIndex("indirectIndex");
     pumex::ResourceDefinition indirectResults("indirectResults");
     pumex::ResourceDefinition indirectDraw("indirectDraw");
+    pumex::ResourceDefinition indirectDrawCount("indirectDrawCount");
 
     pumex::RenderOperation rendering("rendering", pumex::opGraphics, fullScreenSize);
       rendering.setAttachmentDepthOutput("depth",          depthSamples,        pumex::loadOpClear(glm::vec2(1.0f, 0.0f)));
@@ -1397,12 +1402,16 @@ int gpucull_main(int argc, char * argv[])
         staticFilter.addBufferOutput("static_indirect_index",   indirectIndex,   pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
         staticFilter.addBufferOutput("static_indirect_results", indirectResults, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
         staticFilter.addBufferOutput("static_indirect_draw",    indirectDraw,    pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        staticFilter.addBufferOutput("static_indirect_compacted_draw", indirectDraw,      pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        staticFilter.addBufferOutput("static_indirect_draw_count",     indirectDrawCount, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
       renderGraph->addRenderOperation(staticFilter);
 
       rendering.addBufferInput("static_indirect_counter", indirectCounter, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
       rendering.addBufferInput("static_indirect_index",   indirectIndex,   pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
       rendering.addBufferInput("static_indirect_results", indirectResults, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
       rendering.addBufferInput("static_indirect_draw",    indirectDraw,    pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+      rendering.addBufferInput("static_indirect_compacted_draw", indirectDraw,      pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+      rendering.addBufferInput("static_indirect_draw_count",     indirectDrawCount, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
     }
 
     if (showDynamicRendering)
@@ -1410,10 +1419,14 @@ int gpucull_main(int argc, char * argv[])
       pumex::RenderOperation dynamicFilter("dynamic_filter", pumex::opCompute);
         dynamicFilter.addBufferOutput("dynamic_indirect_results", indirectResults, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
         dynamicFilter.addBufferOutput("dynamic_indirect_draw",    indirectDraw,    pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        dynamicFilter.addBufferOutput("dynamic_indirect_compacted_draw", indirectDraw,      pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        dynamicFilter.addBufferOutput("dynamic_indirect_draw_count",     indirectDrawCount, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
       renderGraph->addRenderOperation(dynamicFilter);
 
       rendering.addBufferInput( "dynamic_indirect_results", indirectResults,  pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
       rendering.addBufferInput( "dynamic_indirect_draw",    indirectDraw,     pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+      rendering.addBufferInput( "dynamic_indirect_compacted_draw", indirectDraw,      pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+      rendering.addBufferInput( "dynamic_indirect_draw_count",     indirectDrawCount, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,  VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
     }
     renderGraph->addRenderOperation(rendering);
 
@@ -1423,11 +1436,15 @@ int gpucull_main(int argc, char * argv[])
       renderGraph->addResourceTransition("static_filter", "static_indirect_index",   "rendering", "static_indirect_index",   0, "static_indirect_index_buffer");
       renderGraph->addResourceTransition("static_filter", "static_indirect_results", "rendering", "static_indirect_results", 0, "static_indirect_results_buffer");
       renderGraph->addResourceTransition("static_filter", "static_indirect_draw",    "rendering", "static_indirect_draw",    0, "static_indirect_draw_buffer");
+      renderGraph->addResourceTransition("static_filter", "static_indirect_compacted_draw", "rendering", "static_indirect_compacted_draw", 0, "static_indirect_compacted_draw_buffer");
+      renderGraph->addResourceTransition("static_filter", "static_indirect_draw_count",     "rendering", "static_indirect_draw_count",     0, "static_indirect_draw_count_buffer");
     }
     if (showDynamicRendering)
     {
       renderGraph->addResourceTransition("dynamic_filter", "dynamic_indirect_results", "rendering", "dynamic_indirect_results", 0, "dynamic_indirect_results_buffer");
       renderGraph->addResourceTransition("dynamic_filter", "dynamic_indirect_draw",    "rendering", "dynamic_indirect_draw",    0, "dynamic_indirect_draw_buffer");
+      renderGraph->addResourceTransition("dynamic_filter", "dynamic_indirect_compacted_draw", "rendering", "dynamic_indirect_compacted_draw", 0, "dynamic_indirect_compacted_draw_buffer");
+      renderGraph->addResourceTransition("dynamic_filter", "dynamic_indirect_draw_count",     "rendering", "dynamic_indirect_draw_count",     0, "dynamic_indirect_draw_count_buffer");
     }
 
     std::shared_ptr<GpuCullApplicationData> applicationData = std::make_shared<GpuCullApplicationData>(buffersAllocator);
@@ -1453,6 +1470,12 @@ int gpucull_main(int argc, char * argv[])
 
     auto cameraUbo = std::make_shared<pumex::UniformBuffer>(applicationData->cameraBuffer);
 
+    // compaction of draw commands lets the GPU skip empty draws when VK_KHR_draw_indirect_count is available
+    auto compactionDescriptorSetLayout = pumex::AssetBufferCompactionNode::createDescriptorSetLayout();
+    auto compactionPipelineLayout      = std::make_shared<pumex::PipelineLayout>();
+    compactionPipelineLayout->descriptorSetLayouts.push_back(compactionDescriptorSetLayout);
+    auto compactionShaderModule        = std::make_shared<pumex::ShaderModule>(viewer, "shaders/compact_draw_commands.comp.spv");
+
     if (showStaticRendering)
     {
       std::vector<pumex::DescriptorSetLayoutBinding> staticFilterLayoutBindings0 =
@@ -1503,7 +1526,7 @@ int gpucull_main(int argc, char * argv[])
       auto staticResultsSbo = std::make_shared<pumex::StorageBuffer>(staticResultsBuffer);
       viewer->getExternalMemoryObjects()->addMemoryObject("static_indirect_results_buffer", indirectResults, staticResultsBuffer);
 
-      auto staticAssetBufferFilterNode = std::make_shared<pumex::AssetBufferFilterNode>(staticAssetBuffer, buffersAllocator);
+      auto staticAssetBufferFilterNode = std::make_shared<pumex::AssetBufferFilterNode>(staticAssetBuffer, buffersAllocator, true);
       staticAssetBufferFilterNode->setEventResizeOutputs(std::bind(resizeStaticOutputBuffers, staticResultsBuffer, staticResultsIndexBuffer, std::placeholders::_1, std::placeholders::_2));
       staticAssetBufferFilterNode->setName("staticAssetBufferFilterNode");
       viewer->getExternalMemoryObjects()->addMemoryObject("static_indirect_draw_buffer", indirectDraw, staticAssetBufferFilterNode->getDrawIndexedIndirectBuffer(MAIN_RENDER_MASK));
@@ -1525,6 +1548,18 @@ int gpucull_main(int argc, char * argv[])
       staticFilterDescriptorSet0->setDescriptor(6, staticCounterSbo);
       instanceTree->setDescriptorSet(0, staticFilterDescriptorSet0);
 
+      auto staticCompactionPipeline = std::make_shared<pumex::ComputePipeline>(pipelineCache, compactionPipelineLayout);
+      staticCompactionPipeline->setName("staticCompactionPipeline");
+      staticCompactionPipeline->shaderStage = { VK_SHADER_STAGE_COMPUTE_BIT, compactionShaderModule, "main" };
+      staticFilterRoot->addChild(staticCompactionPipeline);
+
+      auto staticCompactionNode = std::make_shared<pumex::AssetBufferCompactionNode>(staticAssetBufferFilterNode, MAIN_RENDER_MASK);
+      staticCompactionNode->setName("staticCompactionNode");
+      staticCompactionNode->setDescriptorSet(0, staticCompactionNode->createDescriptorSet(descriptorPool, compactionDescriptorSetLayout));
+      staticCompactionPipeline->addChild(staticCompactionNode);
+      viewer->getExternalMemoryObjects()->addMemoryObject("static_indirect_compacted_draw_buffer", indirectDraw,      staticAssetBufferFilterNode->getCompactedDrawIndexedIndirectBuffer(MAIN_RENDER_MASK));
+      viewer->getExternalMemoryObjects()->addMemoryObject("static_indirect_draw_count_buffer",     indirectDrawCount, staticAssetBufferFilterNode->getDrawCountBuffer(MAIN_RENDER_MASK));
+
       // setup static rendering
       std::vector<pumex::DescriptorSetLayoutBinding> staticRenderLayoutBindings =
       {
@@ -1607,7 +1642,7 @@ int gpucull_main(int argc, char * argv[])
       auto dynamicResultsSbo = std::make_shared<pumex::StorageBuffer>(dynamicResultsBuffer);
       viewer->getExternalMemoryObjects()->addMemoryObject("dynamic_indirect_results_buffer", indirectResults, dynamicResultsBuffer);
 
-      auto dynamicAssetBufferFilterNode = std::make_shared<pumex::AssetBufferFilterNode>(dynamicAssetBuffer, buffersAllocator);
+      auto dynamicAssetBufferFilterNode = std::make_shared<pumex::AssetBufferFilterNode>(dynamicAssetBuffer, buffersAllocator, true);
       dynamicAssetBufferFilterNode->setName("dynamicAssetBufferFilterNode");
       dynamicFilterPipeline->addChild(dynamicAssetBufferFilterNode);
       viewer->getExternalMemoryObjects()->addMemoryObject("dynamic_indirect_draw_buffer", indirectDraw, dynamicAssetBufferFilterNode->getDrawIndexedIndirectBuffer(MAIN_RENDER_MASK));
@@ -1628,6 +1663,18 @@ int gpucull_main(int argc, char * argv[])
       dynamicFilterDescriptorSet->setDescriptor(5, dynamicResultsSbo);
       dynamicDispatchNode->setDescriptorSet(0, dynamicFilterDescriptorSet);
 
+      auto dynamicCompactionPipeline = std::make_shared<pumex::ComputePipeline>(pipelineCache, compactionPipelineLayout);
+      dynamicCompactionPipeline->setName("dynamicCompactionPipeline");
+      dynamicCompactionPipeline->shaderStage = { VK_SHADER_STAGE_COMPUTE_BIT, compactionShaderModule, "main" };
+      dynamicFilterRoot->addChild(dynamicCompactionPipeline);
+
+      auto dynamicCompactionNode = std::make_shared<pumex::AssetBufferCompactionNode>(dynamicAssetBufferFilterNode, MAIN_RENDER_MASK);
+      dynamicCompactionNode->setName("dynamicCompactionNode");
+      dynamicCompactionNode->setDescriptorSet(0, dynamicCompactionNode->createDescriptorSet(descriptorPool, compactionDescriptorSetLayout));
+      dynamicCompactionPipeline->addChild(dynamicCompactionNode);
+      viewer->getExternalMemoryObjects()->addMemoryObject("dynamic_indirect_compacted_draw_buffer", indirectDraw,      dynamicAssetBufferFilterNode->getCompactedDrawIndexedIndirectBuffer(MAIN_RENDER_MASK));
+      viewer->getExternalMemoryObjects()->addMemoryObject("dynamic_indirect_draw_count_buffer",     indirectDrawCount, dynamicAssetBufferFilterNode->getDrawCountBuffer(MAIN_RENDER_MASK));
+
       std::vector<pumex::DescriptorSetLayoutBinding> dynamicRenderLayoutBindings =
       {
         { 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
@@ -0,0 +1,247 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <random>
+#include <iomanip>
+#include <pumex/Pumex.h>
+#include <args.hxx>
+
+// This example measures how render graph compiler scales with the size of the render graph.
+// Synthetic render graphs are randomly generated directed acyclic graphs consisting of graphics, compute and transfer operations
+// connected with attachments, images and buffers. Compilation does not create any Vulkan objects, so no device is required.
+
+struct GeneratedOutput
+{
+  std::string                                  operationName;
+  std::string                                  entryName;
+  pumex::ResourceDefinition                    resourceDefinition;
+  pumex::OperationEntryType                    entryType;
+  std::vector<pumex::ResourceTransitionEntry>  consumers;
+};
+
+std::shared_ptr<pumex::RenderGraph> generateRenderGraph(uint32_t operationCount, uint32_t seed)
+{
+  std::mt19937                            generator(seed);
+  std::uniform_real_distribution<float>   typeDistribution(0.0f, 1.0f);
+  std::uniform_int_distribution<uint32_t> inputCountDistribution(1, 3);
+  const uint32_t                          window = 8; // operation may only read outputs of recently generated operations
+
+  pumex::ImageSize          fullScreenSize{ pumex::isSurfaceDependent, glm::vec2(1.0f,1.0f) };
+  pumex::ResourceDefinition color(VK_FORMAT_R8G8B8A8_UNORM, fullScreenSize, pumex::atColor);
+  pumex::ResourceDefinition storage(VK_FORMAT_R32G32B32A32_SFLOAT, fullScreenSize, pumex::atColor);
+
+  auto renderGraph = std::make_shared<pumex::RenderGraph>("benchmark_" + std::to_string(operationCount));
+  std::vector<GeneratedOutput> outputs;
+  for (uint32_t i = 0; i < operationCount; ++i)
+  {
+    std::string opName = "op" + std::to_string(i);
+    float typeChoice   = typeDistribution(generator);
+    pumex::OperationType opType = (typeChoice < 0.6f) ? pumex::opGraphics : (typeChoice < 0.85f) ? pumex::opCompute : pumex::opTransfer;
+    pumex::RenderOperation operation(opName, opType, fullScreenSize);
+
+    // read outputs of a few recent operations
+    if (!outputs.empty())
+    {
+      uint32_t firstCandidate = (outputs.size() > window) ? outputs.size() - window : 0;
+      std::uniform_int_distribution<uint32_t> inputDistribution(firstCandidate, outputs.size() - 1);
+      std::set<uint32_t> chosenInputs;
+      for (uint32_t j = inputCountDistribution(generator); j > 0; --j)
+        chosenInputs.insert(inputDistribution(generator));
+      for (auto inputIndex : chosenInputs)
+      {
+        auto& output = outputs[inputIndex];
+        std::string entryName = "in" + std::to_string(inputIndex);
+        switch (output.entryType)
+        {
+        case pumex::opeAttachmentOutput:
+          if (opType == pumex::opGraphics)
+            operation.addAttachmentInput(entryName, output.resourceDefinition, pumex::loadOpLoad());
+          else
+            operation.addImageInput(entryName, output.resourceDefinition, pumex::loadOpDontCare(), pumex::ImageSubresourceRange(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT);
+          break;
+        case pumex::opeImageOutput:
+          operation.addImageInput(entryName, output.resourceDefinition, pumex::loadOpDontCare(), pumex::ImageSubresourceRange(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT);
+          break;
+        case pumex::opeBufferOutput:
+          operation.addBufferInput(entryName, output.resourceDefinition, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_SHADER_READ_BIT);
+          break;
+        default:
+          break;
+        }
+        output.consumers.push_back({ opName, entryName });
+      }
+    }
+
+    // each operation generates exactly one output
+    GeneratedOutput output;
+    output.operationName = opName;
+    switch (opType)
+    {
+    case pumex::opGraphics:
+      output.entryName          = "color";
+      output.resourceDefinition = color;
+      output.entryType          = pumex::opeAttachmentOutput;
+      operation.addAttachmentOutput(output.entryName, output.resourceDefinition, pumex::loadOpClear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+      break;
+    case pumex::opCompute:
+      if (typeDistribution(generator) < 0.5f)
+      {
+        output.entryName          = "image";
+        output.resourceDefinition = storage;
+        output.entryType          = pumex::opeImageOutput;
+        operation.addImageOutput(output.entryName, output.resourceDefinition, pumex::loadOpDontCare(), pumex::ImageSubresourceRange(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT);
+        break;
+      }
+      // otherwise compute operation generates a buffer
+    case pumex::opTransfer:
+      output.entryName          = "buffer";
+      output.resourceDefinition = pumex::ResourceDefinition("buffer" + std::to_string(i));
+      output.entryType          = pumex::opeBufferOutput;
+      operation.addBufferOutput(output.entryName, output.resourceDefinition, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+      break;
+    default:
+      break;
+    }
+    outputs.push_back(output);
+    renderGraph->addRenderOperation(operation);
+  }
+
+  // final operation reads all outputs that are not used by anyone else and writes to swapchain, so that nothing gets culled
+  pumex::RenderOperation present("present", pumex::opGraphics, fullScreenSize);
+  for (uint32_t i = 0; i < outputs.size(); ++i)
+  {
+    auto& output = outputs[i];
+    if (!output.consumers.empty())
+      continue;
+    std::string entryName = "in" + std::to_string(i);
+    switch (output.entryType)
+    {
+    case pumex::opeAttachmentOutput:
+      present.addAttachmentInput(entryName, output.resourceDefinition, pumex::loadOpLoad());
+      break;
+    case pumex::opeImageOutput:
+      present.addImageInput(entryName, output.resourceDefinition, pumex::loadOpDontCare(), pumex::ImageSubresourceRange(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT);
+      break;
+    case pumex::opeBufferOutput:
+      present.addBufferInput(entryName, output.resourceDefinition, pumex::BufferSubresourceRange(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_SHADER_READ_BIT);
+      break;
+    default:
+      break;
+    }
+    output.consumers.push_back({ present.name, entryName });
+  }
+  present.addAttachmentOutput(pumex::SWAPCHAIN_NAME, pumex::SWAPCHAIN_DEFINITION(VK_FORMAT_B8G8R8A8_UNORM, 1), pumex::loadOpClear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+  renderGraph->addRenderOperation(present);
+
+  for (const auto& output : outputs)
+    renderGraph->addResourceTransition({ output.operationName, output.entryName }, output.consumers);
+  renderGraph->addMissingResourceTransitions();
+  return renderGraph;
+}
+
+int main( int argc, char * argv[] )
+{
+  SET_LOG_WARNING;
+
+  args::ArgumentParser      parser("pumex example : render graph compiler benchmark");
+  args::HelpFlag            help(parser, "help", "display this help menu", { 'h', "help" });
+  args::ValueFlag<uint32_t> maxOperations(parser, "max_operations", "maximum number of operations in generated render graph", { 'n' }, 400);
+  args::ValueFlag<uint32_t> repetitions(parser, "repetitions", "number of compilations for each render graph", { 'r' }, 5);
+  args::ValueFlag<uint32_t> randomSeed(parser, "seed", "seed used to generate render graphs", { 's' }, 1);
+  args::Flag                useComputeQueue(parser, "compute_queue", "schedule operations on graphics and compute queue", { 'c' });
+  try
+  {
+    parser.ParseCLI(argc, argv);
+  }
+  catch (const args::Help&)
+  {
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 0;
+  }
+  catch (const args::ParseError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+  catch (const args::ValidationError& e)
+  {
+    LOG_ERROR << e.what() << std::endl;
+    LOG_ERROR << parser;
+    FLUSH_LOG;
+    return 1;
+  }
+  uint32_t operationLimit  = std::max(1U, args::get(maxOperations));
+  uint32_t repetitionCount = std::max(1U, args::get(repetitions));
+  uint32_t seed            = args::get(randomSeed);
+
+  std::vector<pumex::QueueTraits> queueTraits{ { VK_QUEUE_GRAPHICS_BIT, 0, 0.75f, pumex::qaShared } };
+  if (useComputeQueue)
+    queueTraits.push_back({ VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT, 0.75f, pumex::qaExclusive });
+
+  try
+  {
+    std::shared_ptr<pumex::DeviceMemoryAllocator> frameBufferAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("frameBuffer", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 512 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    pumex::ExternalMemoryObjects externalMemoryObjects;
+    pumex::DefaultRenderGraphCompiler compiler;
+
+    for (uint32_t operationCount = std::min(25U, operationLimit); ; operationCount = std::min(2 * operationCount, operationLimit))
+    {
+      auto buildStart  = pumex::HPClock::now();
+      auto renderGraph = generateRenderGraph(operationCount, seed);
+      double buildTime = 1000.0 * pumex::inSeconds(pumex::HPClock::now() - buildStart);
+
+      std::vector<std::pair<std::string, double>> stageTimes;
+      double totalTime = 0.0;
+      for (uint32_t r = 0; r < repetitionCount; ++r)
+      {
+        auto compileStart = pumex::HPClock::now();
+        auto executable   = compiler.compile(*renderGraph, externalMemoryObjects, queueTraits, frameBufferAllocator);
+        totalTime        += 1000.0 * pumex::inSeconds(pumex::HPClock::now() - compileStart);
+        const auto& times = compiler.getStageTimes();
+        if (stageTimes.empty())
+          stageTimes.resize(times.size());
+        for (uint32_t i = 0; i < times.size(); ++i)
+        {
+          stageTimes[i].first   = times[i].first;
+          stageTimes[i].second += times[i].second;
+        }
+      }
+
+      std::cout << "Operations : " << renderGraph->getOperations().size() << ", transitions : " << renderGraph->getTransitions().size() << ", graph construction : " << std::fixed << std::setprecision(3) << buildTime << " ms\n";
+      for (const auto& stage : stageTimes)
+        std::cout << "  " << std::left << std::setw(36) << stage.first << std::right << std::setw(12) << stage.second / repetitionCount << " ms\n";
+      std::cout << "  " << std::left << std::setw(36) << "compile" << std::right << std::setw(12) << totalTime / repetitionCount << " ms\n" << std::endl;
+
+      if (operationCount >= operationLimit)
+        break;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    LOG_ERROR << "Exception thrown : " << e.what() << std::endl;
+  }
+  FLUSH_LOG;
+  return 0;
+}
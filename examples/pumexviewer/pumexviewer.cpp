@@ -62,7 +62,8 @@ struct ViewerApplicationData
   ViewerApplicationData( std::shared_ptr<pumex::DeviceMemoryAllocator> buffersAllocator )
   {
     // create buffers visible from renderer
-    cameraBuffer     = std::make_shared<pumex::Buffer<pumex::Camera>>(buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pumex::pbPerSurface, pumex::swOnce, true);
+    // camera of each surface is stored in its own slot of a single buffer and chosen with dynamic offset
+    cameraBuffer     = std::make_shared<pumex::DynamicBuffer<pumex::Camera>>(buffersAllocator);
     textCameraBuffer = std::make_shared<pumex::Buffer<pumex::Camera>>(buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pumex::pbPerSurface, pumex::swOnce, true);
     positionData     = std::make_shared<PositionData>();
     positionBuffer   = std::make_shared<pumex::Buffer<PositionData>>(positionData, buffersAllocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, pumex::pbPerDevice, pumex::swOnce);
@@ -139,13 +140,38 @@ struct ViewerApplicationData
     positionBuffer->invalidateData();
   }
 
-  std::shared_ptr<pumex::Buffer<pumex::Camera>> cameraBuffer;
+  std::shared_ptr<pumex::DynamicBuffer<pumex::Camera>> cameraBuffer;
   std::shared_ptr<pumex::Buffer<pumex::Camera>> textCameraBuffer;
   std::shared_ptr<PositionData>                 positionData;
   std::shared_ptr<pumex::Buffer<PositionData>>  positionBuffer;
   std::shared_ptr<pumex::BasicCameraHandler>    camHandler;
 };
 
+// node that repeats indexed draw call using vertex and index buffers shared by all such nodes. Many such nodes are used to measure command buffer recording time.
+// Each node binds buffers by itself, so that it may be recorded in any secondary command buffer. Redundant binds are skipped by CommandBuffer
+class RepeatDrawNode : public pumex::DrawNode
+{
+public:
+  RepeatDrawNode(std::shared_ptr<pumex::Buffer<std::vector<float>>> vb, std::shared_ptr<pumex::Buffer<std::vector<uint32_t>>> ib, uint32_t ic)
+    : vertexBuffer{ vb }, indexBuffer{ ib }, indexCount{ ic }
+  {
+  }
+  void validate(const pumex::RenderContext& renderContext) override
+  {
+    vertexBuffer->validate(renderContext);
+    indexBuffer->validate(renderContext);
+  }
+  void cmdDraw(const pumex::RenderContext& renderContext, pumex::CommandBuffer* commandBuffer) override
+  {
+    commandBuffer->cmdBindVertexBuffer(0, vertexBuffer->getHandleBuffer(renderContext));
+    commandBuffer->cmdBindIndexBuffer(indexBuffer->getHandleBuffer(renderContext));
+    commandBuffer->cmdDrawIndexed(indexCount, 1, 0, 0, 0);
+  }
+  std::shared_ptr<pumex::Buffer<std::vector<float>>>    vertexBuffer;
+  std::shared_ptr<pumex::Buffer<std::vector<uint32_t>>> indexBuffer;
+  uint32_t                                              indexCount;
+};
+
 int viewer_main( int argc, char* argv[] )
 {
   SET_LOG_WARNING;
@@ -157,6 +183,9 @@ int viewer_main( int argc, char* argv[] )
   args::Flag                                   useFullScreen(parser, "fullscreen", "create fullscreen window", { 'f' });
   args::MapFlag<std::string, VkPresentModeKHR> presentationMode(parser, "presentation_mode", "presentation mode (immediate, mailbox, fifo, fifo_relaxed)", { 'p' }, pumex::Surface::nameToPresentationModes, GPUCULL_DEFAULT_PRESENT_MODE);
   args::ValueFlag<uint32_t>                    updatesPerSecond(parser, "update_frequency", "number of update calls per second", { 'u' }, 60);
+  args::ValueFlag<uint32_t>                    stressNodeCount(parser, "stress_nodes", "number of additional nodes drawing bounding box ( measures command buffer recording time )", { 'n' }, 0);
+  args::Flag                                   disableDrawLists(parser, "no_draw_lists", "record command buffers by traversing node graph instead of replaying draw lists", { 'l' });
+  args::ValueFlag<uint32_t>                    drawsPerSecondaryBuffer(parser, "draws_per_secondary", "record operations with many draw calls in parallel, using secondary command buffers with at least that many draw calls ( 0 = disabled )", { 'c' }, 0);
   args::Positional<std::string>                modelNameArg(parser, "model", "3D model filename");
   args::Positional<std::string>                animationNameArg(parser, "animation", "3D animation");
   try
@@ -246,6 +275,8 @@ int viewer_main( int argc, char* argv[] )
 
     pumex::ResourceDefinition swapChainDefinition = pumex::SWAPCHAIN_DEFINITION(VK_FORMAT_R8G8B8A8_UNORM);
     pumex::SurfaceTraits surfaceTraits{ swapChainDefinition, 3, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR, presentMode, VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR, VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR };
+    surfaceTraits.useDrawLists            = !disableDrawLists;
+    surfaceTraits.drawsPerSecondaryBuffer = args::get(drawsPerSecondaryBuffer);
     std::shared_ptr<pumex::Surface> surface = window->createSurface(device, surfaceTraits);
 
     // alocate 1 MB for uniform and storage buffers
@@ -254,6 +285,10 @@ int viewer_main( int argc, char* argv[] )
     std::shared_ptr<pumex::DeviceMemoryAllocator> verticesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("vertices", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 256 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
     // allocate 8 MB memory for font textures
     std::shared_ptr<pumex::DeviceMemoryAllocator> texturesAllocator = std::make_shared<pumex::DeviceMemoryAllocator>("textures", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 8 * 1024 * 1024, pumex::DeviceMemoryAllocator::FIRST_FIT);
+    // register allocators in viewer, so that memory statistics may be collected
+    viewer->registerDeviceMemoryAllocator(buffersAllocator);
+    viewer->registerDeviceMemoryAllocator(verticesAllocator);
+    viewer->registerDeviceMemoryAllocator(texturesAllocator);
     // create common descriptor pool
     std::shared_ptr<pumex::DescriptorPool> descriptorPool = std::make_shared<pumex::DescriptorPool>();
 
@@ -287,17 +322,23 @@ int viewer_main( int argc, char* argv[] )
     // - at least one node calling vkCmdDispatch
     //
     // Here is the simple definition of graphics pipeline infrastructure : descriptor set layout, pipeline layout, pipeline cache, shaders and graphics pipeline itself :
-    // Shaders will use two uniform buffers ( both in vertex shader )
-    std::vector<pumex::DescriptorSetLayoutBinding> layoutBindings =
+    // Shaders will use two uniform buffers ( both in vertex shader ). Camera is stored in a dynamic uniform buffer and has its own descriptor set,
+    // because descriptor set with only dynamic buffers is created once per device and not once per surface and swapchain image
+    std::vector<pumex::DescriptorSetLayoutBinding> cameraLayoutBindings =
+    {
+      { 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT }
+    };
+    auto cameraDescriptorSetLayout = std::make_shared<pumex::DescriptorSetLayout>(cameraLayoutBindings);
+    std::vector<pumex::DescriptorSetLayoutBinding> positionLayoutBindings =
     {
-      { 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
-      { 1, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT }
+      { 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT }
     };
-    auto descriptorSetLayout = std::make_shared<pumex::DescriptorSetLayout>(layoutBindings);
+    auto positionDescriptorSetLayout = std::make_shared<pumex::DescriptorSetLayout>(positionLayoutBindings);
 
     // building pipeline layout
     auto pipelineLayout = std::make_shared<pumex::PipelineLayout>();
-    pipelineLayout->descriptorSetLayouts.push_back(descriptorSetLayout);
+    pipelineLayout->descriptorSetLayouts.push_back(cameraDescriptorSetLayout);
+    pipelineLayout->descriptorSetLayouts.push_back(positionDescriptorSetLayout);
 
     auto pipelineCache = std::make_shared<pumex::PipelineCache>();
 
@@ -362,6 +403,20 @@ int viewer_main( int argc, char* argv[] )
     boxAssetNode->setName("boxAssetNode");
     wireframePipeline->addChild(boxAssetNode);
 
+    // stress nodes are grouped by 100 and draw the same bounding box again
+    auto stressVertices = std::make_shared<pumex::Buffer<std::vector<float>>>(std::make_shared<std::vector<float>>(boxg.vertices), verticesAllocator, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, pumex::pbPerDevice, pumex::swOnce);
+    auto stressIndices  = std::make_shared<pumex::Buffer<std::vector<uint32_t>>>(std::make_shared<std::vector<uint32_t>>(boxg.indices), verticesAllocator, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, pumex::pbPerDevice, pumex::swOnce);
+    std::shared_ptr<pumex::Group> stressGroup;
+    for (uint32_t i = 0; i < args::get(stressNodeCount); ++i)
+    {
+      if (i % 100 == 0)
+      {
+        stressGroup = std::make_shared<pumex::Group>();
+        wireframePipeline->addChild(stressGroup);
+      }
+      stressGroup->addChild(std::make_shared<RepeatDrawNode>(stressVertices, stressIndices, boxg.indices.size()));
+    }
+
     // Application data class stores all information required to update rendering ( animation state, camera position, etc )
     std::shared_ptr<ViewerApplicationData> applicationData = std::make_shared<ViewerApplicationData>(buffersAllocator);
 
@@ -371,19 +426,19 @@ int viewer_main( int argc, char* argv[] )
     std::copy(begin(globalTransforms), end(globalTransforms), std::begin(modelData.bones));
     (*applicationData->positionData) = modelData;
 
-    // here we create above mentioned uniform buffers - one for camera state and one for model state
-    auto cameraUbo   = std::make_shared<pumex::UniformBuffer>(applicationData->cameraBuffer);
+    // camera buffer is a dynamic buffer, so it is a resource itself. Model state is stored in a regular buffer that needs a uniform buffer resource
     auto positionUbo = std::make_shared<pumex::UniformBuffer>(applicationData->positionBuffer);
 
-    auto descriptorSet = std::make_shared<pumex::DescriptorSet>(descriptorPool, descriptorSetLayout);
-      descriptorSet->setDescriptor(0, cameraUbo);
-      descriptorSet->setDescriptor(1, positionUbo);
-    pipeline->setDescriptorSet(0, descriptorSet);
+    // both pipelines use the same descriptor sets
+    auto cameraDescriptorSet = std::make_shared<pumex::DescriptorSet>(descriptorPool, cameraDescriptorSetLayout);
+      cameraDescriptorSet->setDescriptor(0, applicationData->cameraBuffer);
+    pipeline->setDescriptorSet(0, cameraDescriptorSet);
+    wireframePipeline->setDescriptorSet(0, cameraDescriptorSet);
 
-    auto wireframeDescriptorSet = std::make_shared<pumex::DescriptorSet>(descriptorPool, descriptorSetLayout);
-      wireframeDescriptorSet->setDescriptor(0, cameraUbo);
-      wireframeDescriptorSet->setDescriptor(1, positionUbo);
-    wireframePipeline->setDescriptorSet(0, wireframeDescriptorSet);
+    auto positionDescriptorSet = std::make_shared<pumex::DescriptorSet>(descriptorPool, positionDescriptorSetLayout);
+      positionDescriptorSet->setDescriptor(0, positionUbo);
+    pipeline->setDescriptorSet(1, positionDescriptorSet);
+    wireframePipeline->setDescriptorSet(1, positionDescriptorSet);
 
     // lets add object that calculates time statistics and is able to render it. Temporary removed from Android due to problems with text rendering
     std::shared_ptr<pumex::TimeStatisticsHandler> tsHandler = std::make_shared<pumex::TimeStatisticsHandler>(viewer, pipelineCache, buffersAllocator, texturesAllocator, applicationData->textCameraBuffer);
@@ -13,7 +13,7 @@ layout (location = 2) in vec2 inUV;
 layout (location = 3) in vec4 inBoneWeight;
 layout (location = 4) in vec4 inBoneIndex;
 
-layout (binding = 0) uniform CameraUbo
+layout (set = 0, binding = 0) uniform CameraUbo
 {
   mat4 viewMatrix;
   mat4 viewMatrixInverse;
@@ -22,7 +22,7 @@ layout (binding = 0) uniform CameraUbo
   vec4 params;
 } camera;
 
-layout (binding = 1) uniform PositionUbo
+layout (set = 1, binding = 0) uniform PositionUbo
 {
   mat4  position;
   mat4  bones[MAX_BONES];
@@ -162,6 +162,8 @@ public:
   void                   cmdBindVertexIndexBuffer(const RenderContext& renderContext, CommandBuffer* commandBuffer, uint32_t renderMask, uint32_t vertexBinding = 0);
   void                   cmdDrawObject(const RenderContext& renderContext, CommandBuffer* commandBuffer, uint32_t renderMask, uint32_t typeID, uint32_t firstInstance, float distanceToViewer) const;
   void                   cmdDrawObjectsIndirect(const RenderContext& renderContext, CommandBuffer* commandBuffer, std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> drawCommands);
+  // number of draws is read from drawCount buffer - requires VK_KHR_draw_indirect_count
+  void                   cmdDrawObjectsIndirectCount(const RenderContext& renderContext, CommandBuffer* commandBuffer, std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> drawCommands, std::shared_ptr<Buffer<uint32_t>> drawCount);
 
   void                   prepareDrawCommands(uint32_t renderMask, std::vector<DrawIndexedIndirectCommand>& drawCommands, std::vector<uint32_t>& typeOfGeometry) const;
 
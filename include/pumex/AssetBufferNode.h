@@ -26,11 +26,14 @@
 #include <pumex/Export.h>
 #include <pumex/Node.h>
 #include <pumex/DrawNode.h>
+#include <pumex/DispatchNode.h>
 
 namespace pumex
 {
 
 class MaterialSet;
+class DescriptorPool;
+class DescriptorSetLayout;
 
 // Node class that stores a pointer to AssetBuffer for drawing shaders ( shaders that draw objects using instance data ). There may be many such objects pointing at the same AssetBuffer
 
@@ -50,11 +53,14 @@ public:
 };
 
 // Node class that stores a pointer to AssetBuffer for compute shaders ( shaders that filter instances for later rendering )
+// When useDrawCount is set, additional buffers for compacted draw commands and draw count are created. These buffers are filled
+// by AssetBufferCompactionNode placed after instance filtering, so that AssetBufferIndirectDrawObjects may skip empty draws
+// using vkCmdDrawIndexedIndirectCountKHR(). Until compaction node is attached for a render mask, ordinary draw commands are used.
 
 class PUMEX_EXPORT AssetBufferFilterNode : public Group
 {
 public:
-  AssetBufferFilterNode(std::shared_ptr<AssetBuffer> assetBuffer, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator);
+  AssetBufferFilterNode(std::shared_ptr<AssetBuffer> assetBuffer, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator, bool useDrawCount = false);
 
   void                                                             accept(NodeVisitor& visitor) override;
   void                                                             validate(const RenderContext& renderContext) override;
@@ -63,9 +69,15 @@ public:
   inline void                                                      setEventResizeOutputs(std::function<void(uint32_t, size_t)> event);
 
   std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> getDrawIndexedIndirectBuffer(uint32_t renderMask);
+  // both methods return nullptr when useDrawCount was not set
+  std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> getCompactedDrawIndexedIndirectBuffer(uint32_t renderMask);
+  std::shared_ptr<Buffer<uint32_t>>                                getDrawCountBuffer(uint32_t renderMask);
   size_t                                                           getMaxOutputObjects(uint32_t renderMask);
   uint32_t                                                         getDrawCount(uint32_t renderMask);
 
+  void                                                             attachCompaction(uint32_t renderMask);
+  bool                                                             hasCompaction(uint32_t renderMask);
+
 protected:
   std::shared_ptr<AssetBuffer>                                     assetBuffer;
   std::vector<size_t>                                              typeCount;
@@ -76,11 +88,15 @@ protected:
   struct PerRenderMaskData
   {
     PerRenderMaskData() = default;
-    PerRenderMaskData(std::shared_ptr<DeviceMemoryAllocator> allocator);
+    PerRenderMaskData(std::shared_ptr<DeviceMemoryAllocator> allocator, bool useDrawCount);
 
     std::shared_ptr<std::vector<DrawIndexedIndirectCommand>>         drawIndexedIndirectCommands;
     std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> drawIndexedIndirectBuffer;
+    std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> compactedDrawIndexedIndirectBuffer;
+    std::shared_ptr<uint32_t>                                        drawCount;
+    std::shared_ptr<Buffer<uint32_t>>                                drawCountBuffer;
     size_t                                                           maxOutputObjects;
+    bool                                                             compactionAttached = false;
   };
   std::unordered_map<uint32_t, PerRenderMaskData>                    perRenderMaskData;
 
@@ -90,6 +106,27 @@ protected:
 void AssetBufferFilterNode::setEventResizeOutputs(std::function<void(uint32_t, size_t)> event) { eventResizeOutputs = event; }
 void AssetBufferFilterNode::onEventResizeOutputs(uint32_t mask, size_t instanceCount) { if (eventResizeOutputs != nullptr)  eventResizeOutputs(mask, instanceCount); }
 
+// Node class that compacts draw commands of AssetBufferFilterNode created with useDrawCount set. Must be a child of ComputePipeline
+// using shaders/compact_draw_commands.comp and descriptor set layout created by createDescriptorSetLayout(). Descriptor set 0 should be
+// created by createDescriptorSet(). Place it after instance filtering in the same render operation. Each time it is recorded it resets
+// draw count to 0, waits for filtering results and dispatches compaction
+class PUMEX_EXPORT AssetBufferCompactionNode : public DispatchNode
+{
+public:
+  AssetBufferCompactionNode(std::shared_ptr<AssetBufferFilterNode> filterNode, uint32_t renderMask);
+
+  static std::shared_ptr<DescriptorSetLayout> createDescriptorSetLayout();
+  std::shared_ptr<DescriptorSet>              createDescriptorSet(std::shared_ptr<DescriptorPool> descriptorPool, std::shared_ptr<DescriptorSetLayout> descriptorSetLayout) const;
+
+  void cmdDispatch(const RenderContext& renderContext, CommandBuffer* commandBuffer) override;
+
+  uint32_t                                                         renderMask;
+protected:
+  std::shared_ptr<AssetBufferFilterNode>                           filterNode;
+  std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> drawCommands;
+  std::shared_ptr<Buffer<uint32_t>>                                drawCount;
+};
+
 // Node class that draws single object registered in AssetBufferNode
 class PUMEX_EXPORT AssetBufferDrawObject : public DrawNode
 {
@@ -106,7 +143,8 @@ public:
   uint32_t firstInstance;
 };
 
-// Node class that draws series of objects registered in AssetBufferNode using cmdDrawIndexedIndirect - needs a buffer to work
+// Node class that draws series of objects registered in AssetBufferNode using cmdDrawIndexedIndirect - needs a buffer to work.
+// When filter node has compaction attached and device supports VK_KHR_draw_indirect_count - compacted draw commands are drawn instead
 class PUMEX_EXPORT AssetBufferIndirectDrawObjects : public DrawNode
 {
 public:
@@ -117,7 +155,10 @@ public:
 
   uint32_t                                                         renderMask;
 protected:
+  std::shared_ptr<AssetBufferFilterNode>                           filterNode;
   std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> drawCommands;
+  std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> compactedDrawCommands;
+  std::shared_ptr<Buffer<uint32_t>>                                drawCount;
   bool                                                             registered = false;
 };
 
@@ -74,6 +74,19 @@ struct PipelineBarrier;
 
 class CommandBufferSource;
 
+// counters describing bind commands recorded since last CommandBuffer::cmdBegin(). Bind commands that would set already bound state are skipped
+struct PUMEX_EXPORT BindStatistics
+{
+  uint32_t pipelinesIssued       = 0;
+  uint32_t pipelinesSkipped      = 0;
+  uint32_t descriptorSetsIssued  = 0;
+  uint32_t descriptorSetsSkipped = 0;
+  uint32_t vertexBuffersIssued   = 0;
+  uint32_t vertexBuffersSkipped  = 0;
+  uint32_t indexBuffersIssued    = 0;
+  uint32_t indexBuffersSkipped   = 0;
+};
+
 // Class representing Vulkan command buffer. Most of the vkCmd* commands will be defined here.
 class PUMEX_EXPORT CommandBuffer
 {
@@ -113,15 +126,21 @@ public:
   void            cmdPipelineBarrier(const RenderContext& renderContext, const MemoryObjectBarrierGroup& barrierGroup, const std::vector<MemoryObjectBarrier>& barriers);
   void            cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, std::vector<VkBufferCopy> bufferCopy) const;
   void            cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const VkBufferCopy& bufferCopy) const;
+  void            cmdFillBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size, uint32_t data) const;
 
   void            cmdBindPipeline(const RenderContext& renderContext, ComputePipeline* pipeline);
   void            cmdBindPipeline(const RenderContext& renderContext, GraphicsPipeline* pipeline);
   void            cmdBindDescriptorSets(const RenderContext& renderContext, PipelineLayout* pipelineLayout, uint32_t firstSet, const std::vector<DescriptorSet*> descriptorSets);
   void            cmdBindDescriptorSets(const RenderContext& renderContext, PipelineLayout* pipelineLayout, uint32_t firstSet, DescriptorSet* descriptorSet);
+  void            cmdPushConstants(PipelineLayout* pipelineLayout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* values) const;
+  void            cmdBindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset = 0);
+  void            cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
 
   void            cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t vertexOffset, uint32_t firstInstance) const;
   void            cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t firstInstance) const;
   void            cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) const;
+  // draw count is read from countBuffer - requires VK_KHR_draw_indirect_count ( see Device::enableDrawIndirectCount )
+  void            cmdDrawIndexedIndirectCount(const RenderContext& renderContext, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) const;
   void            cmdDispatch(uint32_t x, uint32_t y, uint32_t z) const;
 
   void            cmdCopyBufferToImage(VkBuffer srcBuffer, const Image& image, VkImageLayout dstImageLayout, const std::vector<VkBufferImageCopy>& regions) const;
@@ -134,6 +153,11 @@ public:
 
   void            executeCommandBuffer(const RenderContext& renderContext, CommandBuffer* secondaryBuffer);
 
+  // when bind filtering is on ( default ) bind commands setting the same state that is already bound are not sent to Vulkan
+  inline void     setBindFiltering(bool filtering);
+  inline bool     getBindFiltering() const;
+  inline const BindStatistics& getBindStatistics() const;
+
   // submit queue - no fences and semaphores
   void queueSubmit(VkQueue queue, const std::vector<VkSemaphore>& waitSemaphores = {}, const std::vector<VkPipelineStageFlags>& waitStages = {}, const std::vector<VkSemaphore>& signalSemaphores = {}, VkFence fence = VK_NULL_HANDLE) const;
 
@@ -146,11 +170,33 @@ protected:
   mutable std::mutex             mutex;
   std::set<CommandBufferSource*> sources;
   uint32_t                       activeIndex   = 0;
+
+  // state bound in currently recorded command buffer. Descriptor sets and pipelines are stored per bind point ( graphics, compute )
+  struct BoundState
+  {
+    VkPipeline                                     pipeline[2]       = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkPipelineLayout                               pipelineLayout[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    std::vector<VkDescriptorSet>                   descriptorSets[2];
+    std::vector<std::vector<uint32_t>>             dynamicOffsets[2];
+    std::vector<std::pair<VkBuffer, VkDeviceSize>> vertexBuffers;
+    VkBuffer                                       indexBuffer       = VK_NULL_HANDLE;
+    VkDeviceSize                                   indexOffset       = 0;
+    VkIndexType                                    indexType         = VK_INDEX_TYPE_UINT32;
+  };
+  // returns true when descriptor sets are already bound with the same dynamic offsets. Otherwise stores them as bound
+  bool                           bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t firstSet, const std::vector<VkDescriptorSet>& descriptorSets, const std::vector<std::vector<uint32_t>>& dynamicOffsets);
+
+  BoundState                     boundState;
+  BindStatistics                 bindStatistics;
+  bool                           bindFiltering = true;
 };
 
 void     CommandBuffer::setActiveIndex(uint32_t index) { activeIndex = index % commandBuffer.size(); }
 uint32_t CommandBuffer::getActiveIndex() const         { return activeIndex; }
 bool     CommandBuffer::isValid()                      { return valid[activeIndex]!=0; }
+void     CommandBuffer::setBindFiltering(bool filtering) { bindFiltering = filtering; }
+bool     CommandBuffer::getBindFiltering() const         { return bindFiltering; }
+const BindStatistics& CommandBuffer::getBindStatistics() const { return bindStatistics; }
 
 // helper class defining pipeline barrier used later in CommandBuffer::cmdPipelineBarrier()
 struct PUMEX_EXPORT PipelineBarrier
@@ -45,17 +45,21 @@ class RenderContext;
 // Descriptor set layout definition
 struct PUMEX_EXPORT DescriptorSetLayoutBinding
 {
-  DescriptorSetLayoutBinding(uint32_t binding, uint32_t bindingCount, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags);
+  DescriptorSetLayoutBinding(uint32_t binding, uint32_t bindingCount, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, VkDescriptorBindingFlagsEXT bindingFlags = 0);
   uint32_t            binding        = 0;
   uint32_t            bindingCount   = 1;
   VkDescriptorType    descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; // VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
   VkShaderStageFlags  stageFlags     = VK_SHADER_STAGE_ALL_GRAPHICS; // VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, VK_SHADER_STAGE_GEOMETRY_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT, VK_SHADER_STAGE_ALL_GRAPHICS
+  VkDescriptorBindingFlagsEXT bindingFlags = 0; // requires VK_EXT_descriptor_indexing : VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT, VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
 };
 
 std::size_t computeHash(const std::vector<DescriptorSetLayoutBinding> layoutBindings);
 
 class DescriptorSetLayout;
 
+// Descriptor pool grows on demand : when Vulkan pool created for a layout is exhausted, next pool with doubled size is chained after it.
+// Descriptor sets are never freed back to Vulkan pools - deallocated sets are reused by descriptor sets with identically defined layout.
+// Deallocated set may still be used by frames in flight, so it is reused only after as many frames as there are swapchain images
 class PUMEX_EXPORT DescriptorPool
 {
 public:
@@ -79,19 +83,37 @@ protected:
     }
     std::shared_ptr<DescriptorSetLayout> layout;
     uint32_t                             registeredDescriptorSets;
-    uint32_t                             maxSets;
+    uint32_t                             maxSets;                  // size of the first Vulkan pool
   };
 
-  struct DescriptorPoolInternal
+  // chain of Vulkan pools created for a single pool definition
+  struct PoolChain
   {
     std::vector<VkDescriptorPool> descriptorPools;
-    std::vector<uint32_t>         allocatedDescriptors;
+    uint32_t                      lastPoolSize      = 0;
+    uint32_t                      lastPoolAllocated = 0;
+  };
+
+  struct RetiredDescriptorSet
+  {
+    VkDescriptorSet descriptorSet;
+    std::size_t     layoutHash;
+    uint64_t        epoch;        // frame in which descriptor set was deallocated
+  };
+
+  struct DescriptorPoolInternal
+  {
+    std::vector<PoolChain>                                        poolChains;
+    std::vector<uint32_t>                                         allocatedDescriptors;
+    std::unordered_map<std::size_t, std::vector<VkDescriptorSet>> freeDescriptorSets;   // key = layout hash value
+    std::vector<RetiredDescriptorSet>                             retiredDescriptorSets; // deallocated sets that may still be used by frames in flight
   };
   typedef PerObjectData<DescriptorPoolInternal, uint32_t> DescriptorPoolData;
 
   mutable std::mutex                                        mutex;
   std::unordered_map<uint32_t, DescriptorPoolData>          perObjectData;
   std::vector<SinglePoolDefinition>                         poolDefinitions;
+  uint32_t                                                  retireFrames = 1;
 };
 
 class PUMEX_EXPORT DescriptorSetLayout : public std::enable_shared_from_this<DescriptorSetLayout>
@@ -107,14 +129,28 @@ public:
   VkDescriptorSetLayout                                 getHandle(const RenderContext& renderContext) const;
   VkDescriptorType                                      getDescriptorType(uint32_t binding) const;
   uint32_t                                              getDescriptorBindingCount(uint32_t binding) const;
+  VkDescriptorBindingFlagsEXT                           getDescriptorBindingFlags(uint32_t binding) const;
   std::vector<VkDescriptorPoolSize>                     getDescriptorPoolSize(uint32_t poolSize) const;
+  // returns VK_NULL_HANDLE when descriptor update templates are not available for this layout
+  VkDescriptorUpdateTemplateKHR                         getUpdateTemplate(const RenderContext& renderContext) const;
+  // fills data used by update template. Returns false when some of the bindings have no values
+  bool                                                  getTemplateData(const std::map<uint32_t, std::vector<DescriptorValue>>& values, std::vector<DescriptorValue>& templateData) const;
   inline std::size_t                                    getHashValue() const;
   inline const std::vector<DescriptorSetLayoutBinding>& getBindings() const;
+  // true when at least one binding may be updated after bind ( descriptor pool must be created with VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT )
+  inline bool                                           usesUpdateAfterBindPool() const;
+  // true when all bindings may be updated after bind - command buffers using descriptor set do not have to be rebuilt after descriptor update
+  inline bool                                           isUpdateAfterBind() const;
+  // true when all bindings are dynamic uniform or storage buffers - descriptor set using such layout is shared by all surfaces and swapchain images of a device
+  inline bool                                           isDynamic() const;
+  // bindings of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC and VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC sorted by binding number
+  inline const std::vector<uint32_t>&                   getDynamicBindings() const;
 
 protected:
   struct DescriptorSetLayoutInternal
   {
-    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout         descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplateKHR updateTemplate      = VK_NULL_HANDLE; // owned by Device
   };
   typedef PerObjectData<DescriptorSetLayoutInternal, uint32_t> DescriptorSetLayoutData;
 
@@ -122,11 +158,43 @@ protected:
   std::unordered_map<uint32_t, DescriptorSetLayoutData> perObjectData;
   std::vector<DescriptorSetLayoutBinding>               bindings;
   std::size_t                                           hashValue;
+  bool                                                  anyUpdateAfterBind = false;
+  bool                                                  allUpdateAfterBind = false;
+  std::vector<uint32_t>                                 dynamicBindings;
   bool                                                  registered = false;
 };
 
 class DescriptorSet;
-struct DescriptorValue;
+
+// Collects descriptor writes from many descriptor sets, so that they may be sent to the driver in one place.
+// Descriptor set becomes valid ( and its command buffers are notified ) only when its writes are flushed
+class PUMEX_EXPORT DescriptorWriteBatch
+{
+public:
+  // all writes added after beginSet() belong to that descriptor set. Empty elementWrites means that whole descriptor set is written
+  void beginSet(std::shared_ptr<DescriptorSet> owner, uint32_t keyValue, uint32_t activeIndex, VkDescriptorSet descriptorSet, bool elementWrites);
+  void add(VkDescriptorSet descriptorSet, const DescriptorSetLayout& layout, const std::map<uint32_t, std::vector<DescriptorValue>>& values);
+  // writes single element of a descriptor array
+  void add(VkDescriptorSet descriptorSet, const DescriptorSetLayout& layout, uint32_t binding, uint32_t element, const DescriptorValue& value);
+  void flush(VkDevice device);
+
+protected:
+  struct SetWrites
+  {
+    std::shared_ptr<DescriptorSet>             owner;
+    uint32_t                                   keyValue;
+    uint32_t                                   activeIndex;
+    VkDescriptorSet                            descriptorSet;
+    bool                                       elementWrites;
+    size_t                                     firstWrite;
+    std::vector<std::pair<uint32_t, uint32_t>> elements; // ( binding, element ) pair for each write, when elementWrites == true
+  };
+  std::vector<VkWriteDescriptorSet>                     writes;
+  std::vector<std::pair<DescriptorValue::Type, size_t>> infoIndices; // infos are stored in vectors that may grow - pointers are resolved during flush()
+  std::vector<VkDescriptorBufferInfo>                   bufferInfos;
+  std::vector<VkDescriptorImageInfo>                    imageInfos;
+  std::vector<SetWrites>                                setWrites;
+};
 
 // Descriptor stores information about a set of resources in a descriptor set
 class PUMEX_EXPORT Descriptor : public std::enable_shared_from_this<Descriptor>
@@ -162,6 +230,9 @@ public:
   virtual ~DescriptorSet();
 
   void                        validate(const RenderContext& renderContext);
+  // descriptor writes that cannot be performed using update template are stored in writeBatch and must be flushed before descriptor set is used.
+  // Such descriptor set is marked as valid only by writeBatch.flush()
+  void                        validate(const RenderContext& renderContext, DescriptorWriteBatch& writeBatch);
   void                        invalidateOwners();
   void                        notify(const RenderContext& renderContext);
   void                        notify();
@@ -170,6 +241,8 @@ public:
   void                        setDescriptor(uint32_t binding, const std::vector<std::shared_ptr<Resource>>& resources);
   void                        setDescriptor(uint32_t binding, std::shared_ptr<Resource> resource, VkDescriptorType descriptorType);
   void                        setDescriptor(uint32_t binding, std::shared_ptr<Resource> resource);
+  // sets single element of a descriptor array. Elements must be added in order. Only that element is written to Vulkan descriptor set during next validation
+  void                        setDescriptorElement(uint32_t binding, uint32_t element, std::shared_ptr<Resource> resource, VkDescriptorType descriptorType);
   void                        resetDescriptor(uint32_t binding);
   std::shared_ptr<Descriptor> getDescriptor(uint32_t binding);
 
@@ -177,14 +250,26 @@ public:
   void                        removeNode(std::shared_ptr<Node> node);
 
   VkDescriptorSet             getHandle(const RenderContext& renderContext) const;
+  // number of Vulkan descriptor sets created for each surface ( one for each swapchain image or just one )
+  uint32_t                    getActiveCount() const;
+  // appends dynamic offsets in order expected by vkCmdBindDescriptorSets() : by binding number, then by array element
+  void                        getDynamicOffsets(const RenderContext& renderContext, std::vector<uint32_t>& offsets) const;
 protected:
+  friend class DescriptorWriteBatch;
+  // called by DescriptorWriteBatch::flush(). Writes are skipped when another batch has already written the same descriptor set
+  void                        flushWrites(VkDevice device, uint32_t keyValue, uint32_t activeIndex, VkDescriptorSet descriptorSet, bool elementWrites, const std::vector<std::pair<uint32_t, uint32_t>>& elements, const VkWriteDescriptorSet* setWrites, uint32_t writeCount);
+  uint32_t                    getNotifyIndex(uint32_t activeIndex) const;
+
   struct DescriptorSetInternal
   {
     DescriptorSetInternal()
-      : descriptorSet{ VK_NULL_HANDLE }
+      : descriptorSet{ VK_NULL_HANDLE }, written{ false }, handleChanged{ false }
     {
     }
-    VkDescriptorSet  descriptorSet;
+    VkDescriptorSet                            descriptorSet;
+    bool                                       written;         // descriptor set was written at least once, so it may be bound by frames in flight
+    bool                                       handleChanged;   // descriptor set was allocated, but command buffers were not notified yet
+    std::vector<std::pair<uint32_t, uint32_t>> pendingElements; // ( binding, element ) pairs modified since last validation
   };
   typedef PerObjectData<DescriptorSetInternal, uint32_t> DescriptorSetData;
 
@@ -196,9 +281,16 @@ protected:
   std::unordered_map<uint32_t, std::shared_ptr<Descriptor>> descriptors; // descriptor set indirectly owns buffers, images and whatnot
   std::vector<std::weak_ptr<Node>>                          nodeOwners;
   uint32_t                                                  activeCount = 1;
+  // descriptor sets with dynamic layouts are created once per device, other ones - per surface and swapchain image
+  PerObjectBehaviour                                        perObjectBehaviour      = pbPerSurface;
+  SwapChainImageBehaviour                                   swapChainImageBehaviour = swForEachImage;
 };
 
 std::size_t DescriptorSetLayout::getHashValue() const                                   { return hashValue; }
 const std::vector<DescriptorSetLayoutBinding>& DescriptorSetLayout::getBindings() const { return bindings; }
+bool DescriptorSetLayout::usesUpdateAfterBindPool() const                               { return anyUpdateAfterBind; }
+bool DescriptorSetLayout::isUpdateAfterBind() const                                     { return allUpdateAfterBind; }
+bool DescriptorSetLayout::isDynamic() const                                             { return !bindings.empty() && dynamicBindings.size() == bindings.size(); }
+const std::vector<uint32_t>& DescriptorSetLayout::getDynamicBindings() const            { return dynamicBindings; }
 
 }
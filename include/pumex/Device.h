@@ -25,6 +25,8 @@
 #include <memory>
 #include <tuple>
 #include <mutex>
+#include <unordered_map>
+#include <condition_variable>
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <pumex/Export.h>
@@ -39,6 +41,20 @@ class CommandPool;
 class DescriptorPool;
 class CommandBuffer;
 class StagingBuffer;
+class StagingRingBuffer;
+class TransientResourcePool;
+struct StagingAllocation;
+
+// counters describing staging memory usage on a device
+struct PUMEX_EXPORT StagingStatistics
+{
+  VkDeviceSize ringSize        = 0;
+  VkDeviceSize usedSize        = 0;
+  VkDeviceSize peakUsedSize    = 0;
+  uint64_t     allocationCount = 0; // allocations served by staging ring
+  uint64_t     overflowCount   = 0; // allocations that did not fit into staging ring and used dedicated staging buffer
+  uint64_t     stallCount      = 0; // allocations that had to wait for other command buffers to release staging ring memory
+};
 
 // class representing Vulkan logical device. There may be many logical devices used in a single Viewer object
 class PUMEX_EXPORT Device : public std::enable_shared_from_this<Device>
@@ -66,15 +82,31 @@ public:
   void                            releaseQueue(std::shared_ptr<Queue> queue);
 
   std::shared_ptr<DescriptorPool> getDescriptorPool();
+  // images and memory blocks used by render graphs are reused through transient resource pool
+  std::shared_ptr<TransientResourcePool> getTransientResourcePool();
 
   std::shared_ptr<StagingBuffer>  acquireStagingBuffer( const void* data, VkDeviceSize size );
   void                            releaseStagingBuffer(std::shared_ptr<StagingBuffer> buffer);
 
+  // suballocate memory from persistently mapped staging ring. Memory is reclaimed when commands from commandBuffer are finished ( see endSingleTimeCommands() )
+  StagingAllocation               acquireStagingMemory(CommandBuffer* commandBuffer, const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+  void                            releaseStagingMemory(CommandBuffer* commandBuffer);
+  StagingStatistics               getStagingStatistics() const;
+  // staging ring is created during first call to acquireStagingMemory() - its size must be set before that
+  void                            setStagingRingSize(VkDeviceSize size);
+
   inline void                     setID(uint32_t newID);
   inline uint32_t                 getID() const;
 
   bool                            deviceExtensionEnabled(const char* extensionName) const;
 
+  // descriptor update templates ( VK_KHR_descriptor_update_template ) are shared by all descriptor set layouts with the same hash value
+  VkDescriptorUpdateTemplateKHR   getDescriptorUpdateTemplate(std::size_t layoutHash, const VkDescriptorUpdateTemplateCreateInfoKHR& createInfo);
+  void                            updateDescriptorSetWithTemplate(VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplateKHR updateTemplate, const void* data) const;
+
+  // vkCmdDrawIndexedIndirectCountKHR() ( VK_KHR_draw_indirect_count ) - check enableDrawIndirectCount before use
+  void                            cmdDrawIndexedIndirectCount(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) const;
+
   // debug markers extension stuff - not tested yet
   void                            setObjectName(uint64_t object, VkDebugReportObjectTypeEXT objectType, const std::string& name);
   void                            setObjectTag(uint64_t object, VkDebugReportObjectTypeEXT objectType, uint64_t name, size_t tagSize, const void* tag);
@@ -102,6 +134,10 @@ public:
   std::weak_ptr<PhysicalDevice>   physical;
   VkDevice                        device             = VK_NULL_HANDLE;
   bool                            enableDebugMarkers = false;
+  bool                            enableDescriptorUpdateTemplates = false;
+  bool                            enableDescriptorIndexing        = false; // set when VK_EXT_descriptor_indexing was requested
+  bool                            enableDrawIndirectCount         = false;
+  bool                            enableMemoryBudget              = false; // VK_EXT_memory_budget
 protected:
   uint32_t                            id                        = 0;
 
@@ -111,16 +147,31 @@ protected:
   PFN_vkCmdDebugMarkerEndEXT        pfnCmdDebugMarkerEnd        = VK_NULL_HANDLE;
   PFN_vkCmdDebugMarkerInsertEXT     pfnCmdDebugMarkerInsert     = VK_NULL_HANDLE;
 
+  PFN_vkCreateDescriptorUpdateTemplateKHR  pfnCreateDescriptorUpdateTemplate  = VK_NULL_HANDLE;
+  PFN_vkDestroyDescriptorUpdateTemplateKHR pfnDestroyDescriptorUpdateTemplate = VK_NULL_HANDLE;
+  PFN_vkUpdateDescriptorSetWithTemplateKHR pfnUpdateDescriptorSetWithTemplate = VK_NULL_HANDLE;
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR     pfnCmdDrawIndexedIndirectCount     = VK_NULL_HANDLE;
+
   std::vector<QueueTraits>                    requestedQueues;
   std::vector<std::shared_ptr<Queue>>         queues;
   std::shared_ptr<DescriptorPool>             descriptorPool;
+  std::shared_ptr<TransientResourcePool>      transientResourcePool;
   std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
+  VkDeviceSize                                stagingRingSize = 32 * 1024 * 1024;
+  std::shared_ptr<StagingRingBuffer>          stagingRing;
+  std::vector<std::pair<CommandBuffer*, std::shared_ptr<StagingBuffer>>> overflowStagingBuffers;
+  StagingStatistics                           stagingStatistics;
 
   std::vector<const char*>                    requestedDeviceExtensions;
   std::vector<const char*>                    enabledDeviceExtensions;
 
   mutable std::mutex                          stagingMutex;
+  std::condition_variable                     stagingCondition;
   mutable std::mutex                          submitMutex;
+
+  std::unordered_map<std::size_t, VkDescriptorUpdateTemplateKHR> descriptorUpdateTemplates;
+  mutable std::mutex                          templateMutex;
 };
 
 void     Device::resetRequestedQueues()                   { requestedQueues.clear(); }
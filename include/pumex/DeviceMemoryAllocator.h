@@ -46,6 +46,22 @@ struct PUMEX_EXPORT DeviceMemoryBlock
   VkDeviceSize   alignedSize;
 };
 
+// statistics describing current state of a DeviceMemoryAllocator ( for one device or summed over all devices )
+struct PUMEX_EXPORT DeviceMemoryStatistics
+{
+  VkDeviceSize memorySize       = 0; // memory reserved with vkAllocateMemory()
+  VkDeviceSize usedSize         = 0; // memory used by allocations ( alignment padding included )
+  VkDeviceSize freeSize         = 0;
+  VkDeviceSize largestFreeBlock = 0;
+  uint32_t     allocationCount  = 0;
+  uint32_t     freeBlockCount   = 0;
+  uint32_t     deviceCount      = 0;
+
+  // 0.0 means that all free memory lies in one block, values close to 1.0 mean that free memory is scattered into small blocks
+  inline float            getFragmentation() const;
+  DeviceMemoryStatistics& operator+=(const DeviceMemoryStatistics& rhs);
+};
+
 struct FreeBlock
 {
   FreeBlock(VkDeviceSize offset, VkDeviceSize size);
@@ -89,15 +105,24 @@ public:
   inline VkDeviceSize          getMemorySize() const;
   inline const std::string&    getName() const;
 
+  // memory statistics for a single device
+  DeviceMemoryStatistics       getStatistics(VkDevice device) const;
+  // memory statistics summed over all devices
+  DeviceMemoryStatistics       getStatistics() const;
+
 protected:
   struct PerDeviceData
   {
     PerDeviceData()
     {
     }
-    VkDeviceMemory       storageMemory = VK_NULL_HANDLE;
+    VkDeviceMemory       storageMemory   = VK_NULL_HANDLE;
     std::list<FreeBlock> freeBlocks;
+    VkDeviceSize         usedSize        = 0;
+    uint32_t             allocationCount = 0;
   };
+  DeviceMemoryStatistics                      collectStatistics(const PerDeviceData& pdd) const;
+
   mutable std::mutex                          mutex;
   std::string                                 name;
   std::unordered_map<VkDevice, PerDeviceData> perDeviceData;
@@ -106,10 +131,34 @@ protected:
   std::unique_ptr<AllocationStrategy>         allocationStrategy;
 };
 
+float                 DeviceMemoryStatistics::getFragmentation() const   { return (freeSize == 0) ? 0.0f : 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeSize); }
+
 VkMemoryPropertyFlags DeviceMemoryAllocator::getMemoryPropertyFlags() const { return propertyFlags; }
 VkDeviceSize          DeviceMemoryAllocator::getMemorySize() const { return size; }
 const std::string&    DeviceMemoryAllocator::getName() const { return name; }
 
+// memory block allocated from DeviceMemoryAllocator that may be shared by many objects bound at different ( possibly overlapping ) offsets.
+// Memory returns to allocator when the last owner releases the block.
+class PUMEX_EXPORT SharedMemoryBlock
+{
+public:
+  SharedMemoryBlock()                                    = delete;
+  explicit SharedMemoryBlock(Device* device, std::shared_ptr<DeviceMemoryAllocator> allocator, VkMemoryRequirements memoryRequirements);
+  SharedMemoryBlock(const SharedMemoryBlock&)            = delete;
+  SharedMemoryBlock& operator=(const SharedMemoryBlock&) = delete;
+  SharedMemoryBlock(SharedMemoryBlock&&)                 = delete;
+  SharedMemoryBlock& operator=(SharedMemoryBlock&&)      = delete;
+  ~SharedMemoryBlock();
+
+  inline const DeviceMemoryBlock& getMemoryBlock() const;
+protected:
+  VkDevice                               device = VK_NULL_HANDLE;
+  std::shared_ptr<DeviceMemoryAllocator> allocator;
+  DeviceMemoryBlock                      memoryBlock;
+};
+
+const DeviceMemoryBlock& SharedMemoryBlock::getMemoryBlock() const { return memoryBlock; }
+
 class PUMEX_EXPORT FirstFitAllocationStrategy : public AllocationStrategy
 {
 public:
@@ -127,5 +176,7 @@ template<typename T> size_t uglyGetSize(const T& t) { return sizeof(T); }
 template<typename T> size_t uglyGetSize(const std::vector<T>& t) { return t.size() * sizeof(T); }
 template<typename T> T*     uglyGetPointer(T& t) { return std::addressof(t); }
 template<typename T> T*     uglyGetPointer(std::vector<T>& t) { return t.data(); }
+template<typename T> size_t uglyGetElementSize(const T& t) { return sizeof(T); }
+template<typename T> size_t uglyGetElementSize(const std::vector<T>& t) { return sizeof(T); }
 
 }
@@ -36,6 +36,9 @@ public:
   void accept(NodeVisitor& visitor) override;
   void validate(const RenderContext& renderContext) override;
 
+  // default implementation calls vkCmdDispatch( x, y, z ). Derived classes may record additional commands before dispatch
+  virtual void cmdDispatch(const RenderContext& renderContext, CommandBuffer* commandBuffer);
+
   void setDispatch(uint32_t x, uint32_t y, uint32_t z);
   inline uint32_t getX() const;
   inline uint32_t getY() const;
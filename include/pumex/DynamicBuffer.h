@@ -0,0 +1,114 @@
+//
+// Copyright(c) 2017-2018 Paweł Księżopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include <pumex/Export.h>
+#include <pumex/Resource.h>
+#include <pumex/DeviceMemoryAllocator.h>
+#include <pumex/PerObjectData.h>
+
+namespace pumex
+{
+
+class Surface;
+
+// Resource that stores small per surface structures ( camera, screen size, etc. ) in a single buffer per device.
+// Each surface and swapchain image owns its own slot in that buffer. Slots are selected with dynamic offsets
+// during vkCmdBindDescriptorSets(), so descriptor set count and memory usage do not grow with number of surfaces and swapchain images.
+// Allocator must use host visible memory. Use DynamicBuffer<T> below instead of this class.
+// Buffer is sized for all surfaces known to the viewer. When it must grow ( new surface ), replaced buffer is kept until frames that use it are finished.
+// May be referenced in glsl shader as for example : layout (binding = 0) uniform ( with VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC in descriptor set layout )
+class PUMEX_EXPORT DynamicMemoryBuffer : public Resource
+{
+public:
+  DynamicMemoryBuffer()                                      = delete;
+  explicit DynamicMemoryBuffer(std::shared_ptr<DeviceMemoryAllocator> allocator, size_t dataSize, VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+  DynamicMemoryBuffer(const DynamicMemoryBuffer&)            = delete;
+  DynamicMemoryBuffer& operator=(const DynamicMemoryBuffer&) = delete;
+  DynamicMemoryBuffer(DynamicMemoryBuffer&&)                 = delete;
+  DynamicMemoryBuffer& operator=(DynamicMemoryBuffer&&)      = delete;
+  virtual ~DynamicMemoryBuffer();
+
+  std::pair<bool, VkDescriptorType> getDefaultDescriptorType() override;
+  void                              validate(const RenderContext& renderContext) override;
+  DescriptorValue                   getDescriptorValue(const RenderContext& renderContext) override;
+  uint32_t                          getDynamicOffset(const RenderContext& renderContext) override;
+
+  // data is copied and sent to all slots used by a surface during next validations
+  void                              setData(Surface* surface, const void* data, size_t size);
+
+protected:
+  struct RetiredBuffer
+  {
+    VkBuffer          buffer;
+    DeviceMemoryBlock memoryBlock;
+    uint64_t          epoch;       // frame in which buffer was replaced
+  };
+  struct DynamicBufferInternal
+  {
+    VkBuffer                   buffer          = VK_NULL_HANDLE;
+    DeviceMemoryBlock          memoryBlock;
+    VkDeviceSize               slotSize        = 0;
+    uint32_t                   slotCount       = 0;
+    uint32_t                   slotsPerSurface = 0;
+    std::vector<RetiredBuffer> retiredBuffers;  // buffers that may still be used by command buffers in flight
+  };
+  typedef PerObjectData<DynamicBufferInternal, uint32_t> DynamicBufferData;
+  struct SurfaceData
+  {
+    std::vector<uint8_t> data;
+    std::vector<char>    updated; // one flag per swapchain image
+  };
+
+  std::shared_ptr<DeviceMemoryAllocator>          allocator;
+  size_t                                          dataSize;
+  VkDescriptorType                                descriptorType;
+  std::unordered_map<uint32_t, DynamicBufferData> perObjectData; // one buffer per device
+  std::unordered_map<uint32_t, SurfaceData>       surfaceData;
+};
+
+template <typename T>
+class DynamicBuffer : public DynamicMemoryBuffer
+{
+public:
+  explicit DynamicBuffer(std::shared_ptr<DeviceMemoryAllocator> allocator, VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+
+  inline void setData(Surface* surface, const T& data);
+};
+
+template <typename T>
+DynamicBuffer<T>::DynamicBuffer(std::shared_ptr<DeviceMemoryAllocator> allocator, VkDescriptorType descriptorType)
+  : DynamicMemoryBuffer{ allocator, sizeof(T), descriptorType }
+{
+}
+
+template <typename T>
+void DynamicBuffer<T>::setData(Surface* surface, const T& d)
+{
+  DynamicMemoryBuffer::setData(surface, &d, sizeof(T));
+}
+
+}
@@ -77,6 +77,8 @@ public:
   Image()                            = delete;
   // user creates VkImage and assigns memory to it
   explicit Image(Device* device, const ImageTraits& imageTraits, std::shared_ptr<DeviceMemoryAllocator> allocator);
+  // user creates VkImage and binds it to a memory block shared with other objects ( memory aliasing )
+  explicit Image(Device* device, const ImageTraits& imageTraits, std::shared_ptr<SharedMemoryBlock> sharedMemory, VkDeviceSize sharedMemoryOffset);
   // user delivers VkImage, Image does not own it, just creates VkImageView
   explicit Image(Device* device, VkImage image, VkFormat format, const ImageSize& imageSize = ImageSize{ isAbsolute, glm::vec3{ 1.0f, 1.0f, 1.0f }, 1, 1 });
   Image(const Image&)                = delete;
@@ -99,6 +101,7 @@ protected:
   std::shared_ptr<DeviceMemoryAllocator> allocator;
   VkImage                                image        = VK_NULL_HANDLE;
   DeviceMemoryBlock                      memoryBlock;
+  std::shared_ptr<SharedMemoryBlock>     sharedMemory;
   bool                                   ownsImage    = true;
 };
 
@@ -109,7 +112,9 @@ VkDeviceSize         Image::getMemorySize() const  { return memoryBlock.alignedS
 const ImageTraits&   Image::getImageTraits() const { return imageTraits; }
 
 // helper functions
-PUMEX_EXPORT ImageTraits        getImageTraitsFromTexture(const gli::texture& texture, VkImageUsageFlags usage);
+PUMEX_EXPORT ImageTraits          getImageTraitsFromTexture(const gli::texture& texture, VkImageUsageFlags usage);
+// memory requirements of an image that would be created using imageTraits
+PUMEX_EXPORT VkMemoryRequirements getImageMemoryRequirements(Device* device, const ImageTraits& imageTraits);
 
 PUMEX_EXPORT VkFormat           vulkanFormatFromGliFormat(gli::texture::format_type format);
 PUMEX_EXPORT VkImageViewType    vulkanViewTypeFromGliTarget(gli::texture::target_type target);
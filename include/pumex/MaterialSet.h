@@ -25,6 +25,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <mutex>
 #include <vulkan/vulkan.h>
 #if defined(GLM_ENABLE_EXPERIMENTAL) // hack around redundant GLM_ENABLE_EXPERIMENTAL defined in type.hpp
   #undef GLM_ENABLE_EXPERIMENTAL
@@ -37,6 +38,7 @@
 #endif
 #include <pumex/Export.h>
 #include <pumex/MemoryBuffer.h>
+#include <pumex/Descriptor.h>
 
 namespace pumex
 {
@@ -48,6 +50,7 @@ class  Sampler;
 class  MemoryImage;
 class  CombinedImageSampler;
 class  DeviceMemoryAllocator;
+class  TextureResidencyManager;
 class  Viewer;
 class  RenderContext;
 template <typename T> class Buffer;
@@ -88,6 +91,12 @@ public:
   virtual ~TextureRegistryBase();
 
   virtual void setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) = 0;
+  // texture usage feedback ( used by texture registries that are able to evict textures from GPU memory )
+  virtual void reportTextureUsage(uint32_t slotIndex, uint32_t layerIndex, unsigned long long frameNumber);
+  // index of a texture stored in material data. By default it is a layer index within a slot
+  virtual uint32_t getTextureIndex(uint32_t slotIndex, uint32_t layerIndex) const;
+  // called by Viewer once per frame
+  virtual void update(unsigned long long frameNumber);
 };
 
 // abstract virtual class that is used to deal with the materials
@@ -127,6 +136,9 @@ public:
   void                                         registerMaterialVariant(uint32_t typeID, uint32_t materialVariant, const std::vector<Material>& materials);
   void                                         endRegisterMaterials();
 
+  // report that materials of given type were drawn in a given frame ( for example : according to culling results from previous frame )
+  void                                         reportMaterialTypeUsage(uint32_t typeID, unsigned long long frameNumber);
+
   std::vector<Material>                        getMaterials(uint32_t typeID) const;
   uint32_t                                     getMaterialVariantCount(uint32_t typeID) const;
 
@@ -135,13 +147,15 @@ public:
 
 private:
 
-  std::map<TextureSemantic::Type, uint32_t>    registerTextures(const Material& mat);
+  std::map<TextureSemantic::Type, uint32_t>    registerTextures(uint32_t typeID, const Material& mat);
 
   std::weak_ptr<Viewer>                        viewer;
   std::shared_ptr<MaterialRegistryBase>        materialRegistry;
   std::shared_ptr<TextureRegistryBase>         textureRegistry;
   std::vector<TextureSemantic>                 semantics;
   std::map<uint32_t, std::vector<std::string>> textureNames;
+  // pairs of ( slot index, layer index ) of textures used by each material type
+  std::map<uint32_t, std::set<std::pair<uint32_t, uint32_t>>> typeTextures;
 };
 
 // material registry that is able to store any material in a form of T class
@@ -200,15 +214,61 @@ public:
   std::vector<std::shared_ptr<Resource>>& getResources(uint32_t slotIndex);
 
   void                                    setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) override;
+  void                                    reportTextureUsage(uint32_t slotIndex, uint32_t layerIndex, unsigned long long frameNumber) override;
+
+  // residency manager must be set before textures are registered
+  void                                    setResidencyManager(std::shared_ptr<TextureResidencyManager> residencyManager);
+  std::shared_ptr<TextureResidencyManager> getResidencyManager() const;
 
 protected:
   std::shared_ptr<DeviceMemoryAllocator>                         textureAllocator;
+  std::shared_ptr<TextureResidencyManager>                       residencyManager;
+  std::map<uint32_t, std::vector<uint32_t>>                      residencyIDs;
   std::map<uint32_t, std::vector<std::shared_ptr<MemoryImage>>>  memoryImages;
   std::map<uint32_t, uint32_t>                                   textureTypes;
   std::map<uint32_t, std::shared_ptr<Sampler>>                   textureSamplers;
   std::map<uint32_t, std::vector<std::shared_ptr<Resource>>>     resources;
 };
 
+// Texture registry using VK_EXT_descriptor_indexing : textures from all slots are stored in a single, partially bound array of combined image samplers
+// that may be updated after bind. Each texture gets a stable index in that array, which is stored in material data and used by shaders
+// to index the array ( use nonuniformEXT() when index may differ between invocations ).
+// Adding a texture writes a single descriptor and does not require command buffers to be rebuilt.
+class PUMEX_EXPORT TextureRegistryBindless : public TextureRegistryBase
+{
+public:
+  TextureRegistryBindless(std::shared_ptr<DeviceMemoryAllocator> textureAlloc, std::shared_ptr<Sampler> sampler, uint32_t maxTextures);
+
+  // layout binding for texture array. Device must be created with VK_EXT_descriptor_indexing extension requested
+  DescriptorSetLayoutBinding              getLayoutBinding(uint32_t binding, VkShaderStageFlags stageFlags) const;
+  // descriptor set will receive all textures - registered already and registered in the future
+  void                                    addDescriptorSet(std::shared_ptr<DescriptorSet> descriptorSet, uint32_t binding);
+
+  void                                    setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex) override;
+  uint32_t                                getTextureIndex(uint32_t slotIndex, uint32_t layerIndex) const override;
+  void                                    update(unsigned long long frameNumber) override;
+
+protected:
+  std::shared_ptr<DeviceMemoryAllocator>                          textureAllocator;
+  std::shared_ptr<Sampler>                                        textureSampler;
+  uint32_t                                                        maxTextures;
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t>               textureIndices; // ( slot index, layer index ) -> index in texture array
+  std::vector<std::shared_ptr<MemoryImage>>                       memoryImages;
+  std::vector<std::shared_ptr<Resource>>                          resources;
+  std::vector<std::pair<std::weak_ptr<DescriptorSet>, uint32_t>>  descriptorSets;
+
+  // replaced textures may still be used by frames in flight. They are released in update() when these frames are finished
+  struct RetiredTexture
+  {
+    std::shared_ptr<MemoryImage>                                  memoryImage;
+    std::shared_ptr<Resource>                                     resource;
+    uint64_t                                                      epoch;
+  };
+  std::vector<RetiredTexture>                                     retiredTextures;
+  mutable std::mutex                                              retiredMutex;   // guards retiredTextures and descriptorSets used by update()
+  void                                                            releaseRetiredTextures();
+};
+
 class TextureRegistryNull : public TextureRegistryBase
 {
 public:
@@ -302,4 +362,4 @@ void MaterialRegistry<T>::buildTypesAndVariants(std::vector<MaterialTypeDefiniti
   materialDefinitionBuffer->invalidateData();
 }
 
-}
+}
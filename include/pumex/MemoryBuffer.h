@@ -26,6 +26,8 @@
 #include <list>
 #include <mutex>
 #include <algorithm>
+#include <iterator>
+#include <cstring>
 #include <vulkan/vulkan.h>
 #include <pumex/Export.h>
 #include <pumex/MemoryObject.h>
@@ -93,7 +95,7 @@ public:
   };
   struct Operation
   {
-    enum Type { SetBufferSize, SetData };
+    enum Type { SetBufferSize, SetData, SetDataRanges };
     Operation(MemoryBuffer* o, Type t, const BufferSubresourceRange& r, uint32_t ac)
       : owner{ o }, type{ t }, bufferRange{ r }
     {
@@ -113,6 +115,13 @@ public:
           return false;
       return true;
     }
+    bool noneUpdated()
+    {
+      for (auto& u : updated)
+        if (u)
+          return false;
+      return true;
+    }
     // perform() should return true when it added commands to commandBuffer
     virtual bool perform(const RenderContext& renderContext, MemoryBufferInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) = 0;
     virtual void releaseResources(const RenderContext& renderContext)
@@ -167,6 +176,10 @@ public:
   void               setBufferSize(Device* device, size_t bufferSize);
 
   void               invalidateData();
+  // send only part of the data to GPU. Adjacent and overlapping ranges are merged
+  void               invalidateRange(size_t offset, size_t size);
+  // same as above, but uses indices of elements ( when T = std::vector<U> ). Element size is equal to sizeof(U)
+  void               invalidateElements(size_t firstElement, size_t elementCount);
   void               setData(const T& data);
   void               setData(Surface* surface, std::shared_ptr<T> data);
   void               setData(Device* device, std::shared_ptr<T> data);
@@ -237,11 +250,22 @@ struct SetDataOperation : public MemoryBuffer::Operation
 {
   SetDataOperation(MemoryBuffer* o, const BufferSubresourceRange& r, const BufferSubresourceRange& sr, std::shared_ptr<T> data, uint32_t ac);
   bool perform(const RenderContext& renderContext, MemoryBuffer::MemoryBufferInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override;
-  void releaseResources(const RenderContext& renderContext) override;
 
   std::shared_ptr<T>                          data;
   BufferSubresourceRange                      sourceRange;
-  std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
+};
+
+// sends only chosen parts of data, using single multi-region copy command
+template<typename T>
+struct SetDataRangesOperation : public MemoryBuffer::Operation
+{
+  SetDataRangesOperation(MemoryBuffer* o, const BufferSubresourceRange& r, std::shared_ptr<T> data, uint32_t ac);
+  bool perform(const RenderContext& renderContext, MemoryBuffer::MemoryBufferInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override;
+  void addRange(const BufferSubresourceRange& range);
+
+  std::shared_ptr<T>                  data;
+  // sorted, non overlapping and non adjacent ranges
+  std::vector<BufferSubresourceRange> dirtyRanges;
 };
 
 const PerObjectBehaviour&              MemoryBuffer::getPerObjectBehaviour() const      { return perObjectBehaviour; }
@@ -292,7 +316,7 @@ void Buffer<T>::invalidateData()
   for (auto& pdd : perObjectData)
   {
     // remove all previous calls to setData
-    pdd.second.commonData.bufferOperations.remove_if([](std::shared_ptr<Operation> bufop) { return bufop->type == MemoryBuffer::Operation::SetData; });
+    pdd.second.commonData.bufferOperations.remove_if([](std::shared_ptr<Operation> bufop) { return bufop->type == MemoryBuffer::Operation::SetData || bufop->type == MemoryBuffer::Operation::SetDataRanges; });
     // add setData operation with full texture size
     pdd.second.commonData.bufferOperations.push_back(std::make_shared<SetDataOperation<T>>(this, range, range, data, activeCount));
     pdd.second.invalidate();
@@ -300,6 +324,40 @@ void Buffer<T>::invalidateData()
   invalidateResources();
 }
 
+template <typename T>
+void Buffer<T>::invalidateRange(size_t offset, size_t size)
+{
+  CHECK_LOG_THROW(!sameDataPerObject, "Cannot invalidate data - wrong constructor used to create an object");
+  CHECK_LOG_THROW((bufferUsage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) == 0, "Cannot set data for this buffer - user declared it as not writeable");
+  if (size == 0)
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  BufferSubresourceRange range(offset, size);
+  for (auto& pdd : perObjectData)
+  {
+    auto& operations = pdd.second.commonData.bufferOperations;
+    // if there's a pending operation that sends all data - there's nothing to do
+    if (std::any_of(begin(operations), end(operations), [](std::shared_ptr<Operation> bufop) { return bufop->type == MemoryBuffer::Operation::SetData && bufop->noneUpdated(); }))
+      continue;
+    // merge range with pending partial update that was not performed yet
+    auto it = std::find_if(begin(operations), end(operations), [](std::shared_ptr<Operation> bufop) { return bufop->type == MemoryBuffer::Operation::SetDataRanges && bufop->noneUpdated(); });
+    if (it != end(operations))
+      std::static_pointer_cast<SetDataRangesOperation<T>>(*it)->addRange(range);
+    else
+      operations.push_back(std::make_shared<SetDataRangesOperation<T>>(this, range, data, activeCount));
+    pdd.second.invalidate();
+  }
+  invalidateResources();
+}
+
+template <typename T>
+void Buffer<T>::invalidateElements(size_t firstElement, size_t elementCount)
+{
+  CHECK_LOG_THROW(!sameDataPerObject, "Cannot invalidate data - wrong constructor used to create an object");
+  size_t elementSize = uglyGetElementSize(*data);
+  invalidateRange(firstElement * elementSize, elementCount * elementSize);
+}
+
 template <typename T>
 void Buffer<T>::setData(const T& dt)
 {
@@ -392,7 +450,7 @@ void Buffer<T>::internalSetData(uint32_t key, VkDevice device, VkSurfaceKHR surf
 
   BufferSubresourceRange range(0, uglyGetSize(*dt));
   // remove all previous calls to SetData, but only when these calls are a subset of current call
-  pddit->second.commonData.bufferOperations.remove_if([&range](std::shared_ptr<Operation> bufop) { return bufop->type == MemoryBuffer::Operation::SetData && range.contains(bufop->bufferRange); });
+  pddit->second.commonData.bufferOperations.remove_if([&range](std::shared_ptr<Operation> bufop) { return (bufop->type == MemoryBuffer::Operation::SetData || bufop->type == MemoryBuffer::Operation::SetDataRanges) && range.contains(bufop->bufferRange); });
   // add SetData operation
   pddit->second.commonData.bufferOperations.push_back(std::make_shared<SetDataOperation<T>>(this, range, range, dt, activeCount));
   pddit->second.invalidate();
@@ -479,11 +537,11 @@ bool SetDataOperation<T>::perform(const RenderContext& renderContext, MemoryBuff
   {
     if (memoryIsLocal)
     {
-      std::shared_ptr<StagingBuffer> stagingBuffer = renderContext.device->acquireStagingBuffer(uglyGetPointer(*data), uglyGetSize(*data));
+      StagingAllocation staging = renderContext.device->acquireStagingMemory(commandBuffer.get(), uglyGetPointer(*data), uglyGetSize(*data));
       VkBufferCopy copyRegion{};
-      copyRegion.size = uglyGetSize(*data);
-      commandBuffer->cmdCopyBuffer(stagingBuffer->buffer, internals.buffer, copyRegion);
-      stagingBuffers.push_back(stagingBuffer);
+      copyRegion.srcOffset = staging.offset;
+      copyRegion.size      = uglyGetSize(*data);
+      commandBuffer->cmdCopyBuffer(staging.buffer, internals.buffer, copyRegion);
     }
     else
     {
@@ -496,11 +554,88 @@ bool SetDataOperation<T>::perform(const RenderContext& renderContext, MemoryBuff
 }
 
 template<typename T>
-void SetDataOperation<T>::releaseResources(const RenderContext& renderContext)
+SetDataRangesOperation<T>::SetDataRangesOperation(MemoryBuffer* o, const BufferSubresourceRange& r, std::shared_ptr<T> d, uint32_t ac)
+  : MemoryBuffer::Operation(o, MemoryBuffer::Operation::SetDataRanges, r, ac), data{ d }
+{
+  dirtyRanges.push_back(r);
+}
+
+template<typename T>
+void SetDataRangesOperation<T>::addRange(const BufferSubresourceRange& range)
+{
+  auto it = std::lower_bound(begin(dirtyRanges), end(dirtyRanges), range, [](const BufferSubresourceRange& lhs, const BufferSubresourceRange& rhs) { return lhs.offset < rhs.offset; });
+  it = dirtyRanges.insert(it, range);
+  // merge with previous range if they overlap or touch each other
+  if (it != begin(dirtyRanges) && std::prev(it)->offset + std::prev(it)->range >= it->offset)
+  {
+    auto pit    = std::prev(it);
+    pit->range  = std::max(pit->offset + pit->range, it->offset + it->range) - pit->offset;
+    it          = std::prev(dirtyRanges.erase(it));
+  }
+  // merge with all next ranges that overlap or touch current range
+  auto nit = std::next(it);
+  while (nit != end(dirtyRanges) && it->offset + it->range >= nit->offset)
+  {
+    it->range = std::max(it->offset + it->range, nit->offset + nit->range) - it->offset;
+    nit       = dirtyRanges.erase(nit);
+    it        = std::prev(nit);
+  }
+  // operation range covers all dirty ranges
+  bufferRange = BufferSubresourceRange(dirtyRanges.front().offset, dirtyRanges.back().offset + dirtyRanges.back().range - dirtyRanges.front().offset);
+}
+
+template<typename T>
+bool SetDataRangesOperation<T>::perform(const RenderContext& renderContext, MemoryBuffer::MemoryBufferInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer)
 {
-  for (auto& s : stagingBuffers)
-    renderContext.device->releaseStagingBuffer(s);
-  stagingBuffers.clear();
+  VkDeviceSize dataSize = uglyGetSize(*data);
+  // buffer does not exist yet or is too small - all data must be sent
+  if (internals.buffer == VK_NULL_HANDLE || internals.dataSize < dataSize)
+  {
+    BufferSubresourceRange range(0, dataSize);
+    SetDataOperation<T> setDataOperation(owner, range, range, data, 1);
+    return setDataOperation.perform(renderContext, internals, commandBuffer);
+  }
+
+  // ranges may reach beyond data, when data was shrinked after invalidateRange() call
+  std::vector<BufferSubresourceRange> ranges;
+  VkDeviceSize totalSize = 0;
+  for (const auto& r : dirtyRanges)
+  {
+    if (r.offset >= dataSize)
+      break;
+    ranges.push_back(BufferSubresourceRange(r.offset, std::min(r.range, dataSize - r.offset)));
+    totalSize += ranges.back().range;
+  }
+  if (totalSize == 0)
+    return false;
+
+  auto ownerAllocator          = owner->getAllocator();
+  unsigned char* sourceData    = reinterpret_cast<unsigned char*>(uglyGetPointer(*data));
+  bool memoryIsLocal           = ((ownerAllocator->getMemoryPropertyFlags() & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (memoryIsLocal)
+  {
+    StagingAllocation staging = renderContext.device->acquireStagingMemory(commandBuffer.get(), nullptr, totalSize);
+    std::vector<VkBufferCopy> copyRegions;
+    VkDeviceSize stagingOffset = 0;
+    for (const auto& r : ranges)
+    {
+      std::memcpy(reinterpret_cast<unsigned char*>(staging.mappedData) + stagingOffset, sourceData + r.offset, r.range);
+      VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = staging.offset + stagingOffset;
+        copyRegion.dstOffset = r.offset;
+        copyRegion.size      = r.range;
+      copyRegions.push_back(copyRegion);
+      stagingOffset += r.range;
+    }
+    commandBuffer->cmdCopyBuffer(staging.buffer, internals.buffer, copyRegions);
+  }
+  else
+  {
+    for (const auto& r : ranges)
+      ownerAllocator->copyToDeviceMemory(renderContext.device, internals.memoryBlock.alignedOffset + r.offset, sourceData + r.offset, r.range, 0);
+  }
+  // if memory is accessible from host ( is not local ) - we generated no commands to command buffer
+  return memoryIsLocal;
 }
 
 }
@@ -59,13 +59,16 @@ public:
   MemoryImage*                                  asMemoryImage() override;
 
   void                                          setImageTraits(const ImageTraits& traits);
-  void                                          setImageTraits(Surface* surface, const ImageTraits& traits);
+  // when sharedMemory is provided - image is bound to that memory at sharedMemoryOffset ( memory may be aliased by other images )
+  void                                          setImageTraits(Surface* surface, const ImageTraits& traits, std::shared_ptr<SharedMemoryBlock> sharedMemory = nullptr, VkDeviceSize sharedMemoryOffset = 0);
   void                                          setImageTraits(Device* device, const ImageTraits& traits);
 
   void                                          invalidateImage();
   void                                          setImage(Surface* surface, std::shared_ptr<gli::texture> tex);
   void                                          setImage(Device* device, std::shared_ptr<gli::texture> tex);
   void                                          setImageLayer(uint32_t layer, std::shared_ptr<gli::texture> tex);
+  // replace gli::texture with a texture that may have different size and mip level count ( image views covering whole image are resized too )
+  void                                          setTexture(std::shared_ptr<gli::texture> tex);
   // use outside created images ( method created to catch swapchain images )
   void                                          setImages(Surface* surface, std::vector<std::shared_ptr<Image>>& images);
   void                                          setImages(Device* device, std::vector<std::shared_ptr<Image>>& images);
@@ -80,6 +83,9 @@ public:
   inline const PerObjectBehaviour&              getPerObjectBehaviour() const;
   inline const SwapChainImageBehaviour&         getSwapChainImageBehaviour() const;
   inline bool                                   usesSameTraitsPerObject() const;
+  // images created by setImageTraits() without shared memory may be taken from device's TransientResourcePool ( contents of such image are undefined )
+  inline void                                   setTransientResourcePooling(bool pooling);
+  inline bool                                   usesTransientResourcePooling() const;
   inline std::shared_ptr<DeviceMemoryAllocator> getAllocator() const;
   inline std::shared_ptr<gli::texture>          getTexture() const;
 
@@ -144,6 +150,7 @@ protected:
   PerObjectBehaviour                              perObjectBehaviour;
   SwapChainImageBehaviour                         swapChainImageBehaviour;
   bool                                            sameTraitsPerObject;
+  bool                                            transientResourcePooling = false;
   ImageTraits                                     imageTraits;
   std::shared_ptr<gli::texture>                   texture;
   std::shared_ptr<DeviceMemoryAllocator>          allocator;
@@ -153,7 +160,7 @@ protected:
   std::vector<std::weak_ptr<CommandBufferSource>> commandBufferSources;
   std::vector<std::weak_ptr<ImageView>>           imageViews;
 
-  void internalSetImageTraits(uint32_t key, VkDevice device, VkSurfaceKHR surface, const ImageTraits& traits, VkImageAspectFlags aMask);
+  void internalSetImageTraits(uint32_t key, VkDevice device, VkSurfaceKHR surface, const ImageTraits& traits, VkImageAspectFlags aMask, std::shared_ptr<SharedMemoryBlock> sharedMemory = nullptr, VkDeviceSize sharedMemoryOffset = 0);
   void internalSetImage(uint32_t key, VkDevice device, VkSurfaceKHR surface, std::shared_ptr<gli::texture> texture);
   void internalSetImages(uint32_t key, VkDevice device, VkSurfaceKHR surface, std::vector<std::shared_ptr<Image>>& images);
   void internalClearImage(uint32_t key, VkDevice device, VkSurfaceKHR surface, const glm::vec4& clearValue, const ImageSubresourceRange& range);
@@ -208,6 +215,8 @@ VkImageAspectFlags                     MemoryImage::getAspectMask() const
 const PerObjectBehaviour&              MemoryImage::getPerObjectBehaviour() const      { return perObjectBehaviour; }
 const SwapChainImageBehaviour&         MemoryImage::getSwapChainImageBehaviour() const { return swapChainImageBehaviour; }
 bool                                   MemoryImage::usesSameTraitsPerObject() const    { return sameTraitsPerObject; }
+void                                   MemoryImage::setTransientResourcePooling(bool p){ transientResourcePooling = p; }
+bool                                   MemoryImage::usesTransientResourcePooling() const { return transientResourcePooling; }
 std::shared_ptr<DeviceMemoryAllocator> MemoryImage::getAllocator() const               { return allocator; }
 std::shared_ptr<gli::texture>          MemoryImage::getTexture() const                 { return texture; }
 
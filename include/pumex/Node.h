@@ -25,6 +25,7 @@
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
 #include <pumex/Export.h>
 #include <pumex/Command.h>
 #include <pumex/PerObjectData.h>
@@ -36,6 +37,7 @@ class Group;
 class NodeVisitor;
 class DescriptorSet;
 class RenderContext;
+class DrawList;
 
 // base class for directed acyclic graph, that is connected to render operations in a render graph
 class PUMEX_EXPORT Node : public CommandBufferSource
@@ -83,21 +85,35 @@ public:
   void                                  addParent(std::shared_ptr<Group> parent);
   void                                  removeParent(std::shared_ptr<Group> parent);
   bool                                  isInSecondaryBuffer();
+
+  // flat list of commands generated by this node and its children ( see BuildCommandBufferVisitor::build() )
+  std::shared_ptr<DrawList>             getDrawList() const;
+  void                                  setDrawList(std::shared_ptr<DrawList> drawList);
+  // version number changes each time the structure of any node graph changes ( children, descriptor sets, masks, secondary buffers )
+  static uint64_t                       getStructureVersion();
+  // epoch is advanced by Viewer once per frame. Modified nodes and their ancestors are stamped with current epoch, so that
+  // ValidateNodeVisitor skips subtrees that were not modified since they were validated
+  static uint64_t                       getEpoch();
+  static void                           advanceEpoch();
 protected:
-  void                                  invalidateParentsNode();
-  void                                  invalidateParentsNode(Surface* surface);
+  static void                           structureChanged();
+
+  // stamps children of this node as modified. Stamping stops at ancestors already stamped in the same epoch and at nodes using secondary buffers
+  void                                  childNodesModified(uint64_t epoch);
   void                                  invalidateParentsDescriptor();
   void                                  invalidateParentsDescriptor(Surface* surface);
 
   struct NodeInternal
   {
     NodeInternal()
-      : childNodesValid{ false }, childDescriptorsValid{ false }, descriptorsValid{ false }
+      : childNodesValid{ false }, childDescriptorsValid{ false }, descriptorsValid{ false }, validatedEpoch{ 0 }, childNodesValidatedEpoch{ 0 }
     {
     }
     bool                           childNodesValid;
     bool                           childDescriptorsValid;
     bool                           descriptorsValid;
+    uint64_t                       validatedEpoch;           // node is validated again when it was modified in this epoch or later
+    uint64_t                       childNodesValidatedEpoch; // children are visited again when any of them was modified in this epoch or later
   };
   struct NodeSecondaryCB
   {
@@ -115,6 +131,9 @@ protected:
   uint32_t                                                     activeCount            = 1;
   std::unordered_map<uint32_t, std::shared_ptr<DescriptorSet>> descriptorSets;
   bool                                                         secondaryBufferPresent = false;
+  std::shared_ptr<DrawList>                                    drawList;
+  std::atomic<uint64_t>                                        modifiedEpoch          { 0 };
+  std::atomic<uint64_t>                                        childNodesModifiedEpoch{ 0 };
 public:
   inline decltype(begin(descriptorSets))  descriptorSetBegin()       { return begin(descriptorSets); }
   inline decltype(end(descriptorSets))    descriptorSetEnd()         { return end(descriptorSets); }
@@ -156,7 +175,7 @@ public:
 
 };
 
-void                                   Node::setMask(uint32_t m)            { mask = m; }
+void                                   Node::setMask(uint32_t m)            { mask = m; structureChanged(); }
 uint32_t                               Node::getMask() const                { return mask; }
 void                                   Node::setName(const std::string& n)  { name = n; }
 const std::string&                     Node::getName() const                { return name; }
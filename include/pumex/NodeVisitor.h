@@ -33,6 +33,7 @@ class AssetBufferNode;
 class DrawNode;
 class DispatchNode;
 class CopyNode;
+class PushConstantsNode;
 
 // Node visitor is a class allowing user to visit direct acyclic graphs
 class PUMEX_EXPORT NodeVisitor
@@ -58,6 +59,7 @@ public:
   virtual void apply(DrawNode& node);
   virtual void apply(DispatchNode& node);
   virtual void apply(CopyNode& node);
+  virtual void apply(PushConstantsNode& node);
 
 protected:
   uint32_t           mask = 0xFFFFFFFF;
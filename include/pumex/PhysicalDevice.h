@@ -48,6 +48,8 @@ public:
   uint32_t              getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32 *memTypeFound = nullptr);
 
   bool                  deviceExtensionImplemented(const char* extensionName) const;
+  // returns false when VK_EXT_memory_budget is not available ( it also requires VK_KHR_get_physical_device_properties2 instance extension )
+  bool                  getMemoryBudget(std::vector<VkDeviceSize>& heapBudget, std::vector<VkDeviceSize>& heapUsage) const;
 
   // physical device
   VkPhysicalDevice                       physicalDevice        = VK_NULL_HANDLE;
@@ -57,12 +59,17 @@ public:
 
   VkPhysicalDeviceFeatures               features;
   VkPhysicalDeviceMultiviewFeaturesKHR   multiViewFeatures;
+  // filled only when VK_EXT_descriptor_indexing is implemented and VK_KHR_get_physical_device_properties2 is enabled
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT   descriptorIndexingFeatures;
+  VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties;
 
   VkPhysicalDeviceMemoryProperties       memoryProperties;
 
   std::vector<VkExtensionProperties>     extensionProperties;
 
   std::vector<VkQueueFamilyProperties>   queueFamilyProperties;
+
+  PFN_vkGetPhysicalDeviceMemoryProperties2 pfn_vkGetPhysicalDeviceMemoryProperties2 = nullptr;
   // only when VK_EXT_KHR_display extension is present ( we are not using it atm )
   //std::vector<VkDisplayPropertiesKHR>    displayProperties;
 
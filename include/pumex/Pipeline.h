@@ -50,6 +50,8 @@ public:
   VkPipelineLayout getHandle(VkDevice device) const;
 
   std::vector<std::shared_ptr<DescriptorSetLayout>> descriptorSetLayouts;
+  // push constant ranges used by PushConstantsNode
+  std::vector<VkPushConstantRange>                  pushConstantRanges;
 protected:
   struct PerDeviceData
   {
@@ -60,10 +62,13 @@ protected:
   std::unordered_map<VkDevice, PerDeviceData> perDeviceData;
 };
 
+// Pipeline cache may be stored on disk between application runs. When cacheFileName is not empty, initial cache data is read during validate()
+// from file "<cacheFileName>_<vendorID>_<deviceID>_<driverVersion>_<pipelineCacheUUID>.bin" ( file with invalid header is ignored ).
+// Cache data is written to the same file by save() and in destructor
 class PUMEX_EXPORT PipelineCache
 {
 public:
-  explicit PipelineCache();
+  explicit PipelineCache(const std::string& cacheFileName = std::string());
   PipelineCache(const PipelineCache&)            = delete;
   PipelineCache& operator=(const PipelineCache&) = delete;
   PipelineCache(PipelineCache&&)                 = delete;
@@ -72,14 +77,20 @@ public:
 
   void            validate(const RenderContext& renderContext);
   VkPipelineCache getHandle(VkDevice device) const;
+  // writes cache data of all devices to disk
+  void            save() const;
 
 protected:
   struct PerDeviceData
   {
     VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    std::string     fileName;
   };
   mutable std::mutex                          mutex;
   std::unordered_map<VkDevice, PerDeviceData> perDeviceData;
+  std::string                                 cacheFileName;
+
+  void            saveDeviceData(VkDevice device, const PerDeviceData& deviceData) const;
 };
 
 // Node class that manages information about current VkPipeline ( graphics or compute : see GraphicsPipeline and ComputePipeline )
@@ -48,6 +48,7 @@
 #include <pumex/InputAttachment.h>
 #include <pumex/UniformBuffer.h>
 #include <pumex/StorageBuffer.h>
+#include <pumex/DynamicBuffer.h>
 #include <pumex/Pipeline.h>
 #include <pumex/RenderPass.h>
 #include <pumex/FrameBuffer.h>
@@ -58,7 +59,10 @@
 #include <pumex/AssetNode.h>
 #include <pumex/AssetBufferNode.h>
 #include <pumex/MaterialSet.h>
+#include <pumex/TextureResidencyManager.h>
+#include <pumex/TransientResourcePool.h>
 #include <pumex/DispatchNode.h>
+#include <pumex/PushConstantsNode.h>
 #include <pumex/BlitImageNode.h>
 #include <pumex/Text.h>
 #include <pumex/Camera.h>
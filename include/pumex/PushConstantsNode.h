@@ -0,0 +1,69 @@
+//
+// Copyright(c) 2017-2018 Paweł Księżopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <pumex/Export.h>
+#include <pumex/Node.h>
+
+namespace pumex
+{
+
+class CommandBuffer;
+
+// Node class that sets push constants ( vkCmdPushConstants ) for its children. Small per-draw parameters ( object index, LOD, etc. )
+// may be sent this way without buffer uploads and descriptor set updates. Range described by stageFlags, offset and data size must be
+// declared in PipelineLayout::pushConstantRanges of the pipeline that is bound when this node is visited
+class PUMEX_EXPORT PushConstantsNode : public Group
+{
+public:
+  PushConstantsNode(VkShaderStageFlags stageFlags, uint32_t offset);
+
+  void                        accept(NodeVisitor& visitor) override;
+  void                        validate(const RenderContext& renderContext) override;
+
+  void                        setData(const void* data, uint32_t size);
+  template <typename T>
+  inline void                 setData(const T& data);
+
+  void                        cmdPushConstants(const RenderContext& renderContext, CommandBuffer* commandBuffer);
+
+  inline VkShaderStageFlags   getStageFlags() const;
+  inline uint32_t             getOffset() const;
+
+protected:
+  VkShaderStageFlags          stageFlags;
+  uint32_t                    offset;
+  std::vector<uint8_t>        data;
+};
+
+template <typename T>
+void PushConstantsNode::setData(const T& d)
+{
+  setData(&d, sizeof(T));
+}
+
+VkShaderStageFlags PushConstantsNode::getStageFlags() const { return stageFlags; }
+uint32_t           PushConstantsNode::getOffset() const     { return offset; }
+
+}
@@ -55,6 +55,8 @@ public:
   inline VkPipelineBindPoint setCurrentBindPoint(VkPipelineBindPoint bindPoint);
   inline AssetBuffer*        setCurrentAssetBuffer(AssetBuffer* assetBuffer);
   inline uint32_t            setCurrentRenderMask(uint32_t renderMask);
+  // enabled state of an operation in current render graph, as seen by the surface in this frame
+  bool                       isOperationEnabled(const RenderOperation& operation) const;
 
   // elements of the context that are constant through visitor work
   Surface*                               surface                = nullptr;
@@ -197,6 +197,7 @@ public:
   ImageSize             attachmentSize;
   uint32_t              multiViewMask   = 0;
   bool                  enabled         = true;
+  bool                  sideEffects     = false; // operation with side effects is never culled by render graph compiler, even if no one uses its outputs
 
   std::map<std::string, RenderOperationEntry> inputEntries;
   std::map<std::string, RenderOperationEntry> outputEntries;
@@ -267,6 +268,8 @@ public:
   uint32_t                                                      addResourceTransitionOutput(const ResourceTransitionEntry& tran, uint32_t suggestedObjectID = 0, const std::string& externalMemoryObjectName = std::string(), VkImageLayout externalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
   // add missing resource transitions ("empty"). MUST be called before graph compilation
   void                                                          addMissingResourceTransitions();
+  // creates a copy of the graph containing only chosen operations and their transitions. Transition and object IDs stay the same
+  std::shared_ptr<RenderGraph>                                  createSubgraph(const std::set<std::string>& operationNames) const;
 
   std::vector<std::string>                                      getRenderOperationNames() const;
   const RenderOperation&                                        getRenderOperation(const std::string& opName) const;
@@ -288,6 +291,14 @@ protected:
   std::list<RenderOperation>                                    operations;
   std::vector<ResourceTransition>                               transitions;
 
+  // indices into transitions vector, so that compiler does not have to scan all transitions on every query
+  void                                                          addTransition(const ResourceTransition& transition);
+  std::vector<std::reference_wrapper<const ResourceTransition>> filterTransitions(const std::vector<std::size_t>& indices, OperationEntryTypeFlags entryTypes) const;
+  std::map<std::string, std::vector<std::size_t>>               transitionsByOperation;
+  std::map<uint32_t, std::vector<std::size_t>>                  transitionsByTID;
+  std::map<uint32_t, std::vector<std::size_t>>                  transitionsByOID;
+  std::map<uint32_t, std::size_t>                               transitionByRTEID;
+
   uint32_t                                                      generateTransitionEntryID();
   uint32_t                                                      generateTransitionID();
   uint32_t                                                      generateObjectID();
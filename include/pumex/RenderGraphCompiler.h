@@ -21,6 +21,8 @@
 //
 
 #pragma once
+#include <map>
+#include <mutex>
 #include <pumex/Export.h>
 #include <pumex/RenderGraph.h>
 #include <pumex/RenderGraphExecution.h>
@@ -28,25 +30,68 @@
 namespace pumex
 {
 
+// Estimates GPU time of operations and cost of transitions between queues. Compiler uses these values to schedule operations on queues.
+// Operation times measured on earlier frames may be reported to the model - these are used instead of estimations during next compilation
+class PUMEX_EXPORT RenderGraphCostModel
+{
+public:
+  RenderGraphCostModel() = default;
+  virtual ~RenderGraphCostModel();
+
+  virtual float getOperationCost(const RenderGraph& renderGraph, const RenderOperation& operation) const; // in milliseconds
+  virtual float getTransitionCost(const RenderGraph& renderGraph, uint32_t transitionID) const;          // paid only when transition crosses queues
+
+  void          reportOperationTime(const std::string& renderGraphName, const std::string& operationName, float milliseconds);
+  bool          getMeasuredOperationTime(const std::string& renderGraphName, const std::string& operationName, float& milliseconds) const;
+  void          clearMeasurements();
+
+  float         smoothingFactor = 0.1f; // weight of the latest measurement in exponential moving average
+protected:
+  mutable std::mutex                                   mutex;
+  std::map<std::pair<std::string, std::string>, float> measuredTimes;
+};
+
 class PUMEX_EXPORT RenderGraphCompiler
 {
 public:
-  virtual std::shared_ptr<RenderGraphExecutable> compile(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits, std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator) = 0;
+  virtual std::shared_ptr<RenderGraphExecutable> compile(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits, std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator, std::shared_ptr<RenderGraphCostModel> costModel = nullptr) = 0;
 };
 
+// Decides which consecutive graphics operations scheduled on the same queue are placed in a single render pass as subpasses :
+// - rpmNever                  : each graphics operation gets its own render pass
+// - rpmAttachmentDependencies : operations with the same attachment size and multiview mask are merged when they read results of the render pass only through attachment inputs
+// - rpmSameAttachmentSize     : all operations with the same attachment size and multiview mask are merged
+enum RenderPassMergePolicy { rpmNever, rpmAttachmentDependencies, rpmSameAttachmentSize };
+
 class PUMEX_EXPORT DefaultRenderGraphCompiler : public RenderGraphCompiler
 {
 public:
-  std::shared_ptr<RenderGraphExecutable> compile(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits, std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator) override;
+  explicit DefaultRenderGraphCompiler(RenderPassMergePolicy renderPassMergePolicy = rpmAttachmentDependencies);
+
+  // Viewer caches compiled render graphs - call Viewer::clearRenderGraphCache() after changing the policy
+  RenderPassMergePolicy renderPassMergePolicy;
+
+  std::shared_ptr<RenderGraphExecutable> compile(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits, std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator, std::shared_ptr<RenderGraphCostModel> costModel = nullptr) override;
+
+  // time spent in each stage of the last compile() call ( in milliseconds )
+  inline const std::vector<std::pair<std::string, double>>& getStageTimes() const;
 private:
+  std::vector<std::pair<std::string, double>>                             stageTimes;
+
+  std::set<std::string>                                                   findLiveOperations(const RenderGraph& renderGraph);
+  bool                                                                    canMergeWithRenderPass(const RenderGraph& renderGraph, const RenderOperation& operation, std::shared_ptr<RenderPass> renderPass);
   std::vector<std::reference_wrapper<const RenderOperation>>              calculatePartialOrdering(const RenderGraph& renderGraph);
-  std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> scheduleOperations(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, const std::vector<QueueTraits>& queueTraits);
+  std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> scheduleOperations(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, const std::vector<QueueTraits>& queueTraits, const RenderGraphCostModel& costModel);
+  void                                                                    buildQueueDependencies(const RenderGraph& renderGraph, const std::vector<std::vector<std::reference_wrapper<const RenderOperation>>>& scheduledOperations, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    buildCommandSequences(const RenderGraph& renderGraph, const std::vector<std::vector<std::reference_wrapper<const RenderOperation>>>& scheduledOperations, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    buildImageInfo(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    buildObjectViewInfo(const RenderGraph& renderGraph, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    buildFrameBuffersAndRenderPasses(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    buildPipelineBarriers(const RenderGraph& renderGraph, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    createSubpassDependency(const RenderGraph& renderGraph, const ResourceTransition& generatingTransition, std::shared_ptr<RenderCommand> generatingCommand, const ResourceTransition& consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, uint32_t generatingQueueIndex, uint32_t consumingQueueIndex, std::shared_ptr<RenderGraphExecutable> executable);
+  void                                                                    createAliasingBarriers(const RenderGraph& renderGraph, std::shared_ptr<RenderGraphExecutable> executable);
+  void                                                                    countPipelineBarriers(std::shared_ptr<RenderGraphExecutable> executable, uint32_t& callCount, uint32_t& barrierCount);
+  void                                                                    optimizePipelineBarriers(const RenderGraph& renderGraph, std::shared_ptr<RenderGraphExecutable> executable);
   void                                                                    createPipelineBarrier(const RenderGraph& renderGraph, const ResourceTransition& generatingTransition, std::shared_ptr<RenderCommand> generatingCommand, const ResourceTransition& consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, uint32_t generatingQueueIndex, uint32_t consumingQueueIndex, std::shared_ptr<RenderGraphExecutable> executable);
 };
 
@@ -54,5 +99,10 @@ PUMEX_EXPORT VkImageAspectFlags getAspectMask(AttachmentType at);
 PUMEX_EXPORT VkImageUsageFlags  getAttachmentUsage(VkImageLayout imageLayout);
 PUMEX_EXPORT void               getPipelineStageMasks(const ResourceTransition& generatingTransition, const ResourceTransition& consumingTransition, VkPipelineStageFlags& srcStageMask, VkPipelineStageFlags& dstStageMask);
 PUMEX_EXPORT void               getAccessMasks(const ResourceTransition& generatingTransition, const ResourceTransition& consumingTransition, VkAccessFlags& srcAccessMask, VkAccessFlags& dstAccessMask);
+// key built from everything that affects the result of render graph compilation. Used by Viewer to reuse previously compiled render graphs
+PUMEX_EXPORT std::string        renderGraphStructuralKey(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits);
+PUMEX_EXPORT std::size_t        renderGraphStructuralHash(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits);
+
+const std::vector<std::pair<std::string, double>>& DefaultRenderGraphCompiler::getStageTimes() const { return stageTimes; }
 
 }
@@ -21,6 +21,9 @@
 //
 
 #pragma once
+#include <set>
+#include <iosfwd>
+#include <mutex>
 #include <pumex/Export.h>
 #include <pumex/RenderGraph.h>
 #include <pumex/MemoryBuffer.h>
@@ -83,6 +86,17 @@ public:
 };
 
 
+// memory used by transient images of a render graph on a single surface
+struct PUMEX_EXPORT TransientMemoryStatistics
+{
+  VkDeviceSize separateSize = 0; // memory required when each transient image uses its own memory
+  VkDeviceSize aliasedSize  = 0; // memory required when transient images that are never used at the same time share memory
+  uint32_t     imageCount   = 0;
+
+  std::map<uint32_t, VkDeviceSize> imageSizes;   // memory required by each transient image ( indexed by object ID )
+  std::map<uint32_t, VkDeviceSize> imageOffsets; // offset of each transient image in shared memory ( images that do not share memory are absent )
+};
+
 class PUMEX_EXPORT RenderGraphExecutable
 {
 public:
@@ -91,6 +105,7 @@ public:
   std::string                                              name;
   std::vector<QueueTraits>                                 queueTraits;
   std::vector<std::vector<std::shared_ptr<RenderCommand>>> commands;
+  std::vector<std::set<uint32_t>>                          queueDependencies; // for each queue : queues that must finish their work before that queue starts
 
   std::shared_ptr<DeviceMemoryAllocator>                   frameBufferAllocator;
 
@@ -103,12 +118,17 @@ public:
   std::map<uint32_t, uint32_t>                             memoryObjectAliases;
   std::map<uint32_t, RenderGraphImageInfo>                 imageInfo;
 
+  // internal images that may share memory with other internal images. Set contains images that are used at the same time as the key image ( these may not overlap in memory )
+  std::map<uint32_t, std::set<uint32_t>>                   transientConflicts;
+  bool                                                     aliasTransientMemory = true;
+
   std::vector<RenderGraphImageViewInfo>                    imageViewInfo;
   std::map<uint32_t, std::size_t>                          imageViewInfoByRteID;
   std::vector<RenderGraphBufferViewInfo>                   bufferViewInfo;
   std::map<uint32_t, std::size_t>                          bufferViewInfoByRteID;
 
   void resizeImages(const RenderContext& renderContext, std::vector<std::shared_ptr<Image>>& swapChainImages);
+  TransientMemoryStatistics      getTransientMemoryStatistics(uint32_t surfaceID) const;
 
   void                           setExternalMemoryObjects(const RenderGraph& renderGraph, const ExternalMemoryObjects& memoryObjects);
   std::shared_ptr<MemoryImage>   getMemoryImage(const std::string& operationName, const std::string entryName) const;
@@ -125,6 +145,29 @@ public:
   VkImageLayout                  getImageLayout(const std::string& opName, uint32_t objectID, const ImageSubresourceRange& imageRange, int32_t indexAdd) const;
   std::vector<VkImageLayout>     getImageLayouts(uint32_t objectID, const ImageSubresourceRange& imageRange) const;
   std::vector<uint32_t>          getOperationParticipants(uint32_t objectID, const ImageSubresourceRange& imageRange) const;
+
+  // Disabled operation keeps its render pass, barriers and resources, but its node is not recorded. Changing the state does not require recompilation.
+  // Executable is shared by all surfaces, so enabled state is not stored in commands. Surface::validateRenderGraphs() takes a snapshot of it once per frame
+  bool                           setOperationEnabled(const std::string& operationName, bool enabled);
+  // copies enabled state of all operations from render graph. Returns names of operations that changed their state
+  std::vector<std::string>       updateOperationsEnabled(const RenderGraph& renderGraph);
+  bool                           isOperationEnabled(const std::string& operationName) const;
+  std::set<std::string>          getDisabledOperations() const;
+
+  // Dumps of compiled render graph for offline analysis : queue assignment, operation order, render passes, barriers, aliases and image layouts.
+  // renderGraph is the graph used during compilation. JSON dump also contains sizes of transient images and memory timeline for chosen surface ( available after images were resized for that surface )
+  void                           exportGraphviz(const RenderGraph& renderGraph, std::ostream& stream) const;
+  void                           exportJSON(const RenderGraph& renderGraph, uint32_t surfaceID, std::ostream& stream) const;
+protected:
+  void                           resizeTransientImages(const RenderContext& renderContext, const std::vector<uint32_t>& objectIDs, const std::vector<ImageTraits>& imageTraits);
+
+  std::map<uint32_t, TransientMemoryStatistics>            transientMemoryStatistics;
+  mutable std::mutex                                       statisticsMutex;
+  std::set<std::string>                                    disabledOperations;
+  mutable std::mutex                                       enabledMutex;
 };
+
+// assigns memory offsets to objects, so that objects being in conflict ( used at the same time ) do not overlap in memory. Returns the size of required memory
+PUMEX_EXPORT VkDeviceSize placeAliasedObjects(const std::vector<VkMemoryRequirements>& requirements, const std::vector<std::set<uint32_t>>& conflicts, std::vector<VkDeviceSize>& offsets);
 	
 }
@@ -164,6 +164,8 @@ public:
 
   std::shared_ptr<ImageView>  getImageViewByEntryName(const std::string& entryName) const;
   std::shared_ptr<BufferView> getBufferViewByEntryName(const std::string& entryName) const;
+  // secondary command buffers used when operation is recorded in parallel ( see SurfaceTraits::drawsPerSecondaryBuffer ). Buffers are created per surface, each one with its own command pool
+  std::vector<std::shared_ptr<CommandBuffer>> getParallelCommandBuffers(const RenderContext& renderContext, uint32_t queueFamilyIndex, uint32_t count);
 
   CommandType                                                          commandType;
   RenderOperation                                                      operation;
@@ -172,6 +174,15 @@ public:
   std::map<uint32_t, std::shared_ptr<BufferView>>                      bufferViews;
   std::map<MemoryObjectBarrierGroup, std::vector<MemoryObjectBarrier>> barriersBeforeOp;
   std::map<MemoryObjectBarrierGroup, std::vector<MemoryObjectBarrier>> barriersAfterOp;
+protected:
+  struct ParallelCommandBuffer
+  {
+    std::shared_ptr<CommandPool>   commandPool;
+    std::shared_ptr<CommandBuffer> commandBuffer;
+    uint32_t                       imageCount;
+  };
+  std::mutex                                                           parallelMutex;
+  std::unordered_map<uint32_t, std::vector<ParallelCommandBuffer>>     parallelCommandBuffers; // key = surface ID
 };
 
 
@@ -21,15 +21,20 @@
 //
 
 #pragma once
+#include <vector>
+#include <memory>
 #include <vulkan/vulkan.h>
 #include <pumex/Export.h>
 #include <pumex/NodeVisitor.h>
 #include <pumex/RenderContext.h>
+#include <pumex/Descriptor.h>
 
 namespace pumex
 {
 
 class CommandBuffer;
+class DescriptorSet;
+class RenderCommand;
 
 // NodeVisitor subclass that provides RenderContext for different shenanigans
 class PUMEX_EXPORT RenderContextVisitor : public NodeVisitor
@@ -72,8 +77,11 @@ public:
   ValidateDescriptorVisitor(const RenderContext& renderContext, bool buildingPrimary);
 
   void apply(Node& node) override;
+  // sends all collected descriptor writes to the driver. Must be called before command buffers using validated descriptor sets are built
+  void flush();
 
-  bool buildingPrimary;
+  bool                 buildingPrimary;
+  DescriptorWriteBatch writeBatch;
 };
 
 // Visitor that collects missing data for render contexts while building secondary command buffers
@@ -90,6 +98,74 @@ protected:
   bool           targetCompleted[CRCV_TARGETS];
 };
 
+// single command stored in a DrawList. Entry remembers render context values that were current when it was recorded
+struct PUMEX_EXPORT DrawListEntry
+{
+  enum Type { ExecuteSecondaryBuffer, BindGraphicsPipeline, BindComputePipeline, BindDescriptorSet, BindVertexIndexBuffer, PushConstants, Draw, Dispatch, Copy };
+
+  Type                type;
+  Node*               node;
+  PipelineLayout*     pipelineLayout;
+  VkPipelineBindPoint bindPoint;
+  AssetBuffer*        assetBuffer;
+  uint32_t            renderMask;
+  uint32_t            setIndex;      // used only by BindDescriptorSet
+  DescriptorSet*      descriptorSet; // used only by BindDescriptorSet
+};
+
+// range of DrawList entries [first, last) recorded into a single secondary command buffer during parallel recording
+struct PUMEX_EXPORT DrawListChunk
+{
+  size_t first;
+  size_t last;
+};
+
+// Flat list of commands generated by a node and its children. BuildCommandBufferVisitor replays this list instead of traversing
+// the node graph each time a command buffer is rebuilt. Vulkan handles are resolved during replay, so the list must be compiled again
+// only when structure of the node graph changes ( see Node::getStructureVersion() ) or when render context inherited from parents is different
+class PUMEX_EXPORT DrawList
+{
+public:
+  explicit DrawList(const RenderContext& renderContext, bool buildingPrimary);
+
+  bool                       isValid(const RenderContext& renderContext, bool buildingPrimary) const;
+  // number of draw, dispatch and copy commands - used as an estimate of recording cost
+  uint32_t                   getDrawCount() const;
+  // splits entries into chunkCount ranges with similar draw count
+  std::vector<DrawListChunk> split(uint32_t chunkCount) const;
+  // returns indices of bind commands that must be recorded before entries[position] when recording starts in a new command buffer
+  std::vector<size_t>        getStateEntries(size_t position) const;
+
+  std::vector<DrawListEntry> entries;
+  uint64_t                   structureVersion;
+  bool                       buildingPrimary;
+  PipelineLayout*            pipelineLayout;
+  VkPipelineBindPoint        bindPoint;
+  AssetBuffer*               assetBuffer;
+  uint32_t                   renderMask;
+};
+
+// Visitor that compiles DrawList. It must generate the same commands as BuildCommandBufferVisitor
+class PUMEX_EXPORT CompileDrawListVisitor : public RenderContextVisitor
+{
+public:
+  CompileDrawListVisitor(const RenderContext& renderContext, DrawList& drawList);
+
+  void apply(Node& node) override;
+  void apply(GraphicsPipeline& node) override;
+  void apply(ComputePipeline& node) override;
+  void apply(AssetBufferNode& node) override;
+  void apply(DrawNode& node) override;
+  void apply(DispatchNode& node) override;
+  void apply(CopyNode& node) override;
+  void apply(PushConstantsNode& node) override;
+
+  void applyDescriptorSets(Node& node);
+  void addEntry(DrawListEntry::Type type, Node& node, uint32_t setIndex = 0, DescriptorSet* descriptorSet = nullptr);
+
+  DrawList& drawList;
+};
+
 // Visitor that builds command buffers
 class PUMEX_EXPORT BuildCommandBufferVisitor : public RenderContextVisitor
 {
@@ -103,12 +179,31 @@ public:
   void apply(DrawNode& node) override;
   void apply(DispatchNode& node) override;
   void apply(CopyNode& node) override;
+  void apply(PushConstantsNode& node) override;
 
   void applyDescriptorSets(Node& node);
 
+  // builds commands for a node and its children. When draw lists are used ( see SurfaceTraits::useDrawLists ) node's DrawList
+  // is replayed ( and compiled when it is not valid ). Otherwise node graph is traversed
+  void                       build(Node& node);
+  // returns node's DrawList. List is compiled when it is not valid
+  std::shared_ptr<DrawList>  getDrawList(Node& node);
+  void                       replay(const DrawList& drawList);
+  // replays entries [first, last) preceded by bind commands restoring the state that was bound before entries[first]
+  void                       replay(const DrawList& drawList, size_t first, size_t last);
+
+  // splits DrawList for parallel recording ( see SurfaceTraits::drawsPerSecondaryBuffer ). Empty result means that the list should be recorded inline
+  std::vector<DrawListChunk> splitDrawList(const DrawList& drawList) const;
+  // records chunks into secondary command buffers owned by renderCommand on TBB worker threads and executes these buffers in order.
+  // Secondary buffers do not inherit dynamic state, so viewports and scissors are set at the beginning of each buffer
+  void                       recordParallel(RenderCommand& renderCommand, const DrawList& drawList, const std::vector<DrawListChunk>& chunks, VkRenderPass renderPass, uint32_t subpass, const std::vector<VkViewport>& viewports, const std::vector<VkRect2D>& scissors);
+
   // elements of the context that are constant through visitor work
   CommandBuffer* commandBuffer;
   bool           buildingPrimary;
+  bool           useDrawLists;
+protected:
+  void           replayEntry(const DrawListEntry& entry);
 };
 
 }
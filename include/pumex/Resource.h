@@ -67,6 +67,8 @@ public:
   virtual std::pair<bool,VkDescriptorType> getDefaultDescriptorType();
   virtual void                             validate(const RenderContext& renderContext) = 0;
   virtual DescriptorValue                  getDescriptorValue(const RenderContext& renderContext) = 0;
+  // offset used when resource is bound through VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC or VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC descriptor
+  virtual uint32_t                         getDynamicOffset(const RenderContext& renderContext);
 protected:
   mutable std::mutex                       mutex;
   std::vector<std::weak_ptr<Descriptor>>   descriptors;
@@ -25,7 +25,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <unordered_map>
+#include <mutex>
 #include <vulkan/vulkan.h>
 #include <pumex/Export.h>
 #include <pumex/Device.h>
@@ -47,6 +49,9 @@ class ImageView;
 class Image;
 class Node;
 class TimeStatistics;
+class QueryPool;
+class RenderCommand;
+struct BindStatistics;
 
 const uint32_t TSS_STAT_BASIC   = 1;
 const uint32_t TSS_STAT_BUFFERS = 2;
@@ -81,6 +86,11 @@ struct PUMEX_EXPORT SurfaceTraits
   VkCompositeAlphaFlagBitsKHR        compositeAlpha;
   // this variable exists so that WindowQT will not destroy surface on cleanup(), because Vulkan surface is owned by QT
   bool                               destroySurfaceOnCleanup = true;
+  // command buffers are recorded from flat draw lists compiled from node graphs. When false - node graphs are traversed during each recording
+  bool                               useDrawLists            = true;
+  // when greater than 0 - operation recorded inline that generates at least two times more draw commands is split into balanced chunks
+  // recorded in parallel into secondary command buffers ( at most one chunk per hardware thread ). Requires draw lists
+  uint32_t                           drawsPerSecondaryBuffer = 0;
 };
 
 // class representing a Vulkan surface
@@ -113,9 +123,17 @@ public:
   void                          resizeSurface(uint32_t newWidth, uint32_t newHeight);
   inline uint32_t               getImageCount() const;
   inline uint32_t               getImageIndex() const;
+  // measure GPU time of each render operation with timestamp queries and report it to Viewer::getRenderGraphCostModel()
+  // Operations belonging to the same render pass are measured together and their time is split evenly between them.
+  // Primary command buffers are rebuilt every frame, so samples are collected every frame from the frame that used the same swapchain image
+  inline void                   setOperationTimeMeasurement(bool enable);
 
   void                          addRenderGraph(const std::string& name, bool active);
   std::vector<uint32_t>         getQueueIndices(const std::string renderGraphName) const;
+  // enabled state of render graph operation in current frame
+  bool                          isOperationEnabled(const std::string& renderGraphName, const std::string& operationName) const;
+  // bind commands issued and skipped in primary command buffers recorded during last frame
+  BindStatistics                getBindStatistics() const;
   uint32_t                      getNumQueues() const;
   Queue*                        getQueue(uint32_t index) const;
   std::shared_ptr<CommandPool>  getCommandPool(uint32_t index) const;
@@ -168,8 +186,38 @@ protected:
 
   std::vector<std::tuple<std::string, bool>>    renderGraphData;
   std::map<std::string, std::vector<uint32_t>>  renderGraphQueueIndices;
+  std::map<std::string, std::weak_ptr<RenderGraphExecutable>> validatedExecutables; // executables with images sized for this surface
+  std::map<std::string, std::set<std::string>>  disabledOperations; // snapshot of disabled operations taken at the beginning of each frame
   std::map<std::string, std::vector<std::shared_ptr<CommandBuffer>>> primaryCommandBuffers;
   std::map<std::string, std::vector<VkSemaphore>> queueSubmissionCompletedSemaphores;
+  std::map<std::string, std::map<std::pair<uint32_t, uint32_t>, VkSemaphore>> queueDependencySemaphores; // semaphores between queues of the same render graph
+
+  // timestamps are written outside of render passes : all subpasses of a render pass are measured together
+  // ( timestamps are forbidden in subpasses with secondary command buffers and need one query per view in multiview subpasses )
+  struct TimedRange
+  {
+    uint32_t                                firstCommand;
+    uint32_t                                lastCommand;
+    std::vector<std::string>                operationNames;
+  };
+  struct RetiredQueryPool
+  {
+    std::shared_ptr<QueryPool>              queryPool;
+    uint64_t                                epoch;             // frame in which pool was replaced
+  };
+  struct OperationTimers
+  {
+    std::shared_ptr<QueryPool>              queryPool;
+    std::vector<RetiredQueryPool>           retiredQueryPools; // pools that may still be used by command buffers in flight
+    uint32_t                                queriesPerImage = 0;
+    std::vector<std::vector<TimedRange>>    timedRanges;       // ranges measured with each swapchain image
+  };
+  bool                                          measureOperationTimes        = false;
+  std::map<std::string, std::vector<OperationTimers>> operationTimers;
+  std::mutex                                    operationTimersMutex;
+
+  VkSemaphore                                   getQueueDependencySemaphore(const std::string& renderGraphName, uint32_t generatingQueue, uint32_t consumingQueue);
+  OperationTimers*                              prepareOperationTimers(const std::string& renderGraphName, uint32_t index, const std::vector<std::shared_ptr<RenderCommand>>& commands);
 
   std::shared_ptr<CommandBuffer>                presentCommandBuffer;
   std::vector<VkFence>                          waitFences;
@@ -196,6 +244,7 @@ bool                         Surface::isRealized() const
 uint32_t                     Surface::getID() const                                                                    { return id; }
 uint32_t                     Surface::getImageCount() const                                                            { return swapChainImageCount; }
 uint32_t                     Surface::getImageIndex() const                                                            { return swapChainImageIndex; }
+void                         Surface::setOperationTimeMeasurement(bool enable)                                         { measureOperationTimes = enable; }
 void                         Surface::setEventSurfaceRenderStart(std::function<void(std::shared_ptr<Surface>)> event)  { eventSurfaceRenderStart = event; }
 void                         Surface::setEventSurfaceRenderFinish(std::function<void(std::shared_ptr<Surface>)> event) { eventSurfaceRenderFinish = event; }
 void                         Surface::setEventSurfacePrepareStatistics(std::function<void(Surface*, TimeStatistics*, TimeStatistics*)> event) { eventSurfacePrepareStatistics = event; }
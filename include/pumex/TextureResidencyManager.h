@@ -0,0 +1,120 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <vulkan/vulkan.h>
+#if defined(GLM_ENABLE_EXPERIMENTAL) // hack around redundant GLM_ENABLE_EXPERIMENTAL defined in type.hpp
+  #undef GLM_ENABLE_EXPERIMENTAL
+  #define GLM_ENABLE_EXPERIMENTAL_HACK
+#endif
+#include <gli/texture.hpp>
+#if defined(GLM_ENABLE_EXPERIMENTAL_HACK)
+  #define GLM_ENABLE_EXPERIMENTAL
+  #undef GLM_ENABLE_EXPERIMENTAL_HACK
+#endif
+#include <pumex/Export.h>
+
+namespace pumex
+{
+
+class Device;
+class MemoryImage;
+class DeviceMemoryAllocator;
+
+// TextureResidencyManager keeps textures stored in single DeviceMemoryAllocator within memory budget.
+// Memory budget is the smallest of these values :
+//   - budget set by user ( or whole allocator size, when user did not set it )
+//   - memory left in allocator for textures
+//   - when VK_EXT_memory_budget is available : budget is decreased by the amount of memory used over heap budget reported by driver
+// Application reports texture usage ( for example from culling results of previous frame ). Viewer calls update() once per frame
+// with all realized devices when residency manager is registered with Viewer::addTextureResidencyManager(). Memory images are shared
+// between devices, so residency is the same on all devices and must fit within the budget of each of them.
+// Texture sizes are taken from memory requirements reported by device.
+// Textures that were not used recently are evicted in LRU order : whole texture ( only smallest mip level stays on GPU,
+// so that descriptors are still valid ) or only top mip levels. Textures that are used again are restored to full resolution.
+class PUMEX_EXPORT TextureResidencyManager
+{
+public:
+  enum EvictionMode { EvictWholeTexture, EvictTopMipLevels };
+
+  TextureResidencyManager()                                          = delete;
+  explicit TextureResidencyManager(std::shared_ptr<DeviceMemoryAllocator> textureAllocator, VkDeviceSize memoryBudget = 0, EvictionMode evictionMode = EvictTopMipLevels);
+  TextureResidencyManager(const TextureResidencyManager&)            = delete;
+  TextureResidencyManager& operator=(const TextureResidencyManager&) = delete;
+  TextureResidencyManager(TextureResidencyManager&&)                 = delete;
+  TextureResidencyManager& operator=(TextureResidencyManager&&)      = delete;
+  virtual ~TextureResidencyManager();
+
+  // register memory image created from full resolution texture. Returns texture id used by reportUsage()
+  uint32_t                registerTexture(std::shared_ptr<MemoryImage> memoryImage, std::shared_ptr<gli::texture> fullTexture);
+  void                    reportUsage(uint32_t textureID, unsigned long long frameNumber);
+
+  // evicts and restores textures. Call it once per frame with all devices using textures, before memory images are validated
+  void                    update(const std::vector<Device*>& devices, unsigned long long frameNumber);
+
+  // memory budget for textures on a specific device
+  VkDeviceSize            getMemoryBudget(Device* device) const;
+  VkDeviceSize            getResidentSize(Device* device) const;
+
+  void                    setMemoryBudget(VkDeviceSize budget);
+  void                    setMaxChangesPerFrame(uint32_t changes);
+  void                    setUnusedFramesThreshold(uint32_t frames);
+
+  inline EvictionMode     getEvictionMode() const;
+  uint32_t                getTextureCount() const;
+
+protected:
+  struct TextureEntry
+  {
+    TextureEntry(std::shared_ptr<MemoryImage> mi, std::shared_ptr<gli::texture> ft);
+
+    std::weak_ptr<MemoryImage>    memoryImage;
+    std::shared_ptr<gli::texture> fullTexture;
+    uint32_t                      skippedLevels = 0;
+    unsigned long long            lastUsedFrame = 0;
+    // memory size of a texture for each number of skipped mip levels, queried once per device
+    mutable std::unordered_map<VkDevice, std::vector<VkDeviceSize>> memorySizes;
+  };
+
+  std::shared_ptr<gli::texture> createReducedTexture(const gli::texture& texture, uint32_t skippedLevels) const;
+  VkDeviceSize                  getTextureSize(Device* device, const TextureEntry& entry, uint32_t skippedLevels) const;
+  VkDeviceSize                  getResidentSizeNoLock(Device* device) const;
+  uint32_t                      getMaxSkippedLevels(const TextureEntry& entry) const;
+  void                          setSkippedLevels(TextureEntry& entry, uint32_t skippedLevels);
+  VkDeviceSize                  computeMemoryBudget(Device* device, VkDeviceSize residentSize) const;
+
+  std::shared_ptr<DeviceMemoryAllocator> textureAllocator;
+  VkDeviceSize                           memoryBudget;
+  EvictionMode                           evictionMode;
+  uint32_t                               maxChangesPerFrame    = 4;
+  uint32_t                               unusedFramesThreshold = 1;
+  std::vector<TextureEntry>              textures;
+  mutable std::mutex                     mutex;
+};
+
+TextureResidencyManager::EvictionMode TextureResidencyManager::getEvictionMode() const { return evictionMode; }
+
+}
@@ -0,0 +1,119 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <vulkan/vulkan.h>
+#include <pumex/Export.h>
+
+namespace pumex
+{
+
+class Device;
+class Image;
+struct ImageTraits;
+class DeviceMemoryAllocator;
+class SharedMemoryBlock;
+
+// counters describing reuse of transient resources on a device
+struct PUMEX_EXPORT TransientResourceStatistics
+{
+  uint32_t     imageCount           = 0; // images owned by the pool ( used and free )
+  uint32_t     freeImageCount       = 0;
+  uint32_t     memoryBlockCount     = 0; // shared memory blocks owned by the pool ( used and free )
+  uint32_t     freeMemoryBlockCount = 0;
+  VkDeviceSize freeMemorySize       = 0; // memory kept alive by free images and free memory blocks
+  uint64_t     hitCount             = 0; // requests served by a resource from the pool
+  uint64_t     missCount            = 0; // requests that had to create a new resource
+  uint64_t     trimCount            = 0; // free resources released because they were not used for too long
+};
+
+// TransientResourcePool keeps images and shared memory blocks created for render graphs ( attachments, aliased transient memory ),
+// so that compatible resources may be reused across render graph recompilations, window resizes and different render graphs on the same device.
+// Images are reused when all image traits and memory allocator are the same. Memory blocks are reused when allocator and memory type
+// are the same, alignment is sufficient and the block is not more than twice as large as requested ( smallest block is chosen ).
+// Resource is free when the pool holds the only reference to it. GPU may still use it in frames in flight, so free resource
+// is reused after reuseDelay frames, or immediately when markDeviceIdle() was called after it was freed. Each surface raises reuseDelay
+// to the number of frames it may have in flight ( derived from its swapchain image count ).
+// Free resources that were not used for maxUnusedFrames frames are released.
+class PUMEX_EXPORT TransientResourcePool
+{
+public:
+  TransientResourcePool()                                        = delete;
+  explicit TransientResourcePool(Device* device, uint32_t reuseDelay = 1, uint32_t maxUnusedFrames = 120);
+  TransientResourcePool(const TransientResourcePool&)            = delete;
+  TransientResourcePool& operator=(const TransientResourcePool&) = delete;
+  TransientResourcePool(TransientResourcePool&&)                 = delete;
+  TransientResourcePool& operator=(TransientResourcePool&&)      = delete;
+  virtual ~TransientResourcePool();
+
+  // returns free image with the same traits or creates a new one. Image returns to the pool when last user releases it
+  std::shared_ptr<Image>             acquireImage(const ImageTraits& imageTraits, std::shared_ptr<DeviceMemoryAllocator> allocator);
+  // returns free memory block meeting memory requirements or creates a new one. Block returns to the pool when last user releases it
+  std::shared_ptr<SharedMemoryBlock> acquireMemoryBlock(std::shared_ptr<DeviceMemoryAllocator> allocator, const VkMemoryRequirements& memoryRequirements);
+
+  // refreshes resources that are still in use and releases free resources not used for maxUnusedFrames. Call it once per frame
+  void                               update(unsigned long long frameNumber);
+  // all resources that are free now may be reused immediately. Call it after vkDeviceWaitIdle()
+  void                               markDeviceIdle();
+  // releases all free resources
+  void                               trim();
+  // releases all resources owned by the pool ( resources still in use are released by their users )
+  void                               clear();
+
+  void                               setReuseDelay(uint32_t frames);
+  // reuse delay becomes at least frames long
+  void                               setMinimumReuseDelay(uint32_t frames);
+  void                               setMaxUnusedFrames(uint32_t frames);
+  TransientResourceStatistics        getStatistics() const;
+protected:
+  struct ImageEntry
+  {
+    std::shared_ptr<Image>                 image;
+    std::shared_ptr<DeviceMemoryAllocator> allocator;
+    unsigned long long                     lastUsedFrame;
+    bool                                   reusable;
+  };
+  struct MemoryBlockEntry
+  {
+    std::shared_ptr<SharedMemoryBlock>     memoryBlock;
+    std::shared_ptr<DeviceMemoryAllocator> allocator;
+    VkMemoryRequirements                   memoryRequirements;
+    unsigned long long                     lastUsedFrame;
+    bool                                   reusable;
+  };
+
+  bool                               isReusable(unsigned long long lastUsedFrame, bool reusable) const;
+
+  Device*                            device;
+  uint32_t                           reuseDelay;
+  uint32_t                           maxUnusedFrames;
+  unsigned long long                 frameNumber = 0;
+  std::vector<ImageEntry>            images;
+  std::vector<MemoryBlockEntry>      memoryBlocks;
+  TransientResourceStatistics        statistics;
+  mutable std::mutex                 mutex;
+};
+
+}
@@ -53,8 +53,12 @@ namespace pumex
 {
 
 class DeviceMemoryAllocator;
+struct DeviceMemoryStatistics;
+class TextureResidencyManager;
+class TextureRegistryBase;
 class ExternalMemoryObjects;
 class RenderGraphCompiler;
+class RenderGraphCostModel;
 class RenderGraph;
 class RenderGraphExecutable;
 class PhysicalDevice;
@@ -68,10 +72,12 @@ class TextureLoader;
 const uint32_t TSV_STAT_UPDATE                = 1;
 const uint32_t TSV_STAT_RENDER                = 2;
 const uint32_t TSV_STAT_RENDER_EVENTS         = 4;
+const uint32_t TSV_STAT_MEMORY                = 8;
 
 const uint32_t TSV_GROUP_UPDATE                = 1;
 const uint32_t TSV_GROUP_RENDER                = 2;
 const uint32_t TSV_GROUP_RENDER_EVENTS         = 3;
+const uint32_t TSV_GROUP_MEMORY                = 4;
 
 const uint32_t TSV_CHANNEL_INPUTEVENTS         = 1;
 const uint32_t TSV_CHANNEL_UPDATE              = 2;
@@ -79,6 +85,8 @@ const uint32_t TSV_CHANNEL_RENDER              = 3;
 const uint32_t TSV_CHANNEL_FRAME               = 4;
 const uint32_t TSV_CHANNEL_EVENT_RENDER_START  = 5;
 const uint32_t TSV_CHANNEL_EVENT_RENDER_FINISH = 6;
+// channels storing memory usage of registered allocators start from this ID. Value stored in channel is used memory in bytes
+const uint32_t TSV_CHANNEL_MEMORY              = 100;
 
 
 // struct storing all info required to create or describe the viewer
@@ -124,13 +132,32 @@ public:
   Device*                                       getDevice(uint32_t id);
   inline uint32_t                               getNumDevices() const;
 
-  inline void                                   setFrameBufferAllocator(std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator);
+  void                                          setFrameBufferAllocator(std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator);
+
+  // registry of all allocators used by the application - used to collect memory statistics. Viewer does not own registered allocators
+  void                                          registerDeviceMemoryAllocator(std::shared_ptr<DeviceMemoryAllocator> allocator);
+  void                                          unregisterDeviceMemoryAllocator(std::shared_ptr<DeviceMemoryAllocator> allocator);
+  std::vector<std::shared_ptr<DeviceMemoryAllocator>> getDeviceMemoryAllocators() const;
+  // memory statistics summed over all registered allocators for a single device
+  DeviceMemoryStatistics                        getDeviceMemoryStatistics(uint32_t deviceID) const;
+  // registered texture residency managers are updated once per frame with all realized devices. Viewer does not own registered managers
+  void                                          addTextureResidencyManager(std::shared_ptr<TextureResidencyManager> residencyManager);
+  void                                          removeTextureResidencyManager(std::shared_ptr<TextureResidencyManager> residencyManager);
+  // registered texture registries are updated once per frame ( MaterialSet registers its texture registry ). Viewer does not own registered registries
+  void                                          addTextureRegistry(std::shared_ptr<TextureRegistryBase> textureRegistry);
   inline void                                   setRenderGraphCompiler( std::shared_ptr<RenderGraphCompiler> renderGraphCompiler);
   inline void                                   setExternalMemoryObjects(std::shared_ptr<ExternalMemoryObjects> externalMemoryObjects);
   inline std::shared_ptr<ExternalMemoryObjects> getExternalMemoryObjects() const;
+  // cost model used to schedule operations on queues. Surfaces report measured operation times to it when Surface::setOperationTimeMeasurement(true) is used
+  inline void                                   setRenderGraphCostModel(std::shared_ptr<RenderGraphCostModel> costModel);
+  inline std::shared_ptr<RenderGraphCostModel>  getRenderGraphCostModel() const;
+  // compiles render graph or reuses previously compiled render graph with the same structure. Replaces render graph with the same name
   void                                          compileRenderGraph(std::shared_ptr<RenderGraph> renderGraph, const std::vector<QueueTraits>& queueTraits);
   std::shared_ptr<RenderGraphExecutable>        getRenderGraphExecutable(const std::string& name) const;
-  const std::vector<QueueTraits>&               getRenderGraphQueueTraits(const std::string& name) const;
+  void                                          clearRenderGraphCache();
+  // maximum number of compiled render graphs kept in cache. Least recently used render graphs are removed first
+  void                                          setRenderGraphCacheSize(uint32_t cacheSize);
+  std::vector<QueueTraits>                      getRenderGraphQueueTraits(const std::string& name) const;
 
   inline void                                   setEventRenderStart(std::function<void(Viewer*)> event);
   inline void                                   setEventRenderFinish(std::function<void(Viewer*)> event);
@@ -177,6 +204,7 @@ public:
   // extension : VK_KHR_get_physical_device_properties2
   PFN_vkGetPhysicalDeviceProperties2                                      pfn_vkGetPhysicalDeviceProperties2 = nullptr;
   PFN_vkGetPhysicalDeviceFeatures2                                        pfn_vkGetPhysicalDeviceFeatures2   = nullptr;
+  PFN_vkGetPhysicalDeviceMemoryProperties2                                pfn_vkGetPhysicalDeviceMemoryProperties2 = nullptr;
 
   // extension : VK_EXT_debug_report ( initialized by setting requestedDebugLayers in viewerTraits )
   PFN_vkCreateDebugReportCallbackEXT                                      pfn_vkCreateDebugReportCallback     = nullptr;
@@ -197,6 +225,10 @@ protected:
   void                       handleInputEvents();
 
   void                       buildExecutionFlowGraph();
+  void                       collectMemoryStatistics();
+  void                       updateTextureResidency();
+  void                       updateTextureRegistries();
+  void                       trimRenderGraphCache(); // renderGraphMutex must be locked
 
   ViewerTraits                                                            viewerTraits;
   
@@ -213,9 +245,18 @@ protected:
   std::unordered_map<uint32_t, std::shared_ptr<Surface>>                  surfaces;
 
   std::shared_ptr<DeviceMemoryAllocator>                                  frameBufferAllocator;
+  std::vector<std::pair<std::weak_ptr<DeviceMemoryAllocator>, uint32_t>>  deviceMemoryAllocators; // allocator and its statistics channel
+  uint32_t                                                                nextMemoryChannelID      = TSV_CHANNEL_MEMORY;
+  std::vector<std::weak_ptr<TextureResidencyManager>>                     textureResidencyManagers;
+  std::vector<std::weak_ptr<TextureRegistryBase>>                         textureRegistries;
   std::shared_ptr<RenderGraphCompiler>                                    renderGraphCompiler;
+  std::shared_ptr<RenderGraphCostModel>                                   renderGraphCostModel;
   std::shared_ptr<ExternalMemoryObjects>                                  externalMemoryObjects;
   std::unordered_map<std::string, std::shared_ptr<RenderGraphExecutable>> renderGraphs;
+  std::unordered_map<std::string, std::pair<std::shared_ptr<RenderGraphExecutable>, uint64_t>> renderGraphCache; // compiled render graphs indexed by structural key, with the time of last use
+  uint32_t                                                                renderGraphCacheSize     = 16;
+  uint64_t                                                                renderGraphCacheTime     = 0;
+  mutable std::mutex                                                      renderGraphMutex;
   std::unordered_map<std::string, std::vector<QueueTraits>>               queueTraits;
 
   std::function<void(Viewer*)>                                            eventRenderStart;
@@ -248,6 +289,7 @@ protected:
 
   mutable std::mutex                                                      renderMutex;
   mutable std::mutex                                                      updateMutex;
+  mutable std::mutex                                                      allocatorMutex;
   std::condition_variable                                                 updateConditionVariable;
 
   VkDebugReportCallbackEXT                                                msgCallback;
@@ -281,10 +323,11 @@ void                                   Viewer::setAssetTextureRename(const std::
 void                                   Viewer::clearAssetTextureRename()       { regexRule.clear(); regexReplacement.clear(); }
 
 void                                   Viewer::doNothing() const               {}
-void                                   Viewer::setFrameBufferAllocator(std::shared_ptr<DeviceMemoryAllocator> fba)   { frameBufferAllocator = fba; }
 void                                   Viewer::setRenderGraphCompiler(std::shared_ptr<RenderGraphCompiler> compiler) { renderGraphCompiler = compiler; }
 void                                   Viewer::setExternalMemoryObjects(std::shared_ptr<ExternalMemoryObjects> emo)  { externalMemoryObjects = emo; }
 std::shared_ptr<ExternalMemoryObjects> Viewer::getExternalMemoryObjects() const { return externalMemoryObjects;  }
+void                                   Viewer::setRenderGraphCostModel(std::shared_ptr<RenderGraphCostModel> cm) { renderGraphCostModel = cm; }
+std::shared_ptr<RenderGraphCostModel>  Viewer::getRenderGraphCostModel() const { return renderGraphCostModel; }
 void                                   Viewer::setEventRenderStart(std::function<void(Viewer*)> event)               { eventRenderStart = event; }
 void                                   Viewer::setEventRenderFinish(std::function<void(Viewer*)> event)              { eventRenderFinish = event; }
 
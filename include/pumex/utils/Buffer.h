@@ -23,6 +23,7 @@
 #pragma once
 #include <memory>
 #include <vector>
+#include <deque>
 #include <vulkan/vulkan.h>
 #include <pumex/Export.h>
 
@@ -92,6 +93,66 @@ VkDeviceSize StagingBuffer::bufferSize() const { return memorySize; }
 bool         StagingBuffer::isReserved() const { return reserved; }
 void         StagingBuffer::setReserved(bool value) { reserved = value; }
 
+// part of staging memory handed out by Device::acquireStagingMemory()
+struct StagingAllocation
+{
+  VkBuffer                       buffer     = VK_NULL_HANDLE;
+  VkDeviceSize                   offset     = 0;
+  VkDeviceSize                   size       = 0;
+  void*                          mappedData = nullptr;
+  // dedicated staging buffer used when allocation did not fit into staging ring
+  std::shared_ptr<StagingBuffer> overflowBuffer;
+};
+
+// large, persistently mapped staging buffer suballocated in a ring fashion.
+// Each allocation belongs to an owner ( command buffer that copies data from it ) and is reclaimed when owner releases it,
+// after the fence of its submission completes. Allocations are reclaimed in the same order as they were made.
+class StagingRingBuffer
+{
+public:
+  StagingRingBuffer()                                    = delete;
+  explicit StagingRingBuffer(Device* device, VkDeviceSize size);
+  StagingRingBuffer(const StagingRingBuffer&)            = delete;
+  StagingRingBuffer& operator=(const StagingRingBuffer&) = delete;
+  StagingRingBuffer(StagingRingBuffer&&)                 = delete;
+  StagingRingBuffer& operator=(StagingRingBuffer&&)      = delete;
+  virtual ~StagingRingBuffer();
+
+  // returns false when there's not enough free space in a ring
+  bool                allocate(const void* owner, VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation);
+  // mark all allocations made by owner as reclaimable
+  void                release(const void* owner);
+  // true when ring contains allocations of other owners that may be released in the future
+  bool                hasPendingAllocations(const void* owner) const;
+
+  inline VkDeviceSize bufferSize() const;
+  inline VkDeviceSize usedSize() const;
+  inline uint32_t     allocationCount() const;
+
+  VkBuffer       buffer     = VK_NULL_HANDLE;
+protected:
+  struct Region
+  {
+    const void*  owner;
+    VkDeviceSize begin;
+    VkDeviceSize end;
+    bool         released;
+  };
+  void           reclaim();
+
+  VkDevice           device     = VK_NULL_HANDLE;
+  VkDeviceMemory     memory     = VK_NULL_HANDLE;
+  VkDeviceSize       memorySize = 0;
+  unsigned char*     mappedData = nullptr;
+  VkDeviceSize       head       = 0;
+  VkDeviceSize       used       = 0;
+  std::deque<Region> regions;
+};
+
+VkDeviceSize StagingRingBuffer::bufferSize() const      { return memorySize; }
+VkDeviceSize StagingRingBuffer::usedSize() const        { return used; }
+uint32_t     StagingRingBuffer::allocationCount() const { return static_cast<uint32_t>(regions.size()); }
+
 
 
-}
+}
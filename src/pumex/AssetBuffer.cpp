@@ -221,9 +221,8 @@ void AssetBuffer::cmdBindVertexIndexBuffer(const RenderContext& renderContext, C
   }
   VkBuffer vBuffer = prmit->second.vertexBuffer->getHandleBuffer(renderContext);
   VkBuffer iBuffer = prmit->second.indexBuffer->getHandleBuffer(renderContext);
-  VkDeviceSize offsets = 0;
-  vkCmdBindVertexBuffers(commandBuffer->getHandle(), vertexBinding, 1, &vBuffer, &offsets);
-  vkCmdBindIndexBuffer(commandBuffer->getHandle(), iBuffer, 0, VK_INDEX_TYPE_UINT32);
+  commandBuffer->cmdBindVertexBuffer(vertexBinding, vBuffer);
+  commandBuffer->cmdBindIndexBuffer(iBuffer);
 }
 
 void AssetBuffer::cmdDrawObject(const RenderContext& renderContext, CommandBuffer* commandBuffer, uint32_t renderMask, uint32_t typeID, uint32_t firstInstance, float distanceToViewer) const
@@ -276,6 +275,18 @@ void AssetBuffer::cmdDrawObjectsIndirect(const RenderContext& renderContext, Com
   }
 }
 
+void AssetBuffer::cmdDrawObjectsIndirectCount(const RenderContext& renderContext, CommandBuffer* commandBuffer, std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> drawCommands, std::shared_ptr<Buffer<uint32_t>> drawCount)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto buffer      = drawCommands->getHandleBuffer(renderContext);
+  auto countBuffer = drawCount->getHandleBuffer(renderContext);
+
+  uint32_t maxDrawCount = drawCommands->getData()->size();
+
+  commandBuffer->cmdDrawIndexedIndirectCount(renderContext, buffer, 0, countBuffer, 0, maxDrawCount, sizeof(DrawIndexedIndirectCommand));
+}
+
 std::shared_ptr<Buffer<std::vector<AssetTypeDefinition>>> AssetBuffer::getTypeBuffer(uint32_t renderMask)
 {
   std::lock_guard<std::mutex> lock(mutex);
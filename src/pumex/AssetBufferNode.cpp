@@ -24,6 +24,9 @@
 #include <pumex/NodeVisitor.h>
 #include <pumex/MaterialSet.h>
 #include <pumex/Descriptor.h>
+#include <pumex/StorageBuffer.h>
+#include <pumex/Device.h>
+#include <pumex/RenderContext.h>
 #include <pumex/utils/Log.h>
 
 using namespace pumex;
@@ -58,12 +61,12 @@ void AssetBufferNode::validate(const RenderContext& renderContext)
     notifyCommandBuffers();
 }
 
-AssetBufferFilterNode::AssetBufferFilterNode(std::shared_ptr<AssetBuffer> ab, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator)
+AssetBufferFilterNode::AssetBufferFilterNode(std::shared_ptr<AssetBuffer> ab, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator, bool useDrawCount)
   : assetBuffer{ ab }
 {
   auto masks = assetBuffer->getRenderMasks();
   for (const auto& m : masks)
-    perRenderMaskData[m] = PerRenderMaskData(buffersAllocator);
+    perRenderMaskData[m] = PerRenderMaskData(buffersAllocator, useDrawCount);
 }
 
 void AssetBufferFilterNode::accept(NodeVisitor& visitor)
@@ -89,7 +92,14 @@ void AssetBufferFilterNode::validate(const RenderContext& renderContext)
     needNotify |= assetBuffer->validate(renderContext);
 
   for (auto& prm : perRenderMaskData)
+  {
     prm.second.drawIndexedIndirectBuffer->validate(renderContext);
+    if (prm.second.drawCountBuffer != nullptr)
+    {
+      prm.second.compactedDrawIndexedIndirectBuffer->validate(renderContext);
+      prm.second.drawCountBuffer->validate(renderContext);
+    }
+  }
 
   if (needNotify)
     notifyCommandBuffers();
@@ -118,6 +128,8 @@ void AssetBufferFilterNode::setTypeCount(const std::vector<size_t>& tc)
       (*rmData.drawIndexedIndirectCommands)[i].firstInstance = tmp;
     }
     rmData.drawIndexedIndirectBuffer->invalidateData();
+    if (rmData.compactedDrawIndexedIndirectBuffer != nullptr)
+      rmData.compactedDrawIndexedIndirectBuffer->invalidateData();
     rmData.maxOutputObjects = offsetSum;
 
     onEventResizeOutputs(prm.first, rmData.maxOutputObjects);
@@ -133,6 +145,22 @@ std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> AssetBufferFilt
   return it->second.drawIndexedIndirectBuffer;
 }
 
+std::shared_ptr<Buffer<std::vector<DrawIndexedIndirectCommand>>> AssetBufferFilterNode::getCompactedDrawIndexedIndirectBuffer(uint32_t renderMask)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = perRenderMaskData.find(renderMask);
+  CHECK_LOG_THROW(it == std::end(perRenderMaskData), "AssetBufferFilterNode::getCompactedDrawIndexedIndirectBuffer() attempting to get a buffer for nonexisting render mask");
+  return it->second.compactedDrawIndexedIndirectBuffer;
+}
+
+std::shared_ptr<Buffer<uint32_t>> AssetBufferFilterNode::getDrawCountBuffer(uint32_t renderMask)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = perRenderMaskData.find(renderMask);
+  CHECK_LOG_THROW(it == std::end(perRenderMaskData), "AssetBufferFilterNode::getDrawCountBuffer() attempting to get a buffer for nonexisting render mask");
+  return it->second.drawCountBuffer;
+}
+
 size_t AssetBufferFilterNode::getMaxOutputObjects(uint32_t renderMask)
 {
   std::lock_guard<std::mutex> lock(mutex);
@@ -149,13 +177,81 @@ uint32_t AssetBufferFilterNode::getDrawCount(uint32_t renderMask)
   return it->second.drawIndexedIndirectCommands->size();
 }
 
-AssetBufferFilterNode::PerRenderMaskData::PerRenderMaskData(std::shared_ptr<DeviceMemoryAllocator> allocator)
+void AssetBufferFilterNode::attachCompaction(uint32_t renderMask)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = perRenderMaskData.find(renderMask);
+  CHECK_LOG_THROW(it == std::end(perRenderMaskData), "AssetBufferFilterNode::attachCompaction() attempting to attach compaction for nonexisting render mask");
+  CHECK_LOG_THROW(it->second.drawCountBuffer == nullptr, "AssetBufferFilterNode::attachCompaction() filter node was created without draw count");
+  it->second.compactionAttached = true;
+}
+
+bool AssetBufferFilterNode::hasCompaction(uint32_t renderMask)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = perRenderMaskData.find(renderMask);
+  CHECK_LOG_THROW(it == std::end(perRenderMaskData), "AssetBufferFilterNode::hasCompaction() attempting to check compaction for nonexisting render mask");
+  return it->second.compactionAttached;
+}
+
+AssetBufferFilterNode::PerRenderMaskData::PerRenderMaskData(std::shared_ptr<DeviceMemoryAllocator> allocator, bool useDrawCount)
 {
   drawIndexedIndirectCommands = std::make_shared<std::vector<DrawIndexedIndirectCommand>>();
   drawIndexedIndirectBuffer   = std::make_shared<Buffer<std::vector<DrawIndexedIndirectCommand>>>(drawIndexedIndirectCommands, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, pbPerSurface, swForEachImage);
+  if (useDrawCount)
+  {
+    // compacted buffer uses the same data only to have the same size as drawIndexedIndirectBuffer - its content is written by compaction shader
+    compactedDrawIndexedIndirectBuffer = std::make_shared<Buffer<std::vector<DrawIndexedIndirectCommand>>>(drawIndexedIndirectCommands, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, pbPerSurface, swForEachImage);
+    drawCount                          = std::make_shared<uint32_t>(0);
+    // draw count is reset with vkCmdFillBuffer() by AssetBufferCompactionNode
+    drawCountBuffer                    = std::make_shared<Buffer<uint32_t>>(drawCount, allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, pbPerSurface, swForEachImage);
+  }
   maxOutputObjects            = 0;
 }
 
+AssetBufferCompactionNode::AssetBufferCompactionNode(std::shared_ptr<AssetBufferFilterNode> fn, uint32_t rm)
+  : DispatchNode(0, 1, 1), renderMask{ rm }, filterNode{ fn }, drawCommands{ fn->getDrawIndexedIndirectBuffer(rm) }, drawCount{ fn->getDrawCountBuffer(rm) }
+{
+  filterNode->attachCompaction(renderMask);
+}
+
+std::shared_ptr<DescriptorSetLayout> AssetBufferCompactionNode::createDescriptorSetLayout()
+{
+  std::vector<DescriptorSetLayoutBinding> layoutBindings =
+  {
+    { 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT },
+    { 2, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT }
+  };
+  return std::make_shared<DescriptorSetLayout>(layoutBindings);
+}
+
+std::shared_ptr<DescriptorSet> AssetBufferCompactionNode::createDescriptorSet(std::shared_ptr<DescriptorPool> descriptorPool, std::shared_ptr<DescriptorSetLayout> descriptorSetLayout) const
+{
+  auto descriptorSet = std::make_shared<DescriptorSet>(descriptorPool, descriptorSetLayout);
+  descriptorSet->setDescriptor(0, std::make_shared<StorageBuffer>(drawCommands));
+  descriptorSet->setDescriptor(1, std::make_shared<StorageBuffer>(filterNode->getCompactedDrawIndexedIndirectBuffer(renderMask)));
+  descriptorSet->setDescriptor(2, std::make_shared<StorageBuffer>(drawCount));
+  return descriptorSet;
+}
+
+void AssetBufferCompactionNode::cmdDispatch(const RenderContext& renderContext, CommandBuffer* commandBuffer)
+{
+  // draw count is reset on GPU, so that every submission of this command buffer starts counting from 0
+  VkBuffer countBuffer    = drawCount->getHandleBuffer(renderContext);
+  VkBuffer filteredBuffer = drawCommands->getHandleBuffer(renderContext);
+  commandBuffer->cmdFillBuffer(countBuffer, 0, VK_WHOLE_SIZE, 0);
+
+  // compaction must see the results of instance filtering and the reset draw count
+  std::vector<PipelineBarrier> barriers;
+  barriers.emplace_back(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, countBuffer, 0, VK_WHOLE_SIZE);
+  barriers.emplace_back(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, filteredBuffer, 0, VK_WHOLE_SIZE);
+  commandBuffer->cmdPipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, barriers);
+
+  // shaders/compact_draw_commands.comp uses local_size_x = 64
+  commandBuffer->cmdDispatch((filterNode->getDrawCount(renderMask) + 63) / 64, 1, 1);
+}
+
 AssetBufferDrawObject::AssetBufferDrawObject(uint32_t tid, uint32_t fi)
   : typeID{ tid }, firstInstance{ fi }
 {
@@ -179,8 +275,8 @@ float AssetBufferDrawObject::getDistanceToViewer() const
   return 10.0f;
 }
 
-AssetBufferIndirectDrawObjects::AssetBufferIndirectDrawObjects(std::shared_ptr<AssetBufferFilterNode> filterNode, uint32_t rm)
-  : renderMask{ rm }, drawCommands{ filterNode->getDrawIndexedIndirectBuffer(rm) }
+AssetBufferIndirectDrawObjects::AssetBufferIndirectDrawObjects(std::shared_ptr<AssetBufferFilterNode> fn, uint32_t rm)
+  : renderMask{ rm }, filterNode{ fn }, drawCommands{ fn->getDrawIndexedIndirectBuffer(rm) }, compactedDrawCommands{ fn->getCompactedDrawIndexedIndirectBuffer(rm) }, drawCount{ fn->getDrawCountBuffer(rm) }
 {
 
 }
@@ -190,14 +286,28 @@ void AssetBufferIndirectDrawObjects::validate(const RenderContext& renderContext
   if (!registered)
   {
     drawCommands->addCommandBufferSource(shared_from_this());
+    if (drawCount != nullptr)
+    {
+      compactedDrawCommands->addCommandBufferSource(shared_from_this());
+      drawCount->addCommandBufferSource(shared_from_this());
+    }
     registered = true;
   }
   drawCommands->validate(renderContext);
+  if (drawCount != nullptr)
+  {
+    compactedDrawCommands->validate(renderContext);
+    drawCount->validate(renderContext);
+  }
 }
 
 void AssetBufferIndirectDrawObjects::cmdDraw(const RenderContext& renderContext, CommandBuffer* commandBuffer)
 {
   if (renderContext.currentAssetBuffer == nullptr)
     return;
-  renderContext.currentAssetBuffer->cmdDrawObjectsIndirect(renderContext, commandBuffer, drawCommands);
+  // empty draw commands are skipped by GPU when compaction fills draw count
+  if (drawCount != nullptr && renderContext.device->enableDrawIndirectCount && filterNode->hasCompaction(renderMask))
+    renderContext.currentAssetBuffer->cmdDrawObjectsIndirectCount(renderContext, commandBuffer, compactedDrawCommands, drawCount);
+  else
+    renderContext.currentAssetBuffer->cmdDrawObjectsIndirect(renderContext, commandBuffer, drawCommands);
 }
@@ -89,8 +89,7 @@ void AssetNode::cmdDraw(const RenderContext& renderContext, CommandBuffer* comma
   commandBuffer->addSource(this);
   VkBuffer vBuffer = vertexBuffer->getHandleBuffer(renderContext);
   VkBuffer iBuffer = indexBuffer->getHandleBuffer(renderContext);
-  VkDeviceSize offsets = 0;
-  vkCmdBindVertexBuffers(commandBuffer->getHandle(), vertexBinding, 1, &vBuffer, &offsets);
-  vkCmdBindIndexBuffer(commandBuffer->getHandle(), iBuffer, 0, VK_INDEX_TYPE_UINT32);
+  commandBuffer->cmdBindVertexBuffer(vertexBinding, vBuffer);
+  commandBuffer->cmdBindIndexBuffer(iBuffer);
   commandBuffer->cmdDrawIndexed(indices->size(), 1, 0, 0, 0);
 }
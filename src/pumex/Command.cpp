@@ -30,7 +30,8 @@
 #include <pumex/Descriptor.h>
 #include <pumex/Pipeline.h>
 #include <pumex/MemoryObjectBarrier.h>
-#include <pumex/utils/Log.h>
+#include <pumex/utils/Log.h>
+#include <algorithm>
 
 using namespace pumex;
 
@@ -119,6 +120,9 @@ VkCommandBuffer CommandBuffer::getHandle() const
 void CommandBuffer::cmdBegin(VkCommandBufferUsageFlags usageFlags, VkRenderPass renderPass, uint32_t subPass)
 {
   clearSources();
+  // no state is bound at the beginning of a command buffer
+  boundState     = BoundState();
+  bindStatistics = BindStatistics();
   VkCommandBufferBeginInfo cmdBufInfo{};
     cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     cmdBufInfo.flags = usageFlags;
@@ -295,36 +299,133 @@ void CommandBuffer::cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const
   vkCmdCopyBuffer(commandBuffer[activeIndex], srcBuffer, dstBuffer, 1, &bufferCopy);
 }
 
+void CommandBuffer::cmdFillBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size, uint32_t data) const
+{
+  vkCmdFillBuffer(commandBuffer[activeIndex], dstBuffer, dstOffset, size, data);
+}
+
 void CommandBuffer::cmdBindPipeline(const RenderContext& renderContext, ComputePipeline* pipeline)
 {
   addSource(pipeline);
-  vkCmdBindPipeline(commandBuffer[activeIndex], VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getHandlePipeline(renderContext));
+  VkPipeline handle = pipeline->getHandlePipeline(renderContext);
+  if (bindFiltering && boundState.pipeline[1] == handle)
+  {
+    bindStatistics.pipelinesSkipped++;
+    return;
+  }
+  boundState.pipeline[1] = handle;
+  bindStatistics.pipelinesIssued++;
+  vkCmdBindPipeline(commandBuffer[activeIndex], VK_PIPELINE_BIND_POINT_COMPUTE, handle);
 }
 
 void CommandBuffer::cmdBindPipeline(const RenderContext& renderContext, GraphicsPipeline* pipeline)
 {
   addSource(pipeline);
-  vkCmdBindPipeline(commandBuffer[activeIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getHandlePipeline(renderContext));
+  VkPipeline handle = pipeline->getHandlePipeline(renderContext);
+  if (bindFiltering && boundState.pipeline[0] == handle)
+  {
+    bindStatistics.pipelinesSkipped++;
+    return;
+  }
+  boundState.pipeline[0] = handle;
+  bindStatistics.pipelinesIssued++;
+  vkCmdBindPipeline(commandBuffer[activeIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, handle);
 }
 
 void CommandBuffer::cmdBindDescriptorSets(const RenderContext& renderContext, PipelineLayout* pipelineLayout, uint32_t firstSet, const std::vector<DescriptorSet*> descriptorSets)
 {
-  std::vector<VkDescriptorSet> descSets;
-  for (auto& d : descriptorSets)
+  std::vector<VkDescriptorSet>       descSets;
+  std::vector<std::vector<uint32_t>> descOffsets(descriptorSets.size());
+  for (uint32_t i = 0; i < descriptorSets.size(); ++i)
+  {
+    addSource(descriptorSets[i]);
+    descSets.push_back(descriptorSets[i]->getHandle(renderContext));
+    descriptorSets[i]->getDynamicOffsets(renderContext, descOffsets[i]);
+  }
+  VkPipelineLayout layoutHandle = pipelineLayout->getHandle(device);
+  if (bindDescriptorSets(renderContext.currentBindPoint, layoutHandle, firstSet, descSets, descOffsets))
   {
-    addSource(d);
-    descSets.push_back(d->getHandle(renderContext));
+    bindStatistics.descriptorSetsSkipped += descSets.size();
+    return;
   }
-  // TODO : dynamic offset counts
-  vkCmdBindDescriptorSets(commandBuffer[activeIndex], renderContext.currentBindPoint, pipelineLayout->getHandle(device), firstSet, descSets.size(), descSets.data(), 0, nullptr);
+  bindStatistics.descriptorSetsIssued += descSets.size();
+  std::vector<uint32_t> dynamicOffsets;
+  for (const auto& offsets : descOffsets)
+    dynamicOffsets.insert(end(dynamicOffsets), begin(offsets), end(offsets));
+  vkCmdBindDescriptorSets(commandBuffer[activeIndex], renderContext.currentBindPoint, layoutHandle, firstSet, descSets.size(), descSets.data(), dynamicOffsets.size(), dynamicOffsets.data());
 }
 
 void CommandBuffer::cmdBindDescriptorSets(const RenderContext& renderContext, PipelineLayout* pipelineLayout, uint32_t firstSet, DescriptorSet* descriptorSet)
 {
   addSource(descriptorSet);
   VkDescriptorSet descSet = descriptorSet->getHandle(renderContext);
-  // TODO : dynamic offset counts
-  vkCmdBindDescriptorSets(commandBuffer[activeIndex], renderContext.currentBindPoint, pipelineLayout->getHandle(device), firstSet, 1, &descSet, 0, nullptr);
+  std::vector<uint32_t> dynamicOffsets;
+  descriptorSet->getDynamicOffsets(renderContext, dynamicOffsets);
+  VkPipelineLayout layoutHandle = pipelineLayout->getHandle(device);
+  if (bindDescriptorSets(renderContext.currentBindPoint, layoutHandle, firstSet, { descSet }, { dynamicOffsets }))
+  {
+    bindStatistics.descriptorSetsSkipped++;
+    return;
+  }
+  bindStatistics.descriptorSetsIssued++;
+  vkCmdBindDescriptorSets(commandBuffer[activeIndex], renderContext.currentBindPoint, layoutHandle, firstSet, 1, &descSet, dynamicOffsets.size(), dynamicOffsets.data());
+}
+
+void CommandBuffer::cmdPushConstants(PipelineLayout* pipelineLayout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* values) const
+{
+  vkCmdPushConstants(commandBuffer[activeIndex], pipelineLayout->getHandle(device), stageFlags, offset, size, values);
+}
+
+void CommandBuffer::cmdBindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset)
+{
+  if (boundState.vertexBuffers.size() <= binding)
+    boundState.vertexBuffers.resize(binding + 1, { VK_NULL_HANDLE, 0 });
+  if (bindFiltering && boundState.vertexBuffers[binding].first == buffer && boundState.vertexBuffers[binding].second == offset)
+  {
+    bindStatistics.vertexBuffersSkipped++;
+    return;
+  }
+  boundState.vertexBuffers[binding] = { buffer, offset };
+  bindStatistics.vertexBuffersIssued++;
+  vkCmdBindVertexBuffers(commandBuffer[activeIndex], binding, 1, &buffer, &offset);
+}
+
+void CommandBuffer::cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+  if (bindFiltering && boundState.indexBuffer == buffer && boundState.indexOffset == offset && boundState.indexType == indexType)
+  {
+    bindStatistics.indexBuffersSkipped++;
+    return;
+  }
+  boundState.indexBuffer = buffer;
+  boundState.indexOffset = offset;
+  boundState.indexType   = indexType;
+  bindStatistics.indexBuffersIssued++;
+  vkCmdBindIndexBuffer(commandBuffer[activeIndex], buffer, offset, indexType);
+}
+
+bool CommandBuffer::bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t firstSet, const std::vector<VkDescriptorSet>& descriptorSets, const std::vector<std::vector<uint32_t>>& dynamicOffsets)
+{
+  uint32_t bpIndex    = (bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) ? 1 : 0;
+  auto& boundSets     = boundState.descriptorSets[bpIndex];
+  auto& boundOffsets  = boundState.dynamicOffsets[bpIndex];
+  // sets bound with different pipeline layout may be disturbed, so we forget them
+  if (boundState.pipelineLayout[bpIndex] != pipelineLayout)
+  {
+    boundState.pipelineLayout[bpIndex] = pipelineLayout;
+    boundSets.clear();
+    boundOffsets.clear();
+  }
+  else if (bindFiltering && firstSet + descriptorSets.size() <= boundSets.size() && std::equal(begin(descriptorSets), end(descriptorSets), begin(boundSets) + firstSet) && std::equal(begin(dynamicOffsets), end(dynamicOffsets), begin(boundOffsets) + firstSet))
+    return true;
+  if (boundSets.size() < firstSet + descriptorSets.size())
+  {
+    boundSets.resize(firstSet + descriptorSets.size(), VK_NULL_HANDLE);
+    boundOffsets.resize(firstSet + descriptorSets.size());
+  }
+  std::copy(begin(descriptorSets), end(descriptorSets), begin(boundSets) + firstSet);
+  std::copy(begin(dynamicOffsets), end(dynamicOffsets), begin(boundOffsets) + firstSet);
+  return false;
 }
 
 void CommandBuffer::cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t vertexOffset, uint32_t firstInstance) const
@@ -342,6 +443,11 @@ void CommandBuffer::cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset,
   vkCmdDrawIndexedIndirect(commandBuffer[activeIndex], buffer, offset, drawCount, stride);
 }
 
+void CommandBuffer::cmdDrawIndexedIndirectCount(const RenderContext& renderContext, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) const
+{
+  renderContext.device->cmdDrawIndexedIndirectCount(commandBuffer[activeIndex], buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
 void CommandBuffer::cmdDispatch(uint32_t x, uint32_t y, uint32_t z) const
 {
   vkCmdDispatch(commandBuffer[activeIndex], x, y, z);
@@ -515,6 +621,8 @@ void CommandBuffer::executeCommandBuffer(const RenderContext& renderContext, Com
 {
   VkCommandBuffer secBuffer = secondaryBuffer->getHandle();
   vkCmdExecuteCommands(commandBuffer[activeIndex], 1, &secBuffer);
+  // bound state is undefined after secondary command buffer execution
+  boundState = BoundState();
 }
 
 void CommandBuffer::queueSubmit(VkQueue queue, const std::vector<VkSemaphore>& waitSemaphores, const std::vector<VkPipelineStageFlags>& waitStages, const std::vector<VkSemaphore>& signalSemaphores, VkFence fence ) const
@@ -23,6 +23,7 @@
 #include <pumex/Descriptor.h>
 #include <map>
 #include <algorithm>
+#include <cstddef>
 #include <pumex/Device.h>
 #include <pumex/Surface.h>
 #include <pumex/Viewer.h>
@@ -33,8 +34,8 @@
 
 using namespace pumex;
 
-DescriptorSetLayoutBinding::DescriptorSetLayoutBinding(uint32_t b, uint32_t bc, VkDescriptorType dt, VkShaderStageFlags sf)
-  : binding{ b }, bindingCount{ bc }, descriptorType{ dt }, stageFlags{ sf }
+DescriptorSetLayoutBinding::DescriptorSetLayoutBinding(uint32_t b, uint32_t bc, VkDescriptorType dt, VkShaderStageFlags sf, VkDescriptorBindingFlagsEXT bf)
+  : binding{ b }, bindingCount{ bc }, descriptorType{ dt }, stageFlags{ sf }, bindingFlags{ bf }
 {
 }
 
@@ -45,7 +46,7 @@ std::size_t computeHash(const std::vector<DescriptorSetLayoutBinding> layoutBind
   std::size_t seed = 0;
   for (auto& v : layoutBindings)
   {
-    std::size_t a = hash_value(v.binding, v.bindingCount, v.descriptorType, v.stageFlags);
+    std::size_t a = hash_value(v.binding, v.bindingCount, v.descriptorType, v.stageFlags, v.bindingFlags);
     seed ^= a + 0x9e3779b9 + (seed << 6) + (seed >> 2);
   }
   return seed;
@@ -60,16 +61,17 @@ DescriptorPool::~DescriptorPool()
 {
   for (auto& pddit : perObjectData)
     for(uint32_t i=0; i<pddit.second.data.size(); ++i)
-      for( auto& descriptorPool : pddit.second.data[i].descriptorPools)
-        vkDestroyDescriptorPool(pddit.second.device, descriptorPool, nullptr);
+      for (auto& poolChain : pddit.second.data[i].poolChains)
+        for( auto& descriptorPool : poolChain.descriptorPools)
+          vkDestroyDescriptorPool(pddit.second.device, descriptorPool, nullptr);
 }
 
   uint32_t DescriptorPool::registerDescriptorSet(std::shared_ptr<DescriptorSetLayout> layout)
   {
     std::lock_guard<std::mutex> lock(mutex);
-    // find pool that uses the same layout and has not been validated yet
+    // find pool that uses the same layout. Registrations made before the first allocation decide the size of the first Vulkan pool
     auto hashVal = layout->getHashValue();
-    auto it = std::find_if(begin(poolDefinitions), end(poolDefinitions), [&](const SinglePoolDefinition& pd) { return (pd.maxSets == 0) && (pd.layout->getHashValue() == hashVal); });
+    auto it = std::find_if(begin(poolDefinitions), end(poolDefinitions), [&](const SinglePoolDefinition& pd) { return pd.layout->getHashValue() == hashVal; });
     uint32_t index;
     if (it == end(poolDefinitions))
     {
@@ -91,33 +93,63 @@ DescriptorPool::~DescriptorPool()
     auto pddit    = perObjectData.find(keyValue);
     if (pddit == end(perObjectData))
       pddit = perObjectData.insert({ keyValue, DescriptorPoolData(renderContext, swOnce) }).first;
+    auto& poolData = pddit->second.data[0];
+    if (poolData.poolChains.size() < poolDefinitions.size())
+    {
+      poolData.poolChains.resize(poolDefinitions.size());
+      poolData.allocatedDescriptors.resize(poolDefinitions.size(), 0);
+    }
 
-    if (poolDefinitions[index].maxSets == 0)
+    // descriptor sets deallocated at least retireFrames ago are no longer used by frames in flight ( their fences were waited for )
+    retireFrames = std::max(retireFrames, renderContext.imageCount + 1);
+    uint64_t currentEpoch = Node::getEpoch();
+    auto retiredEnd = std::partition(begin(poolData.retiredDescriptorSets), end(poolData.retiredDescriptorSets), [&](const RetiredDescriptorSet& rs) { return rs.epoch + retireFrames > currentEpoch; });
+    for (auto rit = retiredEnd; rit != end(poolData.retiredDescriptorSets); ++rit)
+      poolData.freeDescriptorSets[rit->layoutHash].push_back(rit->descriptorSet);
+    poolData.retiredDescriptorSets.erase(retiredEnd, end(poolData.retiredDescriptorSets));
+
+    // deallocated descriptor sets are reused first
+    auto& freeSets = poolData.freeDescriptorSets[poolDefinitions[index].layout->getHashValue()];
+    if (freeSets.empty())
     {
-      uint32_t poolSize = poolDefinitions[index].registeredDescriptorSets * renderContext.imageCount * renderContext.surface->viewer.lock()->getNumSurfaces();
-      std::vector<VkDescriptorPoolSize> poolSizes = poolDefinitions[index].layout->getDescriptorPoolSize(poolSize);
-      VkDescriptorPoolCreateInfo descriptorPoolCI{};
-        descriptorPoolCI.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        descriptorPoolCI.poolSizeCount = poolSizes.size();
-        descriptorPoolCI.pPoolSizes    = poolSizes.data();
-        descriptorPoolCI.maxSets       = poolSize;
-        descriptorPoolCI.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // we will free our descriptor sets manually
-        pddit->second.data[0].descriptorPools.resize(poolDefinitions.size(), VK_NULL_HANDLE);
-        pddit->second.data[0].allocatedDescriptors.resize(poolDefinitions.size(), 0);
-        VK_CHECK_LOG_THROW(vkCreateDescriptorPool(pddit->second.device, &descriptorPoolCI, nullptr, &pddit->second.data[0].descriptorPools[index]), "Cannot create descriptor pool");
-        poolDefinitions[index].maxSets = poolSize;
+      if (poolDefinitions[index].maxSets == 0)
+        poolDefinitions[index].maxSets = poolDefinitions[index].registeredDescriptorSets * renderContext.imageCount * renderContext.surface->viewer.lock()->getNumSurfaces();
+
+      // DescriptorSet allocates one Vulkan descriptor set for each swapchain image, so descriptor sets are allocated in batches
+      uint32_t batchSize = std::max(renderContext.imageCount, 1u);
+      auto& poolChain    = poolData.poolChains[index];
+      if (poolChain.descriptorPools.empty() || poolChain.lastPoolAllocated + batchSize > poolChain.lastPoolSize)
+      {
+        uint32_t poolSize = std::max(poolChain.descriptorPools.empty() ? poolDefinitions[index].maxSets : 2 * poolChain.lastPoolSize, batchSize);
+        std::vector<VkDescriptorPoolSize> poolSizes = poolDefinitions[index].layout->getDescriptorPoolSize(poolSize);
+        VkDescriptorPoolCreateInfo descriptorPoolCI{};
+          descriptorPoolCI.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+          descriptorPoolCI.poolSizeCount = poolSizes.size();
+          descriptorPoolCI.pPoolSizes    = poolSizes.data();
+          descriptorPoolCI.maxSets       = poolSize;
+          descriptorPoolCI.flags         = poolDefinitions[index].layout->usesUpdateAfterBindPool() ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0;
+        VkDescriptorPool descriptorPool;
+        VK_CHECK_LOG_THROW(vkCreateDescriptorPool(pddit->second.device, &descriptorPoolCI, nullptr, &descriptorPool), "Cannot create descriptor pool");
+        poolChain.descriptorPools.push_back(descriptorPool);
+        poolChain.lastPoolSize      = poolSize;
+        poolChain.lastPoolAllocated = 0;
+      }
+
+      // layout stored in pool definition may belong to a descriptor set that was not validated on this device yet
+      poolDefinitions[index].layout->validate(renderContext);
+      std::vector<VkDescriptorSetLayout> layoutHandles(batchSize, poolDefinitions[index].layout->getHandle(renderContext));
+      VkDescriptorSetAllocateInfo descriptorSetAinfo{};
+        descriptorSetAinfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descriptorSetAinfo.descriptorPool     = poolChain.descriptorPools.back();
+        descriptorSetAinfo.descriptorSetCount = batchSize;
+        descriptorSetAinfo.pSetLayouts        = layoutHandles.data();
+      freeSets.resize(batchSize);
+      VK_CHECK_LOG_THROW(vkAllocateDescriptorSets(pddit->second.device, &descriptorSetAinfo, freeSets.data()), "Cannot allocate descriptor set");
+      poolChain.lastPoolAllocated += batchSize;
     }
-    CHECK_LOG_THROW(pddit->second.data[0].allocatedDescriptors[index] >= poolDefinitions[index].maxSets, "Cannot allocate another descriptor set. Descriptor pool is full");
-
-    VkDescriptorSetLayout layoutHandle = poolDefinitions[index].layout->getHandle(renderContext);
-    VkDescriptorSetAllocateInfo descriptorSetAinfo{};
-      descriptorSetAinfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-      descriptorSetAinfo.descriptorPool     = pddit->second.data[0].descriptorPools[index];
-      descriptorSetAinfo.descriptorSetCount = 1;
-      descriptorSetAinfo.pSetLayouts        = &layoutHandle;
-    VkDescriptorSet descriptorSet;
-    VK_CHECK_LOG_THROW(vkAllocateDescriptorSets(pddit->second.device, &descriptorSetAinfo, &descriptorSet), "Cannot allocate descriptor set");
-    pddit->second.data[0].allocatedDescriptors[index]++;
+    VkDescriptorSet descriptorSet = freeSets.back();
+    freeSets.pop_back();
+    poolData.allocatedDescriptors[index]++;
     return descriptorSet;
   }
 
@@ -125,10 +157,11 @@ DescriptorPool::~DescriptorPool()
   {
     std::lock_guard<std::mutex> lock(mutex);
     auto pddit    = perObjectData.find(deviceID);
-    if (pddit == end(perObjectData))
+    if (pddit == end(perObjectData) || descriptorSet == VK_NULL_HANDLE)
       return;
     CHECK_LOG_THROW(poolDefinitions[index].maxSets == 0, "Cannot deallocate descriptor set - descriptor pool was not created before");
-    vkFreeDescriptorSets(pddit->second.device, pddit->second.data[0].descriptorPools[index], 1, &descriptorSet);
+    // descriptor set may be reused by any descriptor set with identically defined layout, when frames that could use it are finished
+    pddit->second.data[0].retiredDescriptorSets.push_back(RetiredDescriptorSet{ descriptorSet, poolDefinitions[index].layout->getHashValue(), Node::getEpoch() });
     pddit->second.data[0].allocatedDescriptors[index]--;
   }
 
@@ -136,6 +169,12 @@ DescriptorSetLayout::DescriptorSetLayout(const std::vector<DescriptorSetLayoutBi
   : bindings(b)
 {
   hashValue = computeHash(bindings);
+  anyUpdateAfterBind = std::any_of(begin(bindings), end(bindings), [](const DescriptorSetLayoutBinding& b) { return (b.bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0; });
+  allUpdateAfterBind = !bindings.empty() && std::all_of(begin(bindings), end(bindings), [](const DescriptorSetLayoutBinding& b) { return (b.bindingFlags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0; });
+  for (const auto& b : bindings)
+    if (b.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || b.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+      dynamicBindings.push_back(b.binding);
+  std::sort(begin(dynamicBindings), end(dynamicBindings));
 }
 
 DescriptorSetLayout::~DescriptorSetLayout()
@@ -157,6 +196,7 @@ void DescriptorSetLayout::validate(const RenderContext& renderContext)
     return;
 
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+  std::vector<VkDescriptorBindingFlagsEXT>  setLayoutBindingFlags;
   for ( const auto& b : bindings )
   {
     VkDescriptorSetLayoutBinding setLayoutBinding{};
@@ -165,13 +205,54 @@ void DescriptorSetLayout::validate(const RenderContext& renderContext)
       setLayoutBinding.binding         = b.binding;
       setLayoutBinding.descriptorCount = b.bindingCount;
     setLayoutBindings.emplace_back(setLayoutBinding);
+    setLayoutBindingFlags.push_back(b.bindingFlags);
   }
+  bool bindingFlagsUsed = std::any_of(begin(bindings), end(bindings), [](const DescriptorSetLayoutBinding& b) { return b.bindingFlags != 0; });
+  CHECK_LOG_THROW(bindingFlagsUsed && !renderContext.device->enableDescriptorIndexing, "Cannot create descriptor set layout with binding flags - VK_EXT_descriptor_indexing extension was not requested");
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
     descriptorSetLayoutCI.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     descriptorSetLayoutCI.pBindings    = setLayoutBindings.data();
     descriptorSetLayoutCI.bindingCount = setLayoutBindings.size();
+    descriptorSetLayoutCI.flags        = anyUpdateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT : 0;
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCI{};
+    bindingFlagsCI.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsCI.bindingCount  = setLayoutBindingFlags.size();
+    bindingFlagsCI.pBindingFlags = setLayoutBindingFlags.data();
+  if (bindingFlagsUsed)
+    descriptorSetLayoutCI.pNext = &bindingFlagsCI;
   VK_CHECK_LOG_THROW(vkCreateDescriptorSetLayout(pddit->second.device, &descriptorSetLayoutCI, nullptr, &pddit->second.data[0].descriptorSetLayout), "Cannot create descriptor set layout");
+
+  // update template reads descriptor values directly from a vector of DescriptorValue structures - one structure per array element.
+  // Texel buffers are not described by DescriptorValue and partially bound arrays are written only up to the last defined element,
+  // so layouts using them are updated with vkUpdateDescriptorSets()
+  bool templateAvailable = renderContext.device->enableDescriptorUpdateTemplates && !bindings.empty();
+  std::vector<VkDescriptorUpdateTemplateEntryKHR> templateEntries;
+  size_t valueCount = 0;
+  for (const auto& b : bindings)
+  {
+    if (b.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || b.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER || (b.bindingFlags & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT) != 0)
+      templateAvailable = false;
+    VkDescriptorUpdateTemplateEntryKHR templateEntry{};
+      templateEntry.dstBinding      = b.binding;
+      templateEntry.dstArrayElement = 0;
+      templateEntry.descriptorCount = b.bindingCount;
+      templateEntry.descriptorType  = b.descriptorType;
+      templateEntry.offset          = valueCount * sizeof(DescriptorValue) + offsetof(DescriptorValue, bufferInfo);
+      templateEntry.stride          = sizeof(DescriptorValue);
+    templateEntries.push_back(templateEntry);
+    valueCount += b.bindingCount;
+  }
+  if (templateAvailable)
+  {
+    VkDescriptorUpdateTemplateCreateInfoKHR templateCI{};
+      templateCI.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+      templateCI.descriptorUpdateEntryCount = templateEntries.size();
+      templateCI.pDescriptorUpdateEntries   = templateEntries.data();
+      templateCI.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+      templateCI.descriptorSetLayout        = pddit->second.data[0].descriptorSetLayout;
+    pddit->second.data[0].updateTemplate = renderContext.device->getDescriptorUpdateTemplate(hashValue, templateCI);
+  }
   pddit->second.valid[0] = true;
 }
 
@@ -185,6 +266,30 @@ VkDescriptorSetLayout DescriptorSetLayout::getHandle(const RenderContext& render
   return pddit->second.data[0].descriptorSetLayout;
 }
 
+VkDescriptorUpdateTemplateKHR DescriptorSetLayout::getUpdateTemplate(const RenderContext& renderContext) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto keyValue = getKeyID(renderContext, pbPerDevice);
+  auto pddit = perObjectData.find(keyValue);
+  if (pddit == end(perObjectData))
+    return VK_NULL_HANDLE;
+  return pddit->second.data[0].updateTemplate;
+}
+
+bool DescriptorSetLayout::getTemplateData(const std::map<uint32_t, std::vector<DescriptorValue>>& values, std::vector<DescriptorValue>& templateData) const
+{
+  templateData.clear();
+  for (const auto& b : bindings)
+  {
+    auto vit = values.find(b.binding);
+    if (vit == end(values) || vit->second.empty() || vit->second[0].vType == DescriptorValue::Undefined)
+      return false;
+    for (uint32_t i = 0; i < b.bindingCount; ++i)
+      templateData.push_back(i < vit->second.size() ? vit->second[i] : vit->second[0]);
+  }
+  return true;
+}
+
 VkDescriptorType DescriptorSetLayout::getDescriptorType(uint32_t binding) const
 {
   for (const auto& b : bindings)
@@ -205,6 +310,16 @@ uint32_t DescriptorSetLayout::getDescriptorBindingCount(uint32_t binding) const
   return 0;
 }
 
+VkDescriptorBindingFlagsEXT DescriptorSetLayout::getDescriptorBindingFlags(uint32_t binding) const
+{
+  for (const auto& b : bindings)
+  {
+    if (binding == b.binding)
+      return b.bindingFlags;
+  }
+  return 0;
+}
+
 std::vector<VkDescriptorPoolSize> DescriptorSetLayout::getDescriptorPoolSize(uint32_t poolSize) const
 {
   std::vector<VkDescriptorPoolSize> poolSizes;
@@ -275,6 +390,12 @@ DescriptorSet::DescriptorSet(std::shared_ptr<DescriptorPool> p, std::shared_ptr<
   : pool{ p }, layout{ l }
 {
   poolIndex = pool->registerDescriptorSet(layout);
+  // all resources of a dynamic descriptor set are switched using dynamic offsets, so single descriptor set per device is enough
+  if (layout->isDynamic())
+  {
+    perObjectBehaviour      = pbPerDevice;
+    swapChainImageBehaviour = swOnce;
+  }
 }
 
 DescriptorSet::~DescriptorSet()
@@ -290,6 +411,13 @@ DescriptorSet::~DescriptorSet()
 }
 
 void DescriptorSet::validate( const RenderContext& renderContext )
+{
+  DescriptorWriteBatch writeBatch;
+  validate(renderContext, writeBatch);
+  writeBatch.flush(renderContext.vkDevice);
+}
+
+void DescriptorSet::validate(const RenderContext& renderContext, DescriptorWriteBatch& writeBatch)
 {
   // validate descriptor pool and layout
   layout->validate(renderContext);
@@ -306,76 +434,261 @@ void DescriptorSet::validate( const RenderContext& renderContext )
     for (auto& pdd : perObjectData)
       pdd.second.resize(activeCount);
   }
-  auto keyValue = getKeyID(renderContext, pbPerSurface);
+  auto keyValue = getKeyID(renderContext, perObjectBehaviour);
   auto pddit = perObjectData.find(keyValue);
   if (pddit == end(perObjectData))
-    pddit = perObjectData.insert({ keyValue, DescriptorSetData(renderContext, swForEachImage) }).first;
-  uint32_t activeIndex = renderContext.activeIndex % activeCount;
+    pddit = perObjectData.insert({ keyValue, DescriptorSetData(renderContext, swapChainImageBehaviour) }).first;
+  uint32_t activeIndex = (swapChainImageBehaviour == swForEachImage) ? renderContext.activeIndex % activeCount : 0;
+  auto& dsData         = pddit->second.data[activeIndex];
+  auto owner           = std::dynamic_pointer_cast<DescriptorSet>(shared_from_this());
+  // descriptor set shared by all swapchain images ( and surfaces ) may be bound by frames in flight, so it cannot be rewritten in place
+  bool sharedByFrames  = (swapChainImageBehaviour == swOnce) && !layout->isUpdateAfterBind();
+  // Descriptor set stays invalid until the batch is flushed. Other threads validating the same descriptor set in the meantime
+  // add the same writes to their own batches - whichever batch is flushed first writes the descriptor set ( see flushWrites() )
   if (pddit->second.valid[activeIndex])
+  {
+    // only single elements of descriptor arrays were modified since last validation - write them alone
+    if (dsData.pendingElements.empty())
+      return;
+    // ...unless descriptor set is shared by frames in flight - then whole new descriptor set is written
+    if (sharedByFrames)
+      pddit->second.valid[activeIndex] = false;
+  }
+  if (pddit->second.valid[activeIndex])
+  {
+    writeBatch.beginSet(owner, keyValue, activeIndex, dsData.descriptorSet, true);
+    for (auto peit = begin(dsData.pendingElements); peit != end(dsData.pendingElements);)
+    {
+      auto dit = descriptors.find(peit->first);
+      if (dit == end(descriptors) || peit->second >= dit->second->resources.size())
+      {
+        peit = dsData.pendingElements.erase(peit);
+        continue;
+      }
+      writeBatch.add(dsData.descriptorSet, *layout, peit->first, peit->second, dit->second->resources[peit->second]->getDescriptorValue(renderContext));
+      ++peit;
+    }
     return;
+  }
 
-  if (pddit->second.data[activeIndex].descriptorSet == VK_NULL_HANDLE)
+  // Old descriptor set is retired by the pool and reused when frames that could use it are finished.
+  // Descriptor set allocated but not written yet is not reallocated, because other threads may still write it
+  if (dsData.descriptorSet == VK_NULL_HANDLE || (sharedByFrames && dsData.written))
   {
-    pddit->second.data[activeIndex].descriptorSet = pool->allocate(renderContext, poolIndex);
-    pddit->second.commonData                      = renderContext.device->getID();
+    pool->deallocate(pddit->second.commonData, poolIndex, dsData.descriptorSet);
+    dsData.descriptorSet     = pool->allocate(renderContext, poolIndex);
+    pddit->second.commonData = renderContext.device->getID();
+    dsData.written           = false;
+    dsData.handleChanged     = true;
   }
 
   std::map<uint32_t, std::vector<DescriptorValue>> values;
-  uint32_t dsvSize = 0;
   for (const auto& d : descriptors)
   {
     std::vector<DescriptorValue> value;
     d.second->getDescriptorValues(renderContext, value);
-    dsvSize += layout->getDescriptorBindingCount(d.first);
     values.insert({ d.first, value });
   }
-  std::vector<VkWriteDescriptorSet>   writeDescriptorSets;
-  std::vector<VkDescriptorBufferInfo> bufferInfos(dsvSize);
-  std::vector<VkDescriptorImageInfo>  imageInfos(dsvSize);
-  uint32_t bufferInfosCurrentSize = 0;
-  uint32_t imageInfosCurrentSize  = 0;
+
+  // descriptor sets with all bindings defined are updated using template, other ones are updated in batches
+  VkDescriptorUpdateTemplateKHR updateTemplate = layout->getUpdateTemplate(renderContext);
+  std::vector<DescriptorValue> templateData;
+  if (updateTemplate == VK_NULL_HANDLE || !layout->getTemplateData(values, templateData))
+  {
+    writeBatch.beginSet(owner, keyValue, activeIndex, dsData.descriptorSet, false);
+    writeBatch.add(dsData.descriptorSet, *layout, values);
+    return;
+  }
+  // template update is performed immediately under descriptor set mutex, so descriptor set is valid right away
+  renderContext.device->updateDescriptorSetWithTemplate(dsData.descriptorSet, updateTemplate, templateData.data());
+  dsData.pendingElements.clear();
+  dsData.written                   = true;
+  pddit->second.valid[activeIndex] = true;
+  // descriptor sets that may be updated after bind do not invalidate command buffers, unless Vulkan handle has changed
+  if (dsData.handleChanged || !layout->isUpdateAfterBind())
+    notifyCommandBuffers(getNotifyIndex(activeIndex));
+  dsData.handleChanged = false;
+}
+
+void DescriptorSet::flushWrites(VkDevice device, uint32_t keyValue, uint32_t activeIndex, VkDescriptorSet descriptorSet, bool elementWrites, const std::vector<std::pair<uint32_t, uint32_t>>& elements, const VkWriteDescriptorSet* setWrites, uint32_t writeCount)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perObjectData.find(keyValue);
+  if (pddit == end(perObjectData) || activeIndex >= pddit->second.data.size())
+    return;
+  auto& dsData = pddit->second.data[activeIndex];
+  // descriptor set was reallocated after the writes were collected - they will be collected again during next validation
+  if (dsData.descriptorSet != descriptorSet)
+    return;
+  if (!elementWrites)
+  {
+    // the same descriptor set may be validated by many threads ( per queue and per surface validation ) - only the first flush writes it
+    if (pddit->second.valid[activeIndex])
+      return;
+    if (writeCount > 0)
+      vkUpdateDescriptorSets(device, writeCount, setWrites, 0, nullptr);
+    dsData.pendingElements.clear();
+    dsData.written                   = true;
+    pddit->second.valid[activeIndex] = true;
+    if (dsData.handleChanged || !layout->isUpdateAfterBind())
+      notifyCommandBuffers(getNotifyIndex(activeIndex));
+    dsData.handleChanged = false;
+    return;
+  }
+  // whole descriptor set will be written during next validation anyway
+  if (!pddit->second.valid[activeIndex])
+    return;
+  // write only elements that were not written by another batch yet
+  std::vector<VkWriteDescriptorSet> remainingWrites;
+  for (uint32_t i = 0; i < writeCount; ++i)
+  {
+    auto peit = std::find(begin(dsData.pendingElements), end(dsData.pendingElements), elements[i]);
+    if (peit == end(dsData.pendingElements))
+      continue;
+    remainingWrites.push_back(setWrites[i]);
+    dsData.pendingElements.erase(peit);
+  }
+  if (remainingWrites.empty())
+    return;
+  vkUpdateDescriptorSets(device, remainingWrites.size(), remainingWrites.data(), 0, nullptr);
+  if (!layout->isUpdateAfterBind())
+    notifyCommandBuffers(getNotifyIndex(activeIndex));
+}
+
+uint32_t DescriptorSet::getNotifyIndex(uint32_t activeIndex) const
+{
+  // descriptor set shared by all swapchain images is used by all command buffers
+  return (swapChainImageBehaviour == swForEachImage) ? activeIndex : std::numeric_limits<uint32_t>::max();
+}
+
+void DescriptorWriteBatch::beginSet(std::shared_ptr<DescriptorSet> owner, uint32_t keyValue, uint32_t activeIndex, VkDescriptorSet descriptorSet, bool elementWrites)
+{
+  setWrites.push_back(SetWrites{ owner, keyValue, activeIndex, descriptorSet, elementWrites, writes.size(), {} });
+}
+
+void DescriptorWriteBatch::add(VkDescriptorSet descriptorSet, const DescriptorSetLayout& layout, const std::map<uint32_t, std::vector<DescriptorValue>>& values)
+{
   for (const auto& v : values)
   {
     if (v.second.empty())
       continue;
     VkWriteDescriptorSet writeDescriptorSet{};
       writeDescriptorSet.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      writeDescriptorSet.dstSet          = pddit->second.data[activeIndex].descriptorSet;
-      writeDescriptorSet.descriptorType  = layout->getDescriptorType(v.first);
+      writeDescriptorSet.dstSet          = descriptorSet;
+      writeDescriptorSet.descriptorType  = layout.getDescriptorType(v.first);
       writeDescriptorSet.dstBinding      = v.first;
-      writeDescriptorSet.descriptorCount = layout->getDescriptorBindingCount(v.first);
-      switch (v.second[0].vType)
-      {
-      case DescriptorValue::Buffer:
-        writeDescriptorSet.pBufferInfo = &bufferInfos[bufferInfosCurrentSize];
-        for (const auto& dsv : v.second)
-          bufferInfos[bufferInfosCurrentSize++] = dsv.bufferInfo;
-        break;
-      case DescriptorValue::Image:
-        writeDescriptorSet.pImageInfo = &imageInfos[imageInfosCurrentSize];
-        for (const auto& dsv : v.second)
-          imageInfos[imageInfosCurrentSize++] = dsv.imageInfo;
-        for(uint32_t i=v.second.size(); i<layout->getDescriptorBindingCount(v.first); ++i)
-          imageInfos[imageInfosCurrentSize++] = v.second[0].imageInfo;
-        break;
-      default:
-        continue;
-      }
-    writeDescriptorSets.push_back(writeDescriptorSet);
+      writeDescriptorSet.descriptorCount = layout.getDescriptorBindingCount(v.first);
+    // partially bound arrays are written only up to the last defined element, other arrays are filled with first element
+    if ((layout.getDescriptorBindingFlags(v.first) & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT) != 0)
+      writeDescriptorSet.descriptorCount = std::min<uint32_t>(writeDescriptorSet.descriptorCount, v.second.size());
+    switch (v.second[0].vType)
+    {
+    case DescriptorValue::Buffer:
+      infoIndices.push_back({ DescriptorValue::Buffer, bufferInfos.size() });
+      for (uint32_t i = 0; i < writeDescriptorSet.descriptorCount; ++i)
+        bufferInfos.push_back(i < v.second.size() ? v.second[i].bufferInfo : v.second[0].bufferInfo);
+      break;
+    case DescriptorValue::Image:
+      infoIndices.push_back({ DescriptorValue::Image, imageInfos.size() });
+      for (uint32_t i = 0; i < writeDescriptorSet.descriptorCount; ++i)
+        imageInfos.push_back(i < v.second.size() ? v.second[i].imageInfo : v.second[0].imageInfo);
+      break;
+    default:
+      continue;
+    }
+    writes.push_back(writeDescriptorSet);
   }
-  vkUpdateDescriptorSets(pddit->second.device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, nullptr);
-  pddit->second.valid[activeIndex] = true;
-  notifyCommandBuffers(activeIndex);
+}
+
+void DescriptorWriteBatch::add(VkDescriptorSet descriptorSet, const DescriptorSetLayout& layout, uint32_t binding, uint32_t element, const DescriptorValue& value)
+{
+  VkWriteDescriptorSet writeDescriptorSet{};
+    writeDescriptorSet.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSet.dstSet          = descriptorSet;
+    writeDescriptorSet.descriptorType  = layout.getDescriptorType(binding);
+    writeDescriptorSet.dstBinding      = binding;
+    writeDescriptorSet.dstArrayElement = element;
+    writeDescriptorSet.descriptorCount = 1;
+  switch (value.vType)
+  {
+  case DescriptorValue::Buffer:
+    infoIndices.push_back({ DescriptorValue::Buffer, bufferInfos.size() });
+    bufferInfos.push_back(value.bufferInfo);
+    break;
+  case DescriptorValue::Image:
+    infoIndices.push_back({ DescriptorValue::Image, imageInfos.size() });
+    imageInfos.push_back(value.imageInfo);
+    break;
+  default:
+    return;
+  }
+  writes.push_back(writeDescriptorSet);
+  if (!setWrites.empty())
+    setWrites.back().elements.push_back({ binding, element });
+}
+
+void DescriptorWriteBatch::flush(VkDevice device)
+{
+  if (writes.empty() && setWrites.empty())
+    return;
+  for (size_t i = 0; i < writes.size(); ++i)
+  {
+    if (infoIndices[i].first == DescriptorValue::Buffer)
+      writes[i].pBufferInfo = &bufferInfos[infoIndices[i].second];
+    else
+      writes[i].pImageInfo  = &imageInfos[infoIndices[i].second];
+  }
+  // writes added before first beginSet() do not belong to any descriptor set
+  size_t firstSetWrite = setWrites.empty() ? writes.size() : setWrites[0].firstWrite;
+  if (firstSetWrite > 0)
+    vkUpdateDescriptorSets(device, firstSetWrite, writes.data(), 0, nullptr);
+  // each descriptor set is written under its own mutex and marked as valid afterwards
+  for (size_t i = 0; i < setWrites.size(); ++i)
+  {
+    size_t lastWrite = (i + 1 < setWrites.size()) ? setWrites[i + 1].firstWrite : writes.size();
+    auto& sw = setWrites[i];
+    sw.owner->flushWrites(device, sw.keyValue, sw.activeIndex, sw.descriptorSet, sw.elementWrites, sw.elements, writes.data() + sw.firstWrite, static_cast<uint32_t>(lastWrite - sw.firstWrite));
+  }
+  setWrites.clear();
+  writes.clear();
+  infoIndices.clear();
+  bufferInfos.clear();
+  imageInfos.clear();
+}
+
+uint32_t DescriptorSet::getActiveCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return (swapChainImageBehaviour == swForEachImage) ? activeCount : 1;
 }
 
 VkDescriptorSet DescriptorSet::getHandle(const RenderContext& renderContext) const
 {
   std::lock_guard<std::mutex> lock(mutex);
-  auto keyValue = getKeyID(renderContext, pbPerSurface);
+  auto keyValue = getKeyID(renderContext, perObjectBehaviour);
   auto pddit = perObjectData.find(keyValue);
   if (pddit == end(perObjectData))
     return VK_NULL_HANDLE;
-  return pddit->second.data[renderContext.activeIndex].descriptorSet;
+  return pddit->second.data[(swapChainImageBehaviour == swForEachImage) ? renderContext.activeIndex : 0].descriptorSet;
+}
+
+void DescriptorSet::getDynamicOffsets(const RenderContext& renderContext, std::vector<uint32_t>& offsets) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto binding : layout->getDynamicBindings())
+  {
+    uint32_t bindingCount = layout->getDescriptorBindingCount(binding);
+    auto dit = descriptors.find(binding);
+    if (dit == end(descriptors) || dit->second->resources.empty())
+    {
+      offsets.insert(end(offsets), bindingCount, 0);
+      continue;
+    }
+    // descriptor arrays are filled with first element when there's not enough resources ( see DescriptorWriteBatch::add() )
+    const auto& resources = dit->second->resources;
+    for (uint32_t i = 0; i < bindingCount; ++i)
+      offsets.push_back((i < resources.size() ? resources[i] : resources[0])->getDynamicOffset(renderContext));
+  }
 }
 
 void DescriptorSet::invalidateOwners()
@@ -392,10 +705,10 @@ void DescriptorSet::notify()
 
 void DescriptorSet::notify(const RenderContext& renderContext)
 {
-  auto keyValue = getKeyID(renderContext, pbPerSurface);
+  auto keyValue = getKeyID(renderContext, perObjectBehaviour);
   auto pddit = perObjectData.find(keyValue);
   if (pddit == end(perObjectData))
-    pddit = perObjectData.insert({ keyValue, DescriptorSetData(renderContext,swForEachImage) }).first;
+    pddit = perObjectData.insert({ keyValue, DescriptorSetData(renderContext, swapChainImageBehaviour) }).first;
   pddit->second.invalidate();
 }
 
@@ -439,6 +752,38 @@ void DescriptorSet::setDescriptor(uint32_t binding, std::shared_ptr<Resource> re
   setDescriptor(binding, resource, defaultType.second);
 }
 
+void DescriptorSet::setDescriptorElement(uint32_t binding, uint32_t element, std::shared_ptr<Resource> resource, VkDescriptorType descriptorType)
+{
+  CHECK_LOG_THROW(binding >= layout->getBindings().size(), "Binding out of bounds");
+  CHECK_LOG_THROW(layout->getBindings().at(binding).descriptorType != descriptorType, "Binding " << binding << " with wrong descriptor type : " << descriptorType << " but should be " << layout->getBindings().at(binding).descriptorType);
+  CHECK_LOG_THROW(element >= layout->getDescriptorBindingCount(binding), "Descriptor array element out of bounds. Binding " << binding << " element " << element);
+  std::unique_lock<std::mutex> lock(mutex);
+  auto it = descriptors.find(binding);
+  if (it == end(descriptors))
+  {
+    CHECK_LOG_THROW(element != 0, "Descriptor array elements must be set in order. Binding " << binding << " element " << element);
+    lock.unlock();
+    setDescriptor(binding, resource, descriptorType);
+    return;
+  }
+  auto& resources = it->second->resources;
+  CHECK_LOG_THROW(element > resources.size(), "Descriptor array elements must be set in order. Binding " << binding << " element " << element);
+  if (element == resources.size())
+    resources.push_back(resource);
+  else
+  {
+    resources[element]->removeDescriptor(it->second);
+    resources[element] = resource;
+  }
+  resource->addDescriptor(it->second);
+  // valid descriptor sets will write only this element. Invalid ones will be written as a whole anyway
+  for (auto& pdd : perObjectData)
+    for (uint32_t i = 0; i < pdd.second.data.size(); ++i)
+      if (pdd.second.valid[i])
+        pdd.second.data[i].pendingElements.push_back({ binding, element });
+  invalidateOwners();
+}
+
 void DescriptorSet::resetDescriptor(uint32_t binding)
 {
   std::lock_guard<std::mutex> lock(mutex);
@@ -22,10 +22,14 @@
 
 #include <pumex/Device.h>
 #include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
 #include <pumex/Viewer.h>
 #include <pumex/PhysicalDevice.h>
 #include <pumex/Command.h>
 #include <pumex/Descriptor.h>
+#include <pumex/TransientResourcePool.h>
 #include <pumex/utils/Log.h>
 #include <pumex/utils/Buffer.h>
 
@@ -122,6 +126,45 @@ void Device::realize()
 
   std::copy( cbegin(requestedDeviceExtensions), cend(requestedDeviceExtensions), std::back_inserter(enabledDeviceExtensions) );
 
+  // descriptor sets are updated using templates when device is able to do it
+  if (physicalDevice->deviceExtensionImplemented(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+  {
+    if (!deviceExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+      enabledDeviceExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    enableDescriptorUpdateTemplates = true;
+  }
+
+  // indirect draws with count read from a buffer are used when device is able to do it
+  if (physicalDevice->deviceExtensionImplemented(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+  {
+    if (!deviceExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+      enabledDeviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    enableDrawIndirectCount = true;
+  }
+
+#if defined(VK_EXT_memory_budget)
+  // memory budget is reported by driver when device is able to do it ( VK_KHR_get_physical_device_properties2 instance extension is required )
+  if (physicalDevice->deviceExtensionImplemented(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) && physicalDevice->pfn_vkGetPhysicalDeviceMemoryProperties2 != nullptr)
+  {
+    if (!deviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+      enabledDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    enableMemoryBudget = true;
+  }
+#endif
+
+  // descriptor indexing must be requested by the user. All descriptor indexing features reported by physical device are enabled then
+  VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+  if (deviceExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+  {
+    CHECK_LOG_THROW(physicalDevice->descriptorIndexingFeatures.sType != VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT, "Cannot enable descriptor indexing - VK_KHR_get_physical_device_properties2 instance extension is required");
+    if (!deviceExtensionEnabled(VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+      enabledDeviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+    descriptorIndexingFeatures       = physicalDevice->descriptorIndexingFeatures;
+    descriptorIndexingFeatures.pNext = nullptr;
+    deviceCreateInfo.pNext           = &descriptorIndexingFeatures;
+    enableDescriptorIndexing         = true;
+  }
+
   if (enabledDeviceExtensions.size() > 0)
   {
     deviceCreateInfo.enabledExtensionCount = (uint32_t)enabledDeviceExtensions.size();
@@ -149,17 +192,36 @@ void Device::realize()
     pfnCmdDebugMarkerEnd        = reinterpret_cast<PFN_vkCmdDebugMarkerEndEXT>(vkGetDeviceProcAddr(device, "vkCmdDebugMarkerEndEXT"));
     pfnCmdDebugMarkerInsert     = reinterpret_cast<PFN_vkCmdDebugMarkerInsertEXT>(vkGetDeviceProcAddr(device, "vkCmdDebugMarkerInsertEXT"));
   }
+  if (enableDescriptorUpdateTemplates)
+  {
+    pfnCreateDescriptorUpdateTemplate  = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplateKHR>(vkGetDeviceProcAddr(device, "vkCreateDescriptorUpdateTemplateKHR"));
+    pfnDestroyDescriptorUpdateTemplate = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplateKHR>(vkGetDeviceProcAddr(device, "vkDestroyDescriptorUpdateTemplateKHR"));
+    pfnUpdateDescriptorSetWithTemplate = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplateKHR>(vkGetDeviceProcAddr(device, "vkUpdateDescriptorSetWithTemplateKHR"));
+    enableDescriptorUpdateTemplates    = pfnCreateDescriptorUpdateTemplate != VK_NULL_HANDLE && pfnDestroyDescriptorUpdateTemplate != VK_NULL_HANDLE && pfnUpdateDescriptorSetWithTemplate != VK_NULL_HANDLE;
+  }
+  if (enableDrawIndirectCount)
+  {
+    pfnCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+    enableDrawIndirectCount        = pfnCmdDrawIndexedIndirectCount != VK_NULL_HANDLE;
+  }
 
   // create descriptor pool
   descriptorPool = std::make_shared<DescriptorPool>();
+  transientResourcePool = std::make_shared<TransientResourcePool>(this);
 }
 
 void Device::cleanup()
 {
   if (device != VK_NULL_HANDLE)
   {
+    stagingRing = nullptr;
+    overflowStagingBuffers.clear();
     stagingBuffers.clear();
     descriptorPool = nullptr;
+    transientResourcePool = nullptr;
+    for (auto& t : descriptorUpdateTemplates)
+      pfnDestroyDescriptorUpdateTemplate(device, t.second, nullptr);
+    descriptorUpdateTemplates.clear();
     vkDestroyDevice(device, nullptr);
     device = VK_NULL_HANDLE;
     queues.clear();
@@ -196,6 +258,11 @@ std::shared_ptr<DescriptorPool> Device::getDescriptorPool()
   return descriptorPool;
 }
 
+std::shared_ptr<TransientResourcePool> Device::getTransientResourcePool()
+{
+  return transientResourcePool;
+}
+
 std::shared_ptr<StagingBuffer> Device::acquireStagingBuffer(const void* data, VkDeviceSize size)
 {
   // find smallest staging buffer that is able to transfer data
@@ -233,6 +300,88 @@ void Device::releaseStagingBuffer(std::shared_ptr<StagingBuffer> buffer)
   buffer->setReserved(false);
 }
 
+StagingAllocation Device::acquireStagingMemory(CommandBuffer* commandBuffer, const void* data, VkDeviceSize size, VkDeviceSize alignment)
+{
+  StagingAllocation result;
+  {
+    std::unique_lock<std::mutex> lock(stagingMutex);
+    if (stagingRing.get() == nullptr)
+      stagingRing = std::make_shared<StagingRingBuffer>(this, stagingRingSize);
+
+    bool allocated = stagingRing->allocate(commandBuffer, size, alignment, result);
+    // ring is full : wait for a while until other command buffers release their memory
+    if (!allocated && size <= stagingRing->bufferSize() && stagingRing->hasPendingAllocations(commandBuffer))
+    {
+      stagingStatistics.stallCount++;
+      auto waitEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+      while (!allocated && stagingRing->hasPendingAllocations(commandBuffer))
+      {
+        if (stagingCondition.wait_until(lock, waitEnd) == std::cv_status::timeout)
+          break;
+        allocated = stagingRing->allocate(commandBuffer, size, alignment, result);
+      }
+    }
+    if (allocated)
+    {
+      stagingStatistics.allocationCount++;
+      stagingStatistics.peakUsedSize = std::max(stagingStatistics.peakUsedSize, stagingRing->usedSize());
+    }
+    else
+      stagingStatistics.overflowCount++;
+  }
+  if (result.buffer != VK_NULL_HANDLE)
+  {
+    if (data != nullptr)
+      std::memcpy(result.mappedData, data, size);
+    return result;
+  }
+
+  // allocation is too large for a staging ring ( or the ring is full ) - use dedicated staging buffer
+  auto stagingBuffer = acquireStagingBuffer(data, size);
+  result.buffer         = stagingBuffer->buffer;
+  result.offset         = 0;
+  result.size           = size;
+  result.mappedData     = stagingBuffer->mapMemory(size);
+  result.overflowBuffer = stagingBuffer;
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  overflowStagingBuffers.push_back({ commandBuffer, stagingBuffer });
+  return result;
+}
+
+void Device::releaseStagingMemory(CommandBuffer* commandBuffer)
+{
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  if (stagingRing.get() != nullptr)
+    stagingRing->release(commandBuffer);
+  auto eit = std::remove_if(begin(overflowStagingBuffers), end(overflowStagingBuffers), [commandBuffer](const std::pair<CommandBuffer*, std::shared_ptr<StagingBuffer>>& ob) { return ob.first == commandBuffer; });
+  for (auto it = eit; it != end(overflowStagingBuffers); ++it)
+  {
+    it->second->unmapMemory();
+    it->second->setReserved(false);
+  }
+  overflowStagingBuffers.erase(eit, end(overflowStagingBuffers));
+  stagingCondition.notify_all();
+}
+
+StagingStatistics Device::getStagingStatistics() const
+{
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  StagingStatistics result = stagingStatistics;
+  if (stagingRing.get() != nullptr)
+  {
+    result.ringSize = stagingRing->bufferSize();
+    result.usedSize = stagingRing->usedSize();
+  }
+  return result;
+}
+
+void Device::setStagingRingSize(VkDeviceSize size)
+{
+  std::lock_guard<std::mutex> lock(stagingMutex);
+  CHECK_LOG_THROW(stagingRing.get() != nullptr, "Cannot change staging ring size after it was created");
+  stagingRingSize = size;
+}
+
 bool Device::deviceExtensionEnabled(const char* extensionName) const
 {
   for (const auto& e : enabledDeviceExtensions)
@@ -241,6 +390,31 @@ bool Device::deviceExtensionEnabled(const char* extensionName) const
   return false;
 }
 
+VkDescriptorUpdateTemplateKHR Device::getDescriptorUpdateTemplate(std::size_t layoutHash, const VkDescriptorUpdateTemplateCreateInfoKHR& createInfo)
+{
+  if (!enableDescriptorUpdateTemplates)
+    return VK_NULL_HANDLE;
+  std::lock_guard<std::mutex> lock(templateMutex);
+  auto it = descriptorUpdateTemplates.find(layoutHash);
+  if (it != end(descriptorUpdateTemplates))
+    return it->second;
+  VkDescriptorUpdateTemplateKHR updateTemplate;
+  VK_CHECK_LOG_THROW(pfnCreateDescriptorUpdateTemplate(device, &createInfo, nullptr, &updateTemplate), "Cannot create descriptor update template");
+  descriptorUpdateTemplates.insert({ layoutHash, updateTemplate });
+  return updateTemplate;
+}
+
+void Device::updateDescriptorSetWithTemplate(VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplateKHR updateTemplate, const void* data) const
+{
+  pfnUpdateDescriptorSetWithTemplate(device, descriptorSet, updateTemplate, data);
+}
+
+void Device::cmdDrawIndexedIndirectCount(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) const
+{
+  CHECK_LOG_THROW(!enableDrawIndirectCount, "Cannot use vkCmdDrawIndexedIndirectCountKHR - VK_KHR_draw_indirect_count extension is not enabled");
+  pfnCmdDrawIndexedIndirectCount(cmdBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
 std::shared_ptr<CommandBuffer> Device::beginSingleTimeCommands(std::shared_ptr<CommandPool> commandPool)
 {
   std::lock_guard<std::mutex> lock(submitMutex);
@@ -266,6 +440,8 @@ void Device::endSingleTimeCommands(std::shared_ptr<CommandBuffer> commandBuffer,
 
     vkDestroyFence(device, fence, nullptr);
   }
+  // commands from command buffer are finished ( or were never submitted ) - staging memory used by them may be reused
+  releaseStagingMemory(commandBuffer.get());
   commandBuffer.reset();
 }
 
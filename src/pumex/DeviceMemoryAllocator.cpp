@@ -21,6 +21,7 @@
 //
 
 #include <cstring>
+#include <algorithm>
 #include <pumex/DeviceMemoryAllocator.h>
 #include <pumex/Device.h>
 #include <pumex/PhysicalDevice.h>
@@ -43,6 +44,18 @@ FreeBlock::FreeBlock(VkDeviceSize o, VkDeviceSize s)
 {
 }
 
+DeviceMemoryStatistics& DeviceMemoryStatistics::operator+=(const DeviceMemoryStatistics& rhs)
+{
+  memorySize       += rhs.memorySize;
+  usedSize         += rhs.usedSize;
+  freeSize         += rhs.freeSize;
+  largestFreeBlock =  std::max(largestFreeBlock, rhs.largestFreeBlock);
+  allocationCount  += rhs.allocationCount;
+  freeBlockCount   += rhs.freeBlockCount;
+  deviceCount      += rhs.deviceCount;
+  return *this;
+}
+
 AllocationStrategy::~AllocationStrategy()
 {
 }
@@ -77,7 +90,10 @@ DeviceMemoryBlock DeviceMemoryAllocator::allocate(Device* device, VkMemoryRequir
     VK_CHECK_LOG_THROW(vkAllocateMemory(device->device, &memAlloc, nullptr, &pddit->second.storageMemory), "Cannot allocate memory in DeviceMemoryAllocator: " << name);
     pddit->second.freeBlocks.push_front(FreeBlock(0, size));
   }
-  return allocationStrategy->allocate(pddit->second.storageMemory, pddit->second.freeBlocks, memoryRequirements);
+  auto block = allocationStrategy->allocate(pddit->second.storageMemory, pddit->second.freeBlocks, memoryRequirements);
+  pddit->second.usedSize        += block.alignedSize;
+  pddit->second.allocationCount += 1;
+  return block;
 }
 
 void DeviceMemoryAllocator::deallocate(VkDevice device, const DeviceMemoryBlock& block)
@@ -86,6 +102,44 @@ void DeviceMemoryAllocator::deallocate(VkDevice device, const DeviceMemoryBlock&
   auto pddit = perDeviceData.find(device);
   CHECK_LOG_THROW(pddit == end(perDeviceData), "Cannot deallocate memory - device memory was never allocated: " << name);
   allocationStrategy->deallocate(pddit->second.freeBlocks, block);
+  pddit->second.usedSize        -= block.alignedSize;
+  pddit->second.allocationCount -= 1;
+}
+
+DeviceMemoryStatistics DeviceMemoryAllocator::getStatistics(VkDevice device) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perDeviceData.find(device);
+  if (pddit == end(perDeviceData))
+    return DeviceMemoryStatistics();
+  return collectStatistics(pddit->second);
+}
+
+DeviceMemoryStatistics DeviceMemoryAllocator::getStatistics() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  DeviceMemoryStatistics result;
+  for (const auto& pdd : perDeviceData)
+    result += collectStatistics(pdd.second);
+  return result;
+}
+
+DeviceMemoryStatistics DeviceMemoryAllocator::collectStatistics(const PerDeviceData& pdd) const
+{
+  DeviceMemoryStatistics result;
+  if (pdd.storageMemory == VK_NULL_HANDLE)
+    return result;
+  result.memorySize      = size;
+  result.usedSize        = pdd.usedSize;
+  result.allocationCount = pdd.allocationCount;
+  result.freeBlockCount  = static_cast<uint32_t>(pdd.freeBlocks.size());
+  result.deviceCount     = 1;
+  for (const auto& fb : pdd.freeBlocks)
+  {
+    result.freeSize         += fb.size;
+    result.largestFreeBlock =  std::max(result.largestFreeBlock, fb.size);
+  }
+  return result;
 }
 
 void DeviceMemoryAllocator::copyToDeviceMemory(Device* device, VkDeviceSize offset, const void* data, VkDeviceSize size, VkMemoryMapFlags flags)
@@ -109,6 +163,18 @@ void DeviceMemoryAllocator::bindBufferMemory(Device* device, VkBuffer buffer, Vk
   VK_CHECK_LOG_THROW(vkBindBufferMemory(device->device, buffer, pddit->second.storageMemory, offset), "Cannot bind memory to buffer: " << name);
 }
 
+SharedMemoryBlock::SharedMemoryBlock(Device* d, std::shared_ptr<DeviceMemoryAllocator> a, VkMemoryRequirements memoryRequirements)
+  : device{ d->device }, allocator{ a }
+{
+  memoryBlock = allocator->allocate(d, memoryRequirements);
+  CHECK_LOG_THROW(memoryBlock.alignedSize == 0, "Cannot allocate shared memory block in DeviceMemoryAllocator: " << allocator->getName());
+}
+
+SharedMemoryBlock::~SharedMemoryBlock()
+{
+  allocator->deallocate(device, memoryBlock);
+}
+
 FirstFitAllocationStrategy::FirstFitAllocationStrategy(DeviceMemoryAllocator* o)
   : owner{ o }
 {
@@ -142,7 +208,8 @@ DeviceMemoryBlock FirstFitAllocationStrategy::allocate(VkDeviceMemory storageMem
 
 void FirstFitAllocationStrategy::deallocate(std::list<FreeBlock>& freeBlocks, const DeviceMemoryBlock& block)
 {
-  FreeBlock fBlock(block.realOffset, block.realSize);
+  // block occupies alignedSize bytes starting from realOffset ( alignment padding included )
+  FreeBlock fBlock(block.realOffset, block.alignedSize);
   if (freeBlocks.empty())
   {
     freeBlocks.push_back(fBlock);
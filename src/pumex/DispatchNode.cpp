@@ -22,6 +22,7 @@
 
 #include <pumex/DispatchNode.h>
 #include <pumex/NodeVisitor.h>
+#include <pumex/Command.h>
 
 using namespace pumex;
 
@@ -44,6 +45,11 @@ void DispatchNode::validate(const RenderContext& renderContext)
 {
 }
 
+void DispatchNode::cmdDispatch(const RenderContext& renderContext, CommandBuffer* commandBuffer)
+{
+  commandBuffer->cmdDispatch(x, y, z);
+}
+
 void DispatchNode::setDispatch(uint32_t newx, uint32_t newy, uint32_t newz)
 {
   x = newx;
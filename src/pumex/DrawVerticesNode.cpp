@@ -92,9 +92,8 @@ void DrawVerticesNode::cmdDraw(const RenderContext& renderContext, CommandBuffer
   commandBuffer->addSource(this);
   VkBuffer vBuffer = vertexBuffer->getHandleBuffer(renderContext);
   VkBuffer iBuffer = indexBuffer->getHandleBuffer(renderContext);
-  VkDeviceSize offsets = 0;
-  vkCmdBindVertexBuffers(commandBuffer->getHandle(), vertexBinding, 1, &vBuffer, &offsets);
-  vkCmdBindIndexBuffer(commandBuffer->getHandle(), iBuffer, 0, VK_INDEX_TYPE_UINT32);
+  commandBuffer->cmdBindVertexBuffer(vertexBinding, vBuffer);
+  commandBuffer->cmdBindIndexBuffer(iBuffer);
   uint32_t currentIndexCount = 0;
   if (vertexBuffer->getPerObjectBehaviour() == pbPerSurface)
   {
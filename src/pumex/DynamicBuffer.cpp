@@ -0,0 +1,170 @@
+//
+// Copyright(c) 2017-2018 Paweł Księżopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <pumex/DynamicBuffer.h>
+#include <algorithm>
+#include <cstring>
+#include <pumex/Descriptor.h>
+#include <pumex/Device.h>
+#include <pumex/PhysicalDevice.h>
+#include <pumex/RenderContext.h>
+#include <pumex/Surface.h>
+#include <pumex/Viewer.h>
+#include <pumex/Node.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+DynamicMemoryBuffer::DynamicMemoryBuffer(std::shared_ptr<DeviceMemoryAllocator> a, size_t ds, VkDescriptorType dt)
+  : Resource{ pbPerDevice, swOnce }, allocator{ a }, dataSize{ ds }, descriptorType{ dt }
+{
+  CHECK_LOG_THROW(descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, "DynamicMemoryBuffer : descriptor type must be VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC or VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC");
+  CHECK_LOG_THROW((allocator->getMemoryPropertyFlags() & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0, "DynamicMemoryBuffer : allocator must use host visible memory");
+}
+
+DynamicMemoryBuffer::~DynamicMemoryBuffer()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& pdd : perObjectData)
+  {
+    vkDestroyBuffer(pdd.second.device, pdd.second.data[0].buffer, nullptr);
+    allocator->deallocate(pdd.second.device, pdd.second.data[0].memoryBlock);
+    for (auto& retired : pdd.second.data[0].retiredBuffers)
+    {
+      vkDestroyBuffer(pdd.second.device, retired.buffer, nullptr);
+      allocator->deallocate(pdd.second.device, retired.memoryBlock);
+    }
+  }
+}
+
+std::pair<bool, VkDescriptorType> DynamicMemoryBuffer::getDefaultDescriptorType()
+{
+  return{ true, descriptorType };
+}
+
+void DynamicMemoryBuffer::validate(const RenderContext& renderContext)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto keyValue = getKeyID(renderContext, pbPerDevice);
+  auto pddit = perObjectData.find(keyValue);
+  if (pddit == end(perObjectData))
+    pddit = perObjectData.insert({ keyValue, DynamicBufferData(renderContext, swOnce) }).first;
+  auto& bufferData = pddit->second.data[0];
+
+  // replaced buffers are released when all frames that could use them are finished ( their fences were waited for )
+  uint64_t currentEpoch = Node::getEpoch();
+  auto retiredEnd = std::partition(begin(bufferData.retiredBuffers), end(bufferData.retiredBuffers), [&](const RetiredBuffer& rb) { return rb.epoch + activeCount + 1 > currentEpoch; });
+  for (auto rit = retiredEnd; rit != end(bufferData.retiredBuffers); ++rit)
+  {
+    vkDestroyBuffer(pddit->second.device, rit->buffer, nullptr);
+    allocator->deallocate(pddit->second.device, rit->memoryBlock);
+  }
+  bufferData.retiredBuffers.erase(retiredEnd, end(bufferData.retiredBuffers));
+
+  // each surface owns activeCount consecutive slots. Buffer is recreated when new surface or new swapchain image appears
+  uint32_t surfaceID         = renderContext.surface->getID();
+  uint32_t requiredSlotCount = (surfaceID + 1) * std::max(activeCount, renderContext.imageCount);
+  if (bufferData.slotCount < requiredSlotCount || bufferData.slotsPerSurface < renderContext.imageCount)
+  {
+    // buffer is sized for all surfaces known to the viewer, so that it is not recreated when next surfaces start to use it
+    auto viewer = renderContext.surface->viewer.lock();
+    uint32_t maxSurfaceID = surfaceID;
+    activeCount = std::max(activeCount, renderContext.imageCount);
+    for (auto id : viewer->getSurfaceIDs())
+    {
+      maxSurfaceID = std::max(maxSurfaceID, id);
+      activeCount  = std::max(activeCount, viewer->getSurface(id)->getImageCount());
+    }
+    for (auto& sd : surfaceData)
+      sd.second.updated.resize(activeCount, false);
+    requiredSlotCount = (maxSurfaceID + 1) * activeCount;
+
+    // buffer may still be used by command buffers of other surfaces and previous frames, so it is destroyed later
+    if (bufferData.buffer != VK_NULL_HANDLE)
+      bufferData.retiredBuffers.push_back(RetiredBuffer{ bufferData.buffer, bufferData.memoryBlock, currentEpoch });
+
+    auto physicalDevice    = renderContext.device->physical.lock();
+    VkDeviceSize alignment = (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) ? physicalDevice->properties.limits.minStorageBufferOffsetAlignment : physicalDevice->properties.limits.minUniformBufferOffsetAlignment;
+    alignment = std::max<VkDeviceSize>(1, alignment);
+    bufferData.slotSize        = ((std::max<VkDeviceSize>(1, dataSize) + alignment - 1) / alignment) * alignment;
+    bufferData.slotsPerSurface = activeCount;
+    bufferData.slotCount       = std::max(requiredSlotCount, bufferData.slotCount);
+
+    VkBufferCreateInfo bufferCreateInfo{};
+      bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      bufferCreateInfo.usage = (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+      bufferCreateInfo.size  = bufferData.slotSize * bufferData.slotCount;
+    VK_CHECK_LOG_THROW(vkCreateBuffer(pddit->second.device, &bufferCreateInfo, nullptr, &bufferData.buffer), "Cannot create a buffer");
+    VkMemoryRequirements memReqs;
+    vkGetBufferMemoryRequirements(pddit->second.device, bufferData.buffer, &memReqs);
+    bufferData.memoryBlock = allocator->allocate(renderContext.device, memReqs);
+    CHECK_LOG_THROW(bufferData.memoryBlock.alignedSize == 0, "Cannot create a buffer");
+    allocator->bindBufferMemory(renderContext.device, bufferData.buffer, bufferData.memoryBlock.alignedOffset);
+
+    // new buffer is empty, so all surfaces must send their data again
+    for (auto& sd : surfaceData)
+      std::fill(begin(sd.second.updated), end(sd.second.updated), false);
+    // all descriptor sets using this buffer must be written again - including the ones that belong to other surfaces.
+    // These descriptor sets are shared by frames in flight, so DescriptorSet::validate() writes new descriptor sets and retires old ones
+    for (auto& d : descriptors)
+      d.lock()->owner.lock()->notify();
+  }
+
+  auto sdit = surfaceData.find(surfaceID);
+  uint32_t activeIndex = renderContext.activeIndex % activeCount;
+  if (sdit == end(surfaceData) || sdit->second.updated[activeIndex])
+    return;
+  allocator->copyToDeviceMemory(renderContext.device, bufferData.memoryBlock.alignedOffset + (surfaceID * activeCount + activeIndex) * bufferData.slotSize, sdit->second.data.data(), dataSize, 0);
+  sdit->second.updated[activeIndex] = true;
+}
+
+DescriptorValue DynamicMemoryBuffer::getDescriptorValue(const RenderContext& renderContext)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perObjectData.find(getKeyID(renderContext, pbPerDevice));
+  if (pddit == end(perObjectData))
+    return DescriptorValue();
+  return DescriptorValue(pddit->second.data[0].buffer, 0, dataSize);
+}
+
+uint32_t DynamicMemoryBuffer::getDynamicOffset(const RenderContext& renderContext)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pddit = perObjectData.find(getKeyID(renderContext, pbPerDevice));
+  if (pddit == end(perObjectData))
+    return 0;
+  return (renderContext.surface->getID() * pddit->second.data[0].slotsPerSurface + renderContext.activeIndex % activeCount) * pddit->second.data[0].slotSize;
+}
+
+void DynamicMemoryBuffer::setData(Surface* surface, const void* data, size_t size)
+{
+  CHECK_LOG_THROW(size != dataSize, "DynamicMemoryBuffer::setData() : wrong data size " << size << ". Expected " << dataSize);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& sd = surfaceData[surface->getID()];
+    sd.data.resize(dataSize);
+    std::memcpy(sd.data.data(), data, dataSize);
+    sd.updated.assign(activeCount, false);
+  }
+  invalidateDescriptors();
+}
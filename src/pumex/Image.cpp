@@ -131,8 +131,7 @@ ImageTraits::ImageTraits(VkFormat f, ImageSize imSize, VkImageUsageFlags u, bool
 {
 }
 
-Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAllocator> a)
-  : imageTraits{ it }, device(d->device), allocator{ a }, ownsImage{ true }
+static VkImage createImage(VkDevice device, const ImageTraits& imageTraits)
 {
   VkImageCreateInfo imageCI{};
     imageCI.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -149,7 +148,15 @@ Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAlloc
 //    imageCI.queueFamilyIndexCount;
 //    imageCI.pQueueFamilyIndices;
     imageCI.initialLayout = imageTraits.initialLayout;
+  VkImage image;
   VK_CHECK_LOG_THROW(vkCreateImage(device, &imageCI, nullptr, &image), "failed vkCreateImage");
+  return image;
+}
+
+Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAllocator> a)
+  : imageTraits{ it }, device(d->device), allocator{ a }, ownsImage{ true }
+{
+  image = createImage(device, imageTraits);
 
   VkMemoryRequirements memReqs;
   vkGetImageMemoryRequirements(device, image, &memReqs);
@@ -159,6 +166,22 @@ Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<DeviceMemoryAlloc
   VK_CHECK_LOG_THROW(vkBindImageMemory(device, image, memoryBlock.memory, memoryBlock.alignedOffset), "failed vkBindImageMemory");
 }
 
+Image::Image(Device* d, const ImageTraits& it, std::shared_ptr<SharedMemoryBlock> sm, VkDeviceSize smo)
+  : imageTraits{ it }, device(d->device), sharedMemory{ sm }, ownsImage{ true }
+{
+  image = createImage(device, imageTraits);
+
+  VkMemoryRequirements memReqs;
+  vkGetImageMemoryRequirements(device, image, &memReqs);
+
+  const DeviceMemoryBlock& sharedBlock = sharedMemory->getMemoryBlock();
+  VkDeviceSize offset = sharedBlock.alignedOffset + smo;
+  CHECK_LOG_THROW(offset % memReqs.alignment != 0, "Image offset in shared memory block is not aligned");
+  CHECK_LOG_THROW(smo + memReqs.size > sharedBlock.alignedSize, "Image does not fit into shared memory block");
+  memoryBlock = DeviceMemoryBlock(sharedBlock.memory, offset, offset, memReqs.size, memReqs.size);
+  VK_CHECK_LOG_THROW(vkBindImageMemory(device, image, memoryBlock.memory, memoryBlock.alignedOffset), "failed vkBindImageMemory");
+}
+
 Image::Image(Device* d, VkImage i, VkFormat format, const ImageSize& imageSize)
   : device(d->device), image{ i }, ownsImage{  false }
 {
@@ -172,7 +195,9 @@ Image::~Image()
   if (ownsImage)
   {
     vkDestroyImage(device, image, nullptr);
-    allocator->deallocate(device, memoryBlock);
+    // memory shared with other objects is released by SharedMemoryBlock
+    if (sharedMemory == nullptr)
+      allocator->deallocate(device, memoryBlock);
   }
 }
 
@@ -202,6 +227,15 @@ TextureLoader::TextureLoader(const std::vector<std::string>& fileExtensions)
 namespace pumex
 {
 
+VkMemoryRequirements getImageMemoryRequirements(Device* device, const ImageTraits& imageTraits)
+{
+  VkImage image = createImage(device->device, imageTraits);
+  VkMemoryRequirements memReqs;
+  vkGetImageMemoryRequirements(device->device, image, &memReqs);
+  vkDestroyImage(device->device, image, nullptr);
+  return memReqs;
+}
+
 ImageTraits getImageTraitsFromTexture(const gli::texture& texture, VkImageUsageFlags usage)
 {
   auto t = texture.extent(0);
@@ -21,6 +21,7 @@
 //
 
 #include <pumex/MaterialSet.h>
+#include <algorithm>
 #include <pumex/Asset.h>
 #include <pumex/Sampler.h>
 #include <pumex/MemoryImage.h>
@@ -29,6 +30,8 @@
 #include <pumex/CombinedImageSampler.h>
 #include <pumex/SampledImage.h>
 #include <pumex/StorageImage.h>
+#include <pumex/TextureResidencyManager.h>
+#include <pumex/Node.h>
 
 using namespace pumex;
 
@@ -36,6 +39,19 @@ TextureRegistryBase::~TextureRegistryBase()
 {
 }
 
+void TextureRegistryBase::reportTextureUsage(uint32_t slotIndex, uint32_t layerIndex, unsigned long long frameNumber)
+{
+}
+
+void TextureRegistryBase::update(unsigned long long frameNumber)
+{
+}
+
+uint32_t TextureRegistryBase::getTextureIndex(uint32_t slotIndex, uint32_t layerIndex) const
+{
+  return layerIndex;
+}
+
 MaterialRegistryBase::~MaterialRegistryBase()
 {
 }
@@ -48,6 +64,10 @@ MaterialSet::MaterialSet(std::shared_ptr<Viewer> v, std::shared_ptr<MaterialRegi
 
   for (const auto& s : semantics)
     textureNames[s.index] = std::vector<std::string>();
+
+  // texture registries may need per frame work ( e.g. releasing replaced textures )
+  if (textureRegistry != nullptr)
+    v->addTextureRegistry(textureRegistry);
 }
 
 MaterialSet::~MaterialSet()
@@ -81,7 +101,7 @@ void MaterialSet::registerMaterials(uint32_t typeID, std::shared_ptr<Asset> asse
   uint32_t materialOffset = materialRegistry->getMaterials(typeID).size();
   for (uint32_t m = 0; m < asset->materials.size(); ++m)
   {
-    std::map<TextureSemantic::Type, uint32_t> registeredTextures = registerTextures(asset->materials[m]);
+    std::map<TextureSemantic::Type, uint32_t> registeredTextures = registerTextures(typeID, asset->materials[m]);
     materialRegistry->registerMaterial(typeID, 0, materialOffset+m, asset->materials[m], registeredTextures);
   }
 
@@ -116,7 +136,7 @@ void MaterialSet::registerMaterialVariant(uint32_t typeID, uint32_t materialVari
   CHECK_LOG_THROW(materialVariant == 0, "Cannot register material variant with index == 0");
   for (uint32_t m = 0; m < materials.size(); ++m)
   {
-    std::map<TextureSemantic::Type, uint32_t> registeredTextures = registerTextures(materials[m]);
+    std::map<TextureSemantic::Type, uint32_t> registeredTextures = registerTextures(typeID, materials[m]);
     materialRegistry->registerMaterial(typeID, materialVariant, m, materials[m], registeredTextures);
   }
 }
@@ -128,6 +148,15 @@ void MaterialSet::endRegisterMaterials()
   materialVariantBuffer->invalidateData();
 }
 
+void MaterialSet::reportMaterialTypeUsage(uint32_t typeID, unsigned long long frameNumber)
+{
+  auto it = typeTextures.find(typeID);
+  if (it == end(typeTextures))
+    return;
+  for (const auto& tex : it->second)
+    textureRegistry->reportTextureUsage(tex.first, tex.second, frameNumber);
+}
+
 std::vector<Material> MaterialSet::getMaterials(uint32_t typeID) const
 {
   return materialRegistry->getMaterials(typeID);
@@ -138,7 +167,7 @@ uint32_t MaterialSet::getMaterialVariantCount(uint32_t typeID) const
   return materialRegistry->getMaterialVariantCount(typeID);
 }
 
-std::map<TextureSemantic::Type, uint32_t> MaterialSet::registerTextures(const Material& mat)
+std::map<TextureSemantic::Type, uint32_t> MaterialSet::registerTextures(uint32_t typeID, const Material& mat)
 {
   // register all found textures for a given material
   std::map<TextureSemantic::Type, uint32_t> registeredTextures;
@@ -168,7 +197,8 @@ std::map<TextureSemantic::Type, uint32_t> MaterialSet::registerTextures(const Ma
           CHECK_LOG_THROW(tex->empty(), "Texture not loaded : " << it->second);
           textureRegistry->setTexture(s.index, textureIndex, tex);
         }
-        registeredTextures[s.type] = textureIndex;
+        registeredTextures[s.type] = textureRegistry->getTextureIndex(s.index, textureIndex);
+        typeTextures[typeID].insert({ s.index, textureIndex });
       }
     }
   }
@@ -273,4 +303,112 @@ void TextureRegistryArrayOfTextures::setTexture(uint32_t slotIndex, uint32_t lay
     rit->second[layerIndex] = std::make_shared<StorageImage>(std::make_shared<ImageView>(it->second[layerIndex], it->second[layerIndex]->getFullImageRange(), VK_IMAGE_VIEW_TYPE_2D));
     break;
   }
+  if (residencyManager != nullptr)
+  {
+    auto& ids = residencyIDs[slotIndex];
+    if (layerIndex >= ids.size())
+      ids.resize(layerIndex + 1, std::numeric_limits<uint32_t>::max());
+    ids[layerIndex] = residencyManager->registerTexture(it->second[layerIndex], tex);
+  }
+}
+
+void TextureRegistryArrayOfTextures::reportTextureUsage(uint32_t slotIndex, uint32_t layerIndex, unsigned long long frameNumber)
+{
+  if (residencyManager == nullptr)
+    return;
+  auto it = residencyIDs.find(slotIndex);
+  if (it == end(residencyIDs) || layerIndex >= it->second.size() || it->second[layerIndex] == std::numeric_limits<uint32_t>::max())
+    return;
+  residencyManager->reportUsage(it->second[layerIndex], frameNumber);
+}
+
+void TextureRegistryArrayOfTextures::setResidencyManager(std::shared_ptr<TextureResidencyManager> rm)
+{
+  for (const auto& mi : memoryImages)
+    CHECK_LOG_THROW(!mi.second.empty(), "Residency manager must be set before textures are registered. Slot index " << mi.first);
+  residencyManager = rm;
+}
+
+std::shared_ptr<TextureResidencyManager> TextureRegistryArrayOfTextures::getResidencyManager() const
+{
+  return residencyManager;
+}
+
+TextureRegistryBindless::TextureRegistryBindless(std::shared_ptr<DeviceMemoryAllocator> textureAlloc, std::shared_ptr<Sampler> sampler, uint32_t mt)
+  : textureAllocator{ textureAlloc }, textureSampler{ sampler }, maxTextures{ mt }
+{
+}
+
+DescriptorSetLayoutBinding TextureRegistryBindless::getLayoutBinding(uint32_t binding, VkShaderStageFlags stageFlags) const
+{
+  return DescriptorSetLayoutBinding(binding, maxTextures, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stageFlags, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT);
+}
+
+void TextureRegistryBindless::addDescriptorSet(std::shared_ptr<DescriptorSet> descriptorSet, uint32_t binding)
+{
+  {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    descriptorSets.push_back({ descriptorSet, binding });
+  }
+  if (!resources.empty())
+    descriptorSet->setDescriptor(binding, resources, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+}
+
+void TextureRegistryBindless::setTexture(uint32_t slotIndex, uint32_t layerIndex, std::shared_ptr<gli::texture> tex)
+{
+  uint32_t textureIndex;
+  auto it = textureIndices.find({ slotIndex, layerIndex });
+  if (it == end(textureIndices))
+  {
+    CHECK_LOG_THROW(resources.size() >= maxTextures, "Bindless texture registry is full. Maximum number of textures : " << maxTextures);
+    textureIndex = resources.size();
+    textureIndices.insert({ { slotIndex, layerIndex }, textureIndex });
+    memoryImages.push_back(nullptr);
+    resources.push_back(nullptr);
+  }
+  else
+  {
+    textureIndex = it->second;
+    // Descriptor sets using bindless layout are created for each swapchain image, so array element is rewritten only in descriptor set
+    // whose previous frame has already finished. Descriptor sets of other swapchain images still point to replaced texture until their turn comes
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retiredTextures.push_back(RetiredTexture{ memoryImages[textureIndex], resources[textureIndex], Node::getEpoch() });
+  }
+
+  // this texture will not be modified by GPU, so it is enough to declare it as swOnce
+  memoryImages[textureIndex] = std::make_shared<MemoryImage>(tex, textureAllocator, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, pbPerDevice);
+  resources[textureIndex]    = std::make_shared<CombinedImageSampler>(std::make_shared<ImageView>(memoryImages[textureIndex], memoryImages[textureIndex]->getFullImageRange(), vulkanViewTypeFromGliTarget(tex->target())), textureSampler);
+  for (auto& ds : descriptorSets)
+  {
+    auto descriptorSet = ds.first.lock();
+    if (descriptorSet != nullptr)
+      descriptorSet->setDescriptorElement(ds.second, textureIndex, resources[textureIndex], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+  }
+}
+
+void TextureRegistryBindless::update(unsigned long long frameNumber)
+{
+  releaseRetiredTextures();
+}
+
+void TextureRegistryBindless::releaseRetiredTextures()
+{
+  // texture is not used when all descriptor sets were rewritten ( one frame per swapchain image ) and the last frame using it is finished
+  std::lock_guard<std::mutex> lock(retiredMutex);
+  uint32_t retireFrames = 1;
+  for (auto& ds : descriptorSets)
+  {
+    auto descriptorSet = ds.first.lock();
+    if (descriptorSet != nullptr)
+      retireFrames = std::max(retireFrames, descriptorSet->getActiveCount() + 1);
+  }
+  uint64_t currentEpoch = Node::getEpoch();
+  retiredTextures.erase(std::remove_if(begin(retiredTextures), end(retiredTextures), [&](const RetiredTexture& rt) { return rt.epoch + retireFrames <= currentEpoch; }), end(retiredTextures));
+}
+
+uint32_t TextureRegistryBindless::getTextureIndex(uint32_t slotIndex, uint32_t layerIndex) const
+{
+  auto it = textureIndices.find({ slotIndex, layerIndex });
+  CHECK_LOG_THROW(it == end(textureIndices), "There's no texture registered. Slot index " << slotIndex << " layer index " << layerIndex);
+  return it->second;
 }
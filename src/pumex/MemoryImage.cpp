@@ -26,6 +26,7 @@
 #include <pumex/Command.h>
 #include <pumex/RenderContext.h>
 #include <pumex/Resource.h>
+#include <pumex/TransientResourcePool.h>
 #include <pumex/utils/Buffer.h>
 #include <pumex/utils/Log.h>
 #include <algorithm>
@@ -34,19 +35,26 @@ using namespace pumex;
 
 struct SetImageTraitsOperation : public MemoryImage::Operation
 {
-  SetImageTraitsOperation(MemoryImage* o, const ImageTraits& t, VkImageAspectFlags am, uint32_t ac)
-    : MemoryImage::Operation(o, MemoryImage::Operation::SetImageTraits, ImageSubresourceRange(am, 0, t.imageSize.mipLevels, 0, t.imageSize.arrayLayers), ac), imageTraits{ t }
+  SetImageTraitsOperation(MemoryImage* o, const ImageTraits& t, VkImageAspectFlags am, uint32_t ac, std::shared_ptr<SharedMemoryBlock> sm = nullptr, VkDeviceSize smo = 0)
+    : MemoryImage::Operation(o, MemoryImage::Operation::SetImageTraits, ImageSubresourceRange(am, 0, t.imageSize.mipLevels, 0, t.imageSize.arrayLayers), ac), imageTraits{ t }, sharedMemory{ sm }, sharedMemoryOffset{ smo }
   {}
   bool perform(const RenderContext& renderContext, MemoryImage::MemoryImageInternal& internals, std::shared_ptr<CommandBuffer> commandBuffer) override
   {
     internals.image = nullptr; // release image before creating a new one
-    internals.image = std::make_shared<Image>(renderContext.device, imageTraits, owner->getAllocator());
+    if (sharedMemory != nullptr)
+      internals.image = std::make_shared<Image>(renderContext.device, imageTraits, sharedMemory, sharedMemoryOffset);
+    else if (owner->usesTransientResourcePooling() && imageTraits.initialLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+      internals.image = renderContext.device->getTransientResourcePool()->acquireImage(imageTraits, owner->getAllocator());
+    else
+      internals.image = std::make_shared<Image>(renderContext.device, imageTraits, owner->getAllocator());
     owner->notifyCommandBufferSources(renderContext);
     owner->notifyImageViews(renderContext, imageRange);
     // no operations sent to command buffer
     return false;
   }
-  ImageTraits imageTraits;
+  ImageTraits                        imageTraits;
+  std::shared_ptr<SharedMemoryBlock> sharedMemory;
+  VkDeviceSize                       sharedMemoryOffset;
 };
 
 struct SetImageOperation : public MemoryImage::Operation
@@ -68,9 +76,17 @@ struct SetImageOperation : public MemoryImage::Operation
 
     if (memoryIsLocal)
     {
-      // copy texture data to staging buffer manually
-      auto stagingBuffer = renderContext.device->acquireStagingBuffer(nullptr, texture->size());
-      unsigned char* mapAddress = (unsigned char*)stagingBuffer->mapMemory(texture->size());
+      // copy texture data to staging memory manually
+      VkDeviceSize stagingSize = 0;
+      for (uint32_t level = sourceRange.baseMipLevel; level < sourceRange.baseMipLevel + sourceRange.levelCount; ++level)
+        stagingSize += texture->size(level);
+      stagingSize *= sourceRange.layerCount;
+      // buffer offset must be a multiple of 4 and a multiple of texel block size
+      VkDeviceSize alignment = gli::block_size(texture->format());
+      while (alignment % 4 != 0)
+        alignment *= 2;
+      StagingAllocation staging = renderContext.device->acquireStagingMemory(commandBuffer.get(), nullptr, stagingSize, alignment);
+      unsigned char* mapAddress = (unsigned char*)staging.mappedData;
       size_t offset = 0;
       for (uint32_t layer = sourceRange.baseArrayLayer; layer < sourceRange.baseArrayLayer + sourceRange.layerCount; ++layer)
       {
@@ -80,7 +96,6 @@ struct SetImageOperation : public MemoryImage::Operation
           offset += texture->size(level);
         }
       }
-      stagingBuffer->unmapMemory();
 
       // we have to copy a texture to local device memory using staging buffers
       std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -98,7 +113,7 @@ struct SetImageOperation : public MemoryImage::Operation
             bufferCopyRegion.imageExtent.width               = static_cast<uint32_t>(mipMapExtents.x);
             bufferCopyRegion.imageExtent.height              = static_cast<uint32_t>(mipMapExtents.y);
             bufferCopyRegion.imageExtent.depth               = static_cast<uint32_t>(mipMapExtents.z);
-            bufferCopyRegion.bufferOffset                    = offset;
+            bufferCopyRegion.bufferOffset                    = staging.offset + offset;
           bufferCopyRegions.push_back(bufferCopyRegion);
 
           // Increase offset into staging buffer for next level / face
@@ -110,12 +125,10 @@ struct SetImageOperation : public MemoryImage::Operation
       commandBuffer->setImageLayout( *(internals.image), aspectMask, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
       // Copy mip levels from staging buffer
-      commandBuffer->cmdCopyBufferToImage(stagingBuffer->buffer, *(internals.image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopyRegions);
+      commandBuffer->cmdCopyBufferToImage(staging.buffer, *(internals.image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, bufferCopyRegions);
 
       // Change texture image layout to shader read after all mip levels have been copied
       commandBuffer->setImageLayout( *(internals.image), aspectMask, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
-
-      stagingBuffers.push_back(stagingBuffer);
     }
     else
     {
@@ -145,16 +158,9 @@ struct SetImageOperation : public MemoryImage::Operation
     // if memory is accessible from host ( is not local ) - we generated no commands to command buffer
     return memoryIsLocal;
   }
-  void releaseResources(const RenderContext& renderContext) override
-  {
-    for (auto& s : stagingBuffers)
-      renderContext.device->releaseStagingBuffer(s);
-    stagingBuffers.clear();
-  }
 
   std::shared_ptr<gli::texture>               texture;
   ImageSubresourceRange                       sourceRange;
-  std::vector<std::shared_ptr<StagingBuffer>> stagingBuffers;
 };
 
 struct NotifyImageViewsOperation : public MemoryImage::Operation
@@ -242,12 +248,12 @@ void MemoryImage::setImageTraits(const ImageTraits& traits)
   invalidateImageViews();
 }
 
-void MemoryImage::setImageTraits(Surface* surface, const ImageTraits& traits)
+void MemoryImage::setImageTraits(Surface* surface, const ImageTraits& traits, std::shared_ptr<SharedMemoryBlock> sharedMemory, VkDeviceSize sharedMemoryOffset)
 {
   CHECK_LOG_THROW(perObjectBehaviour != pbPerSurface, "Cannot set image traits per surface for this texture");
   CHECK_LOG_THROW(sameTraitsPerObject, "Cannot set traits per surface - Texture uses the same traits per each surface");
   std::lock_guard<std::mutex> lock(mutex);
-  internalSetImageTraits(surface->getID(), surface->device.lock()->device, surface->surface, traits, aspectMask);
+  internalSetImageTraits(surface->getID(), surface->device.lock()->device, surface->surface, traits, aspectMask, sharedMemory, sharedMemoryOffset);
 }
 
 void MemoryImage::setImageTraits(Device* device, const ImageTraits& traits)
@@ -325,6 +331,38 @@ void MemoryImage::setImageLayer(uint32_t layer, std::shared_ptr<gli::texture> te
   invalidateImageViews();
 }
 
+void MemoryImage::setTexture(std::shared_ptr<gli::texture> tex)
+{
+  CHECK_LOG_THROW(texture == nullptr, "Cannot set texture - wrong constructor used to create an object");
+  CHECK_LOG_THROW(tex == nullptr, "Cannot set empty texture");
+  CHECK_LOG_THROW(tex->base_level() != 0, "Cannot set texture when base_level != 0");
+  CHECK_LOG_THROW(tex->base_layer() != 0, "Cannot set texture when base_layer != 0");
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ImageSubresourceRange oldRange(aspectMask, 0, imageTraits.imageSize.mipLevels, 0, imageTraits.imageSize.arrayLayers);
+  texture     = tex;
+  imageTraits = getImageTraitsFromTexture(*texture, imageTraits.usage);
+  ImageSubresourceRange newRange(aspectMask, 0, imageTraits.imageSize.mipLevels, 0, imageTraits.imageSize.arrayLayers);
+
+  // image views that covered the whole image must cover the whole new image
+  for (auto& iv : imageViews)
+  {
+    auto imageView = iv.lock();
+    if (imageView != nullptr && imageView->subresourceRange == oldRange)
+      imageView->subresourceRange = newRange;
+  }
+
+  for (auto& pdd : perObjectData)
+  {
+    // remove all previous calls to setImageTraits and setImage - new image will be created
+    pdd.second.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImageTraits || texop->type == MemoryImage::Operation::SetImage; });
+    pdd.second.commonData.imageOperations.push_back(std::make_shared<SetImageTraitsOperation>(this, imageTraits, aspectMask, activeCount));
+    pdd.second.commonData.imageOperations.push_back(std::make_shared<SetImageOperation>(this, newRange, newRange, texture, activeCount));
+    pdd.second.invalidate();
+  }
+  invalidateImageViews();
+}
+
 void MemoryImage::setImages(Surface* surface, std::vector<std::shared_ptr<Image>>& images)
 {
   CHECK_LOG_THROW(perObjectBehaviour != pbPerSurface, "Cannot set foreign images per surface for this texture");
@@ -489,7 +527,7 @@ void MemoryImage::invalidateImageViews()
 }
 
 // caution : mutex lock must be called prior to this method
-void MemoryImage::internalSetImageTraits(uint32_t key, VkDevice device, VkSurfaceKHR surface, const ImageTraits& traits, VkImageAspectFlags aMask)
+void MemoryImage::internalSetImageTraits(uint32_t key, VkDevice device, VkSurfaceKHR surface, const ImageTraits& traits, VkImageAspectFlags aMask, std::shared_ptr<SharedMemoryBlock> sharedMemory, VkDeviceSize sharedMemoryOffset)
 {
   auto pddit = perObjectData.find(key);
   if (pddit == end(perObjectData))
@@ -498,7 +536,7 @@ void MemoryImage::internalSetImageTraits(uint32_t key, VkDevice device, VkSurfac
   // remove all previous calls to setImageTraits
   pddit->second.commonData.imageOperations.remove_if([](std::shared_ptr<Operation> texop) { return texop->type == MemoryImage::Operation::SetImageTraits; });
   // add setImageTraits operation
-  pddit->second.commonData.imageOperations.push_back(std::make_shared<SetImageTraitsOperation>(this, traits, aMask, activeCount));
+  pddit->second.commonData.imageOperations.push_back(std::make_shared<SetImageTraitsOperation>(this, traits, aMask, activeCount, sharedMemory, sharedMemoryOffset));
   pddit->second.invalidate();
   invalidateImageViews();
 }
@@ -27,9 +27,13 @@
 #include <pumex/Surface.h>
 #include <pumex/utils/Log.h>
 #include <algorithm>
+#include <atomic>
 
 using namespace pumex;
 
+std::atomic<uint64_t> nodeStructureVersion{ 0 };
+std::atomic<uint64_t> nodeEpoch{ 1 };
+
 Node::Node()
 {
 }
@@ -87,11 +91,44 @@ bool Node::isInSecondaryBuffer()
   return false;
 }
 
+std::shared_ptr<DrawList> Node::getDrawList() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return drawList;
+}
+
+void Node::setDrawList(std::shared_ptr<DrawList> dl)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  drawList = dl;
+}
+
+uint64_t Node::getStructureVersion()
+{
+  return nodeStructureVersion.load();
+}
+
+void Node::structureChanged()
+{
+  nodeStructureVersion++;
+}
+
+uint64_t Node::getEpoch()
+{
+  return nodeEpoch.load();
+}
+
+void Node::advanceEpoch()
+{
+  nodeEpoch++;
+}
+
 void Node::setDescriptorSet(uint32_t index, std::shared_ptr<DescriptorSet> descriptorSet)
 {
   std::lock_guard<std::mutex> lock(mutex);
   descriptorSets[index] = descriptorSet;
   descriptorSet->addNode(std::dynamic_pointer_cast<Node>(shared_from_this()));
+  structureChanged();
   invalidateParentsDescriptor();
 }
 
@@ -103,6 +140,7 @@ void Node::resetDescriptorSet(uint32_t index)
     return;
   it->second->removeNode(std::dynamic_pointer_cast<Node>(shared_from_this()));
   descriptorSets.erase(it);
+  structureChanged();
   invalidateParentsDescriptor();
 }
 
@@ -134,14 +172,16 @@ bool Node::nodeValidate(const RenderContext& renderContext)
     pddit->second.commonData.secondaryCommandPool->validate(renderContext.device);
     pddit->second.commonData.secondaryCommandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_SECONDARY, renderContext.device, pddit->second.commonData.secondaryCommandPool, activeCount);
   }
+  // modifications are compared using >= , because node may be modified by update thread in the same epoch, after it was validated
   uint32_t activeIndex = renderContext.activeIndex % activeCount;
-  if (pddit->second.valid[activeIndex])
-    return !pddit->second.data[activeIndex].childNodesValid;
-
-  validate(renderContext);
-
-  pddit->second.valid[activeIndex] = true;
-  return !pddit->second.data[activeIndex].childNodesValid;
+  auto& nodeData       = pddit->second.data[activeIndex];
+  if (!pddit->second.valid[activeIndex] || modifiedEpoch.load() >= nodeData.validatedEpoch)
+  {
+    validate(renderContext);
+    pddit->second.valid[activeIndex] = true;
+    nodeData.validatedEpoch          = getEpoch();
+  }
+  return !nodeData.childNodesValid || childNodesModifiedEpoch.load() >= nodeData.childNodesValidatedEpoch;
 }
 
 void Node::setChildNodesValid(const RenderContext& renderContext)
@@ -151,40 +191,23 @@ void Node::setChildNodesValid(const RenderContext& renderContext)
   if (pddit == end(perObjectData))
     return;
   uint32_t activeIndex = renderContext.activeIndex % activeCount;
-  pddit->second.data[activeIndex].childNodesValid = true;
+  pddit->second.data[activeIndex].childNodesValid          = true;
+  pddit->second.data[activeIndex].childNodesValidatedEpoch = getEpoch();
 }
 
 void Node::invalidateNodeAndParents()
 {
-  for (auto& pdd : perObjectData)
-    pdd.second.invalidate();
+  uint64_t epoch = getEpoch();
+  modifiedEpoch  = epoch;
   if(!hasSecondaryBuffer())
     for (auto& parent : parents)
-      parent.lock()->invalidateParentsNode();
+      parent.lock()->childNodesModified(epoch);
 }
 
 void Node::invalidateNodeAndParents(Surface* surface)
 {
-  if (activeCount < surface->getImageCount())
-  {
-    activeCount = surface->getImageCount();
-    for (auto& pdd : perObjectData)
-      pdd.second.resize(activeCount);
-  }
-  auto pddit = perObjectData.find(surface->getID());
-  if (pddit == end(perObjectData))
-    pddit = perObjectData.insert({ surface->getID(), NodeData(surface->device.lock()->device, surface->surface, activeCount, swForEachImage) }).first;
-  //if (secondaryBufferPresent && pddit->second.commonData.secondaryCommandPool==nullptr)
-  //{
-  //  Device* device = surface->device.lock().get();
-  //  pddit->second.commonData.secondaryCommandPool = std::make_shared<CommandPool>(surface->getPresentationQueue()->familyIndex);
-  //  pddit->second.commonData.secondaryCommandPool->validate(device);
-  //  pddit->second.commonData.secondaryCommandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_SECONDARY, device, pddit->second.commonData.secondaryCommandPool, activeCount);
-  //}
-  pddit->second.invalidate();
-  if (!hasSecondaryBuffer())
-    for (auto& parent : parents)
-      parent.lock()->invalidateParentsNode(surface);
+  // epoch stamps are shared by all surfaces - node is validated again on each surface that uses it
+  invalidateNodeAndParents();
 }
 
 void Node::invalidateDescriptorsAndParents()
@@ -227,6 +250,7 @@ void Node::useSecondaryBuffer()
   std::lock_guard<std::mutex> lock(mutex);
   CHECK_LOG_THROW(isInSecondaryBuffer() && !secondaryBufferPresent, "Cannot set secondary buffer : one of the parents uses secondary buffer already");
   secondaryBufferPresent = true;
+  structureChanged();
   invalidateNodeAndParents();
   for (auto& p : parents)
     p.lock()->checkChildrenForSecondaryBuffers();
@@ -281,56 +305,13 @@ bool Node::hasSecondaryBufferChildren()
   return false; // only groups can have children
 }
 
-void Node::invalidateParentsNode()
+void Node::childNodesModified(uint64_t epoch)
 {
-  bool needInvalidateParents = false;
-  for (auto& pdd : perObjectData)
-  {
-    for (uint32_t i = 0; i < pdd.second.data.size(); ++i)
-    {
-      if (pdd.second.data[i].childNodesValid)
-      {
-        pdd.second.data[i].childNodesValid = false;
-        needInvalidateParents = true;
-      }
-    }
-  }
-  if( needInvalidateParents &&  !hasSecondaryBuffer() )
-    for (auto& parent : parents)
-      parent.lock()->invalidateParentsNode();
-}
-
-void Node::invalidateParentsNode(Surface* surface)
-{
-  if (activeCount < surface->getImageCount())
-  {
-    activeCount = surface->getImageCount();
-    for (auto& pdd : perObjectData)
-      pdd.second.resize(activeCount);
-  }
-  auto pddit = perObjectData.find(surface->getID());
-  if (pddit == end(perObjectData))
-    pddit = perObjectData.insert({ surface->getID(), NodeData(surface->device.lock()->device, surface->surface, activeCount, swForEachImage) }).first;
-  if (secondaryBufferPresent && pddit->second.commonData.secondaryCommandPool == nullptr)
-  {
-    pddit->second.commonData.secondaryCommandPool   = std::make_shared<CommandPool>(surface->getPresentationQueue()->familyIndex);
-    Device* device = surface->device.lock().get();
-    pddit->second.commonData.secondaryCommandPool->validate(device);
-    pddit->second.commonData.secondaryCommandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_SECONDARY, device, pddit->second.commonData.secondaryCommandPool, activeCount);
-  }
-
-  bool needInvalidateParents = false;
-  for (uint32_t i = 0; i < pddit->second.data.size(); ++i)
-  {
-    if (pddit->second.data[i].childNodesValid)
-    {
-      pddit->second.data[i].childNodesValid = false;
-      needInvalidateParents = true;
-    }
-  }
-  if (needInvalidateParents && !hasSecondaryBuffer())
+  if (childNodesModifiedEpoch.exchange(epoch) == epoch)
+    return;
+  if (!hasSecondaryBuffer())
     for (auto& parent : parents)
-      parent.lock()->invalidateParentsNode(surface);
+      parent.lock()->childNodesModified(epoch);
 }
 
 void Node::invalidateParentsDescriptor()
@@ -416,6 +397,7 @@ void Group::addChild(std::shared_ptr<Node> child)
   CHECK_LOG_THROW(isInSecondaryBuffer() && ( child->hasSecondaryBuffer() || child->hasSecondaryBufferChildren() ), "Cannot add child : both parent and child have secondary buffers already")
   children.push_back(child);
   child->addParent(std::dynamic_pointer_cast<Group>(shared_from_this()));
+  structureChanged();
   checkChildrenForSecondaryBuffers();
   child->invalidateNodeAndParents();
 }
@@ -428,8 +410,9 @@ bool Group::removeChild(std::shared_ptr<Node> child)
     return false;
   child->removeParent(std::dynamic_pointer_cast<Group>(shared_from_this()));
   children.erase(it);
+  structureChanged();
   checkChildrenForSecondaryBuffers();
-  invalidateParentsNode();
+  childNodesModified(getEpoch());
   child->invalidateNodeAndParents();
   return true;
 }
@@ -440,6 +423,7 @@ void Group::useSecondaryBuffer()
   CHECK_LOG_THROW(hasSecondaryBufferChildren(), "Cannot set secondary buffer : one of the children uses secondary buffer already");
   CHECK_LOG_THROW(isInSecondaryBuffer() && !secondaryBufferPresent, "Cannot set secondary buffer : one of the parents uses secondary buffer already");
   secondaryBufferPresent = true;
+  structureChanged();
   invalidateNodeAndParents();
   for (auto& p : parents)
     p.lock()->checkChildrenForSecondaryBuffers();
@@ -26,6 +26,7 @@
 #include <pumex/DrawNode.h>
 #include <pumex/DispatchNode.h>
 #include <pumex/CopyNode.h>
+#include <pumex/PushConstantsNode.h>
 
 using namespace pumex;
 
@@ -81,3 +82,8 @@ void NodeVisitor::apply(CopyNode& node)
 {
   apply(static_cast<Node&>(node));
 }
+
+void NodeVisitor::apply(PushConstantsNode& node)
+{
+  apply(static_cast<Group&>(node));
+}
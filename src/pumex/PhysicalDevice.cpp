@@ -29,7 +29,7 @@
 using namespace pumex;
 
 PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
-  : physicalDevice{ device }, properties{}, multiViewProperties{}, features{}, multiViewFeatures{}
+  : physicalDevice{ device }, properties{}, multiViewProperties{}, features{}, multiViewFeatures{}, descriptorIndexingFeatures{}, descriptorIndexingProperties{}
 {
   // collect all available data about the device with or without VK_KHR_get_physical_device_properties2 extension
 
@@ -54,6 +54,8 @@ PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
 
     viewer->pfn_vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
     features = features2.features;
+
+    pfn_vkGetPhysicalDeviceMemoryProperties2 = viewer->pfn_vkGetPhysicalDeviceMemoryProperties2;
   }
   else
   {
@@ -72,6 +74,26 @@ PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, Viewer* viewer)
     VK_CHECK_LOG_THROW(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data()), "failed vkEnumerateDeviceExtensionProperties" << extensionCount);
   }
 
+  // descriptor indexing structures may be chained only when device implements the extension
+  if (viewer->instanceExtensionEnabled(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) && deviceExtensionImplemented(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+  {
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+
+    properties2.pNext                  = &descriptorIndexingProperties;
+    descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    viewer->pfn_vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+    features2.pNext                  = &descriptorIndexingFeatures;
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    viewer->pfn_vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+  }
+
   uint32_t queueFamilyCount;
   vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
   if(queueFamilyCount > 0)
@@ -98,6 +120,27 @@ PhysicalDevice::~PhysicalDevice()
 
 }
 
+bool PhysicalDevice::getMemoryBudget(std::vector<VkDeviceSize>& heapBudget, std::vector<VkDeviceSize>& heapUsage) const
+{
+#if defined(VK_EXT_memory_budget)
+  if (pfn_vkGetPhysicalDeviceMemoryProperties2 == nullptr || !deviceExtensionImplemented(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    return false;
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+    memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties2.pNext = &budgetProperties;
+  pfn_vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+
+  uint32_t heapCount = memoryProperties2.memoryProperties.memoryHeapCount;
+  heapBudget.assign(budgetProperties.heapBudget, budgetProperties.heapBudget + heapCount);
+  heapUsage.assign(budgetProperties.heapUsage, budgetProperties.heapUsage + heapCount);
+  return true;
+#else
+  return false;
+#endif
+}
+
 std::vector<uint32_t> PhysicalDevice::matchingFamilyIndices(const QueueTraits& queueTraits)
 {
   std::vector<uint32_t> results;
@@ -21,7 +21,15 @@
 //
 
 #include <pumex/Pipeline.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
 #include <pumex/Descriptor.h>
+#include <pumex/Device.h>
+#include <pumex/PhysicalDevice.h>
 #include <pumex/NodeVisitor.h>
 #include <pumex/RenderPass.h>
 #include <pumex/RenderContext.h>
@@ -50,15 +58,17 @@ void PipelineLayout::validate(const RenderContext& renderContext)
   pddit = perDeviceData.insert( { renderContext.vkDevice, PerDeviceData()}).first;
 
   VkPipelineLayoutCreateInfo pipelineLayoutCI{};
-    pipelineLayoutCI.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCI.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     std::vector<VkDescriptorSetLayout> descriptors;
     for (auto& dsl : descriptorSetLayouts)
     {
       dsl->validate(renderContext);
       descriptors.push_back(dsl->getHandle(renderContext));
     }
-    pipelineLayoutCI.setLayoutCount = descriptors.size();
-    pipelineLayoutCI.pSetLayouts    = descriptors.data();
+    pipelineLayoutCI.setLayoutCount         = descriptors.size();
+    pipelineLayoutCI.pSetLayouts            = descriptors.data();
+    pipelineLayoutCI.pushConstantRangeCount = pushConstantRanges.size();
+    pipelineLayoutCI.pPushConstantRanges    = pushConstantRanges.data();
   VK_CHECK_LOG_THROW(vkCreatePipelineLayout(pddit->first, &pipelineLayoutCI, nullptr, &pddit->second.pipelineLayout), "Cannot create pipeline layout");
 }
 
@@ -71,14 +81,33 @@ VkPipelineLayout PipelineLayout::getHandle(VkDevice device) const
   return pddit->second.pipelineLayout;
 }
 
-PipelineCache::PipelineCache()
+// checks pipeline cache header ( see VkPipelineCacheHeaderVersion in Vulkan specification ) : header length, header version, vendor ID, device ID and pipeline cache UUID
+static bool pipelineCacheHeaderValid(const std::vector<unsigned char>& cacheData, const VkPhysicalDeviceProperties& properties)
+{
+  const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+  if (cacheData.size() < headerSize)
+    return false;
+  uint32_t header[4];
+  std::memcpy(header, cacheData.data(), sizeof(header));
+  return header[0] >= headerSize && header[0] <= cacheData.size() &&
+    header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+    header[2] == properties.vendorID &&
+    header[3] == properties.deviceID &&
+    std::memcmp(cacheData.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+PipelineCache::PipelineCache(const std::string& cfn)
+  : cacheFileName{ cfn }
 {
 }
 
 PipelineCache::~PipelineCache()
 {
   for (auto& pddit : perDeviceData)
+  {
+    saveDeviceData(pddit.first, pddit.second);
     vkDestroyPipelineCache(pddit.first, pddit.second.pipelineCache, nullptr);
+  }
 }
 
 void PipelineCache::validate(const RenderContext& renderContext)
@@ -89,8 +118,35 @@ void PipelineCache::validate(const RenderContext& renderContext)
     return;
   pddit = perDeviceData.insert({ renderContext.vkDevice,PerDeviceData()}).first;
 
+  // cache data is valid only for the same device and driver, so these values are part of a file name
+  std::vector<unsigned char> cacheData;
+  if (!cacheFileName.empty())
+  {
+    auto physicalDevice    = renderContext.device->physical.lock();
+    const auto& properties = physicalDevice->properties;
+    std::ostringstream fileName;
+    fileName << cacheFileName << "_" << std::hex << std::setfill('0') << std::setw(4) << properties.vendorID << "_" << std::setw(4) << properties.deviceID << "_" << std::setw(8) << properties.driverVersion << "_";
+    for (uint32_t i = 0; i < VK_UUID_SIZE; ++i)
+      fileName << std::setw(2) << static_cast<uint32_t>(properties.pipelineCacheUUID[i]);
+    fileName << ".bin";
+    pddit->second.fileName = fileName.str();
+
+    std::ifstream file(pddit->second.fileName.c_str(), std::ios::in | std::ios::binary);
+    if (file)
+    {
+      cacheData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      if (!pipelineCacheHeaderValid(cacheData, properties))
+      {
+        LOG_WARNING << "Pipeline cache file has invalid header and will be ignored : " << pddit->second.fileName << std::endl;
+        cacheData.clear();
+      }
+    }
+  }
+
   VkPipelineCacheCreateInfo pipelineCacheCI{};
-    pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCI.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCI.initialDataSize = cacheData.size();
+    pipelineCacheCI.pInitialData    = cacheData.empty() ? nullptr : cacheData.data();
   VK_CHECK_LOG_THROW(vkCreatePipelineCache(pddit->first, &pipelineCacheCI, nullptr, &pddit->second.pipelineCache), "Cannot create pipeline cache");
 }
 
@@ -103,6 +159,39 @@ VkPipelineCache PipelineCache::getHandle(VkDevice device) const
   return pddit->second.pipelineCache;
 }
 
+void PipelineCache::save() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& pddit : perDeviceData)
+    saveDeviceData(pddit.first, pddit.second);
+}
+
+void PipelineCache::saveDeviceData(VkDevice device, const PerDeviceData& deviceData) const
+{
+  if (deviceData.fileName.empty() || deviceData.pipelineCache == VK_NULL_HANDLE)
+    return;
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device, deviceData.pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    return;
+  std::vector<unsigned char> cacheData(dataSize);
+  if (vkGetPipelineCacheData(device, deviceData.pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+    return;
+  // cache is written to a temporary file first, so that interrupted write does not leave a damaged cache
+  std::string tempFileName = deviceData.fileName + ".tmp";
+  {
+    std::ofstream file(tempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(cacheData.data()), dataSize);
+    if (!file)
+    {
+      LOG_WARNING << "Cannot write pipeline cache file : " << tempFileName << std::endl;
+      return;
+    }
+  }
+  std::remove(deviceData.fileName.c_str());
+  if (std::rename(tempFileName.c_str(), deviceData.fileName.c_str()) != 0)
+    LOG_WARNING << "Cannot write pipeline cache file : " << deviceData.fileName << std::endl;
+}
+
 ShaderModule::ShaderModule(std::shared_ptr<Viewer> viewer, const std::string& f)
 {
   fileName = viewer->getAbsoluteFilePath(f);
@@ -0,0 +1,79 @@
+//
+// Copyright(c) 2017-2018 Paweł Księżopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/PushConstantsNode.h>
+#include <cstring>
+#include <pumex/NodeVisitor.h>
+#include <pumex/Command.h>
+#include <pumex/RenderContext.h>
+#include <pumex/Pipeline.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+PushConstantsNode::PushConstantsNode(VkShaderStageFlags sf, uint32_t o)
+  : stageFlags{ sf }, offset{ o }
+{
+  CHECK_LOG_THROW(offset % 4 != 0, "Push constant offset must be a multiple of 4");
+}
+
+void PushConstantsNode::accept(NodeVisitor& visitor)
+{
+  if (visitor.getMask() && mask)
+  {
+    visitor.push(this);
+    visitor.apply(*this);
+    visitor.pop();
+  }
+}
+
+void PushConstantsNode::validate(const RenderContext& renderContext)
+{
+}
+
+void PushConstantsNode::setData(const void* d, uint32_t size)
+{
+  CHECK_LOG_THROW(size == 0 || size % 4 != 0, "Push constant size must be a nonzero multiple of 4");
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    data.resize(size);
+    std::memcpy(data.data(), d, size);
+  }
+  // push constants are recorded directly into command buffers
+  notifyCommandBuffers();
+  invalidateNodeAndParents();
+}
+
+void PushConstantsNode::cmdPushConstants(const RenderContext& renderContext, CommandBuffer* commandBuffer)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (data.empty() || renderContext.currentPipelineLayout == nullptr)
+    return;
+  // every stage must find a declared range containing [offset, offset + size)
+  uint32_t end = offset + static_cast<uint32_t>(data.size());
+  VkShaderStageFlags coveredStages = 0;
+  for (const auto& range : renderContext.currentPipelineLayout->pushConstantRanges)
+    if (range.offset <= offset && end <= range.offset + range.size)
+      coveredStages |= range.stageFlags;
+  CHECK_LOG_THROW((coveredStages & stageFlags) != stageFlags, "PushConstantsNode::cmdPushConstants() range [" << offset << ", " << end << ") with stage flags " << stageFlags << " is not declared in pipeline layout");
+  commandBuffer->cmdPushConstants(renderContext.currentPipelineLayout, stageFlags, offset, data.size(), data.data());
+}
@@ -27,6 +27,7 @@
 #include <pumex/FrameBuffer.h>
 #include <pumex/RenderPass.h>
 #include <pumex/RenderGraph.h>
+#include <pumex/RenderGraphExecution.h>
 
 using namespace pumex;
 
@@ -56,3 +57,10 @@ void RenderContext::setRenderOperation(RenderOperation* ro)
   else
     currentBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 }
+
+bool RenderContext::isOperationEnabled(const RenderOperation& operation) const
+{
+  if (surface == nullptr || renderGraphExecutable == nullptr)
+    return operation.enabled;
+  return surface->isOperationEnabled(renderGraphExecutable->name, operation.name);
+}
@@ -331,13 +331,13 @@ uint32_t RenderGraph::addResourceTransition(const ResourceTransitionEntry& gen,
   }
 
   if (existingGenTransition == end(transitions))
-    transitions.push_back(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, genOp, genEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
+    addTransition(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, genOp, genEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
   for (const auto& con : cons)
   {
     auto conOp = std::find_if(begin(operations), end(operations), [&con](const RenderOperation& opx) { return opx.name == con.first; });
     auto conEntry = conOp->inputEntries.find(con.second);
 
-    transitions.push_back(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, conOp, conEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
+    addTransition(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, conOp, conEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
   }
   valid = false;
   return objectID;
@@ -437,7 +437,7 @@ uint32_t RenderGraph::addResourceTransition(const std::vector<ResourceTransition
   else
     objectID = (suggestedObjectID != 0) ? suggestedObjectID : generateObjectID();
 
-  transitions.push_back(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, conOp, conEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
+  addTransition(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, conOp, conEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
   for (const auto& gen : gens)
   {
     auto genOp = std::find_if(begin(operations), end(operations), [&gen](const RenderOperation& opx) { return opx.name == gen.first; });
@@ -445,7 +445,7 @@ uint32_t RenderGraph::addResourceTransition(const std::vector<ResourceTransition
 
     auto existingGenTransition = std::find_if(begin(transitions), end(transitions), [genOp, genEntry](const ResourceTransition& rt) { return (rt.operationIter() == genOp && (rt.entry().entryType & opeAllOutputs) && rt.entryIter() == genEntry); });
     if (existingGenTransition == end(transitions))
-      transitions.push_back(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, genOp, genEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
+      addTransition(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, genOp, genEntry, externalMemoryObjectName, VK_IMAGE_LAYOUT_UNDEFINED));
   }
   valid = false;
   return objectID;
@@ -479,7 +479,7 @@ uint32_t RenderGraph::addResourceTransitionInput(const ResourceTransitionEntry&
   else
     objectID     = (suggestedObjectID != 0) ? suggestedObjectID : generateObjectID();
 
-  transitions.push_back(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, op, entry, externalMemoryObjectName, externalLayout));
+  addTransition(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, op, entry, externalMemoryObjectName, externalLayout));
   valid = false;
   return objectID;
 }
@@ -520,7 +520,7 @@ uint32_t RenderGraph::addResourceTransitionOutput(const ResourceTransitionEntry&
     else
       objectID = (suggestedObjectID != 0) ? suggestedObjectID : generateObjectID();
   }
-  transitions.push_back(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, op, entry, externalMemoryObjectName, externalLayout));
+  addTransition(ResourceTransition(generateTransitionEntryID(), transitionID, objectID, op, entry, externalMemoryObjectName, externalLayout));
   valid = false;
   return objectID;
 }
@@ -545,7 +545,8 @@ void RenderGraph::addMissingResourceTransitions()
 //        else
           emptyTransitions.push_back(ResourceTransition(generateTransitionEntryID(), generateTransitionID(), generateObjectID(), opit, opeit, std::string(), VK_IMAGE_LAYOUT_UNDEFINED));
   }
-  std::copy(begin(emptyTransitions), end(emptyTransitions), std::back_inserter(transitions));
+  for (const auto& transition : emptyTransitions)
+    addTransition(transition);
 }
 
 std::vector<std::string> RenderGraph::getRenderOperationNames() const
@@ -583,32 +584,72 @@ std::shared_ptr<Node> RenderGraph::getRenderOperationNode(const std::string& opN
 
 std::vector<std::reference_wrapper<const ResourceTransition>> RenderGraph::getOperationIO(const std::string& opName, OperationEntryTypeFlags entryTypes) const
 {
-  std::vector<std::reference_wrapper<const ResourceTransition>> results;
-  std::copy_if(begin(transitions), end(transitions), std::back_inserter(results),
-    [opName, entryTypes](const ResourceTransition& c)->bool { return c.operationName() == opName && (c.entry().entryType & entryTypes); });
-  return results;
+  auto it = transitionsByOperation.find(opName);
+  if (it == end(transitionsByOperation))
+    return std::vector<std::reference_wrapper<const ResourceTransition>>();
+  return filterTransitions(it->second, entryTypes);
 }
 
 std::vector<std::reference_wrapper<const ResourceTransition>> RenderGraph::getTransitionIO(uint32_t transitionID, OperationEntryTypeFlags entryTypes) const
 {
-  std::vector<std::reference_wrapper<const ResourceTransition>> results;
-  std::copy_if(begin(transitions), end(transitions), std::back_inserter(results),
-    [transitionID, entryTypes](const ResourceTransition& c)->bool { return c.tid() == transitionID && (c.entry().entryType & entryTypes); });
-  return results;
+  auto it = transitionsByTID.find(transitionID);
+  if (it == end(transitionsByTID))
+    return std::vector<std::reference_wrapper<const ResourceTransition>>();
+  return filterTransitions(it->second, entryTypes);
+}
+
+std::shared_ptr<RenderGraph> RenderGraph::createSubgraph(const std::set<std::string>& operationNames) const
+{
+  auto result = std::make_shared<RenderGraph>(name);
+  for (const auto& op : operations)
+    if (operationNames.find(op.name) != end(operationNames))
+      result->operations.push_back(op);
+  for (const auto& transition : transitions)
+  {
+    std::list<RenderOperation>::const_iterator op = std::find_if(begin(result->operations), end(result->operations), [&transition](const RenderOperation& opx) { return opx.name == transition.operationName(); });
+    if (op == end(result->operations))
+      continue;
+    auto entry = ((transition.entry().entryType & opeAllInputs) != 0) ? op->inputEntries.find(transition.entryName()) : op->outputEntries.find(transition.entryName());
+    result->addTransition(ResourceTransition(transition.rteid(), transition.tid(), transition.oid(), op, entry, transition.externalMemoryObjectName(), transition.externalLayout()));
+  }
+  result->nextTransitionEntryID = nextTransitionEntryID;
+  result->nextTransitionID      = nextTransitionID;
+  result->nextObjectID          = nextObjectID;
+  result->valid                 = valid;
+  return result;
 }
 
 std::reference_wrapper<const ResourceTransition> RenderGraph::getTransition(uint32_t rteid) const
 {
-  auto it = std::find_if(begin(transitions), end(transitions), [rteid](const ResourceTransition& c)->bool { return c.rteid() == rteid; });
-  CHECK_LOG_THROW(it == end(transitions), "Canot find transition rteid = " << rteid);
-  return *it;
+  auto it = transitionByRTEID.find(rteid);
+  CHECK_LOG_THROW(it == end(transitionByRTEID), "Canot find transition rteid = " << rteid);
+  return transitions[it->second];
 }
 
 std::vector<std::reference_wrapper<const ResourceTransition>> RenderGraph::getObjectIO(uint32_t objectID, OperationEntryTypeFlags entryTypes) const
+{
+  auto it = transitionsByOID.find(objectID);
+  if (it == end(transitionsByOID))
+    return std::vector<std::reference_wrapper<const ResourceTransition>>();
+  return filterTransitions(it->second, entryTypes);
+}
+
+void RenderGraph::addTransition(const ResourceTransition& transition)
+{
+  std::size_t index = transitions.size();
+  transitions.push_back(transition);
+  transitionsByOperation[transition.operationName()].push_back(index);
+  transitionsByTID[transition.tid()].push_back(index);
+  transitionsByOID[transition.oid()].push_back(index);
+  transitionByRTEID[transition.rteid()] = index;
+}
+
+std::vector<std::reference_wrapper<const ResourceTransition>> RenderGraph::filterTransitions(const std::vector<std::size_t>& indices, OperationEntryTypeFlags entryTypes) const
 {
   std::vector<std::reference_wrapper<const ResourceTransition>> results;
-  std::copy_if(begin(transitions), end(transitions), std::back_inserter(results),
-    [objectID, entryTypes](const ResourceTransition& c)->bool { return c.oid() == objectID && (c.entry().entryType & entryTypes); });
+  for (auto index : indices)
+    if ((transitions[index].entry().entryType & entryTypes) != 0)
+      results.push_back(transitions[index]);
   return results;
 }
 
@@ -721,7 +762,9 @@ RenderOperationSet getAllPreviousOperations(const RenderGraph& renderGraph, cons
     decltype(prevOperations) prevOperations2;
     for (auto operation : prevOperations)
     {
-      results.insert(operation);
+      // operation reachable by many paths is expanded only once
+      if (!results.insert(operation).second)
+        continue;
       auto x = getPreviousOperations(renderGraph, operation.get().name);
       std::copy(begin(x), end(x), std::inserter(prevOperations2, end(prevOperations2)));
     }
@@ -741,7 +784,9 @@ RenderOperationSet getAllNextOperations(const RenderGraph& renderGraph, const st
     decltype(nextOperations) nextOperations2;
     for (auto operation : nextOperations)
     {
-      results.insert(operation);
+      // operation reachable by many paths is expanded only once
+      if (!results.insert(operation).second)
+        continue;
       auto x = getNextOperations(renderGraph, operation.get().name);
       std::copy(begin(x), end(x), std::inserter(nextOperations2, end(nextOperations2)));
     }
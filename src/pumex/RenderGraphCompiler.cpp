@@ -21,15 +21,114 @@
 //
 #include <pumex/RenderGraphCompiler.h>
 #include <numeric>
+#include <limits>
+#include <type_traits>
 #include <pumex/RenderPass.h>
 #include <pumex/FrameBuffer.h>
+#include <pumex/HPClock.h>
 
 using namespace pumex;
 
-std::shared_ptr<RenderGraphExecutable> DefaultRenderGraphCompiler::compile(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits, std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator)
+RenderGraphCostModel::~RenderGraphCostModel()
 {
+}
+
+float RenderGraphCostModel::getOperationCost(const RenderGraph& renderGraph, const RenderOperation& operation) const
+{
+  float measuredTime;
+  if (getMeasuredOperationTime(renderGraph.name, operation.name, measuredTime))
+    return measuredTime;
+  float totalCost = 0.0001f;
+  if (operation.attachmentSize.type == isSurfaceDependent)
+    totalCost += std::max(operation.attachmentSize.size.x, operation.attachmentSize.size.y) * 0.1f;
+  else
+    totalCost += 0.01f;
+  return totalCost;
+}
+
+float RenderGraphCostModel::getTransitionCost(const RenderGraph& renderGraph, uint32_t transitionID) const
+{
+  auto transitions = renderGraph.getTransitionIO(transitionID, opeAllInputsOutputs);
+  float totalCost = 0.0001f;
+  if (transitions.empty())
+    return totalCost;
+  ImageSize     is = transitions[0].get().operation().attachmentSize;
+  OperationType ot = transitions[0].get().operation().operationType;
+  for (auto other : transitions)
+  {
+    float cost = 0.0f;
+    if (other.get().operation().operationType != ot)
+      cost += 0.1f;
+    if (other.get().operation().attachmentSize != is)
+      cost += 0.1f;
+    totalCost = std::max(cost, totalCost);
+  }
+  return totalCost;
+}
+
+void RenderGraphCostModel::reportOperationTime(const std::string& renderGraphName, const std::string& operationName, float milliseconds)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = measuredTimes.find({ renderGraphName, operationName });
+  if (it == end(measuredTimes))
+    measuredTimes.insert({ { renderGraphName, operationName }, milliseconds });
+  else
+    it->second += smoothingFactor * (milliseconds - it->second);
+}
+
+bool RenderGraphCostModel::getMeasuredOperationTime(const std::string& renderGraphName, const std::string& operationName, float& milliseconds) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = measuredTimes.find({ renderGraphName, operationName });
+  if (it == end(measuredTimes))
+    return false;
+  milliseconds = it->second;
+  return true;
+}
+
+void RenderGraphCostModel::clearMeasurements()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  measuredTimes.clear();
+}
+
+DefaultRenderGraphCompiler::DefaultRenderGraphCompiler(RenderPassMergePolicy policy)
+  : renderPassMergePolicy{ policy }
+{
+}
+
+std::shared_ptr<RenderGraphExecutable> DefaultRenderGraphCompiler::compile(const RenderGraph& sourceGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits, std::shared_ptr<DeviceMemoryAllocator> frameBufferAllocator, std::shared_ptr<RenderGraphCostModel> costModel)
+{
+  if (costModel == nullptr)
+    costModel = std::make_shared<RenderGraphCostModel>();
+
+  stageTimes.clear();
+  auto stageStart = HPClock::now();
+  auto endStage = [this, &stageStart](const std::string& stageName)
+  {
+    auto now = HPClock::now();
+    stageTimes.push_back({ stageName, 1000.0 * inSeconds(now - stageStart) });
+    stageStart = now;
+  };
+
+  // remove operations whose results are never used
+  std::shared_ptr<RenderGraph> culledGraph;
+  auto liveOperations = findLiveOperations(sourceGraph);
+  if (liveOperations.size() < sourceGraph.getOperations().size())
+  {
+    LOG_INFO << "Render graph " << sourceGraph.name << " : culled operations : ";
+    for (const auto& op : sourceGraph.getOperations())
+      if (liveOperations.find(op.name) == end(liveOperations))
+        LOG_INFO << op.name << " ";
+    LOG_INFO << std::endl;
+    culledGraph = sourceGraph.createSubgraph(liveOperations);
+  }
+  const RenderGraph& renderGraph = (culledGraph != nullptr) ? *culledGraph : sourceGraph;
+  endStage("findLiveOperations");
+
   // calculate partial ordering
   auto partialOrdering = calculatePartialOrdering(renderGraph);
+  endStage("calculatePartialOrdering");
 
   // build the results storage
   auto executable = std::make_shared<RenderGraphExecutable>();
@@ -39,27 +138,60 @@ std::shared_ptr<RenderGraphExecutable> DefaultRenderGraphCompiler::compile(const
   executable->setExternalMemoryObjects(renderGraph, externalMemoryObjects);
 
   // we are scheduling operations according to queue traits and partial ordering
-  auto operationSchedule = scheduleOperations(renderGraph, partialOrdering, queueTraits);
+  auto operationSchedule = scheduleOperations(renderGraph, partialOrdering, queueTraits, *costModel);
+  endStage("scheduleOperations");
+
+  // find which queues must wait for other queues
+  buildQueueDependencies(renderGraph, operationSchedule, executable);
+  endStage("buildQueueDependencies");
 
   // build render commands and render passes
   buildCommandSequences(renderGraph, operationSchedule, executable);
+  endStage("buildCommandSequences");
   
   // build information about all images and buffers used in a graph, find aliased resources
   buildImageInfo(renderGraph, partialOrdering, executable);
+  endStage("buildImageInfo");
 
   // build image views and buffer views
   buildObjectViewInfo(renderGraph, executable);
+  endStage("buildObjectViewInfo");
 
   // Build framebuffer for each render pass
   // TODO : specification is not clear what compatible render passes are. Neither are debug layers. One day I will decrease the number of frame buffers
   buildFrameBuffersAndRenderPasses(renderGraph, partialOrdering, executable);
+  endStage("buildFrameBuffersAndRenderPasses");
 
   // build pipeline barriers and subpass dependencies and events ( semaphores ?)
   buildPipelineBarriers(renderGraph, executable);
+  endStage("buildPipelineBarriers");
+
+  // operations disabled in render graph start disabled
+  executable->updateOperationsEnabled(renderGraph);
 
   return executable;
 }
 
+std::set<std::string> DefaultRenderGraphCompiler::findLiveOperations(const RenderGraph& renderGraph)
+{
+  // Operation is a sink when it has side effects, writes to swapchain or external memory object, or has no outputs at all.
+  // Operation is alive when it is a sink or some alive operation uses its outputs. Enabled state is not taken into account, so that operations may be enabled without recompilation
+  std::set<std::string> results;
+  for (const auto& op : renderGraph.getOperations())
+  {
+    auto outTransitions = renderGraph.getOperationIO(op.name, opeAllOutputs);
+    bool isSink = op.sideEffects || op.getEntries(opeAllOutputs).empty() ||
+      std::any_of(begin(outTransitions), end(outTransitions), [](const ResourceTransition& tr) { return tr.entryName() == SWAPCHAIN_NAME || tr.entry().resourceDefinition.name == SWAPCHAIN_NAME || !tr.externalMemoryObjectName().empty(); });
+    if (!isSink || results.find(op.name) != end(results))
+      continue;
+    results.insert(op.name);
+    auto previousOperations = getAllPreviousOperations(renderGraph, op.name);
+    for (const auto& prevOp : previousOperations)
+      results.insert(prevOp.get().name);
+  }
+  return results;
+}
+
 std::vector<std::reference_wrapper<const RenderOperation>> DefaultRenderGraphCompiler::calculatePartialOrdering(const RenderGraph& renderGraph)
 {
   std::vector<std::reference_wrapper<const RenderOperation>> partialOrdering;
@@ -102,41 +234,21 @@ std::vector<std::reference_wrapper<const RenderOperation>> DefaultRenderGraphCom
   return partialOrdering;
 }
 
-std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> DefaultRenderGraphCompiler::scheduleOperations(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, const std::vector<QueueTraits>& queueTraits)
+std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> DefaultRenderGraphCompiler::scheduleOperations(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, const std::vector<QueueTraits>& queueTraits, const RenderGraphCostModel& costModel)
 {
-  // calculate transition cost 
+  // calculate transition cost ( paid only when transition crosses queues )
   std::map<uint32_t, float> transitionCost;
   for (const auto& transition : renderGraph.getTransitions())
   {
     if (transitionCost.find(transition.tid()) != end(transitionCost))
       continue;
-    ImageSize     is = transition.operation().attachmentSize;
-    OperationType ot = transition.operation().operationType;
-    float totalCost = 0.0001f;
-    auto others = renderGraph.getTransitionIO(transition.tid(), opeAllInputsOutputs);
-    for (auto other : others)
-    {
-      float cost = 0.0f;
-      if (other.get().operation().operationType != ot)
-        cost += 0.1f;
-      if (other.get().operation().attachmentSize != is)
-        cost += 0.1f;
-      totalCost = std::max(cost, totalCost);
-    }
-    transitionCost.insert( { transition.tid(), totalCost } );
+    transitionCost.insert( { transition.tid(), costModel.getTransitionCost(renderGraph, transition.tid()) } );
   }
 
   // calculate operation cost
   std::map<std::string, float> operationCost;
   for (const auto& op : renderGraph.getOperations())
-  {
-    float totalCost = 0.0001f;
-    if (op.attachmentSize.type == isSurfaceDependent)
-      totalCost += std::max(op.attachmentSize.size.x, op.attachmentSize.size.y) * 0.1f;
-    else
-      totalCost += 0.01f;
-    operationCost.insert( { op.name, totalCost } );
-  }
+    operationCost.insert( { op.name, costModel.getOperationCost(renderGraph, op) } );
 
   // Scheduling algorithm inspired by "Scheduling Algorithms for Allocating Directed Task Graphs for Multiprocessors" by Yu-Kwong Kwok and Ishfaq Ahmad
   // Calculate b-level
@@ -161,6 +273,17 @@ std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> DefaultR
   std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> results(queueTraits.size());
   std::vector<float>              queueEndTime(queueTraits.size(), 0.0f);
   std::map<std::string, float>    operationEndTime;
+  std::map<std::string, uint32_t> operationQueue;
+  // Each queue is submitted as a single command buffer, so queues wait for each other as a whole. queueWaitsFor[q] holds queues that must finish before queue q starts.
+  // Dependencies between queues must not create a cycle
+  std::vector<std::set<uint32_t>> queueWaitsFor(queueTraits.size());
+  std::function<bool(uint32_t, uint32_t)> queueWaitsForQueue = [&queueWaitsFor, &queueWaitsForQueue](uint32_t waitingQueue, uint32_t queue) -> bool
+  {
+    for (auto q : queueWaitsFor[waitingQueue])
+      if (q == queue || queueWaitsForQueue(q, queue))
+        return true;
+    return false;
+  };
 
   std::deque<std::reference_wrapper<const RenderOperation>> readyList;
   auto sortMethodLambda = [&bLevel](const RenderOperation& lhs, const RenderOperation& rhs)->bool { return bLevel[lhs.name] > bLevel[rhs.name]; };
@@ -174,8 +297,7 @@ std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> DefaultR
     auto scheduledOperation = readyList.front();
     readyList.pop_front();
 
-    // find minimum execution time taking into account all previous operations ( previous operations are already scheduled )
-    float minExecTime = 0.0;
+    // collect predecessors ( already scheduled ) with costs of transitions between them and scheduled operation
     std::map<std::string, float> predecessors;
     auto inputTransitions = renderGraph.getOperationIO(scheduledOperation.get().name, opeAllInputs);
     for (auto inputTransition : inputTransitions)
@@ -184,56 +306,65 @@ std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> DefaultR
       auto outputTransitions = renderGraph.getTransitionIO(inputTransition.get().tid(), opeAllOutputs);
       for (auto& outputTransition : outputTransitions)
       {
-        float fullCost = operationEndTime[outputTransition.get().operationName()] + transCost;
-        predecessors.insert({ outputTransition.get().operationName(), fullCost });
-        minExecTime = std::min(minExecTime, fullCost);
+        auto pit = predecessors.insert({ outputTransition.get().operationName(), transCost }).first;
+        pit->second = std::max(pit->second, transCost);
       }
     }
 
-    std::vector<uint32_t> q(queueTraits.size());
-    std::iota(begin(q), end(q), 0);
-    // skip queues that are unable to perform the operation
+    // Pick the queue on which operation starts earliest. Transition cost is paid only when predecessor works on a different queue,
+    // so operations that do not depend on work in progress on graphics queue may be placed on async compute queue and overlap it
     OperationType opType = scheduledOperation.get().operationType;
-    auto it = std::partition(begin(q), end(q), [&queueTraits, opType](uint32_t index) { return (queueTraits[index].mustHave & opType) != 0; });
-    CHECK_LOG_THROW(it == begin(q), "No suitable queue for operation : " << scheduledOperation.get().name << ". Check available queue traits.");
-    // prefer operations where last performed operation is a predecessor to currently scheduled one ( requires less synchronization between different queues )
-    auto it2 = std::partition(begin(q), it, [&results, &predecessors](uint32_t index) {  return (!results[index].empty()) && (predecessors.find(results[index].back().get().name) != end(predecessors)); });
-    uint32_t pickedQueue;
-    float previousEndTime;
-    // if there are queues with predecessors
-    if (it2 != begin(q))
-    {
-      // sort predecessor list - pick the one that finishes last
-      std::sort(begin(q), it2, [&queueEndTime](uint32_t lhs, uint32_t rhs) { return queueEndTime[lhs] > queueEndTime[rhs]; });
-      pickedQueue = q[0];
-      previousEndTime = predecessors.find(results[pickedQueue].back().get().name)->second;
-    }
-    else
+    uint32_t pickedQueue      = std::numeric_limits<uint32_t>::max();
+    float    pickedStartTime  = std::numeric_limits<float>::max();
+    bool     pickedCyclic     = true;
+    bool     pickedSameQueue  = false;
+    for (uint32_t q = 0; q < queueTraits.size(); ++q)
     {
-      // if there are no predecessors - we have 3 distinct types of queues
-      // - idle queues ( no operation is performed atm )   - pick first available
-      // - empty queues ( no operations submitted at all ) - pick first available
-      // - queues with operation ongoing at the moment     - pick the one that finishes first
-      auto it3 = std::partition(begin(q), it, [&queueEndTime, minExecTime](uint32_t index) { return queueEndTime[index] < minExecTime; });
-      if (it3 != begin(q))
+      // skip queues that are unable to perform the operation
+      if ((queueTraits[q].mustHave & opType) == 0)
+        continue;
+      float startTime = queueEndTime[q];
+      bool  cyclic    = false;
+      for (const auto& predecessor : predecessors)
       {
-        std::sort(begin(q), it3); // if there are some idle or empty queues we have to sort it by index ( std::partition may not preserve original order )
-        pickedQueue = q[0];
-        previousEndTime = minExecTime;
+        uint32_t predecessorQueue = operationQueue[predecessor.first];
+        if (predecessorQueue == q)
+          continue;
+        startTime = std::max(startTime, operationEndTime[predecessor.first] + predecessor.second);
+        cyclic    = cyclic || queueWaitsForQueue(predecessorQueue, q);
       }
+      // prefer queues where last performed operation is a predecessor to currently scheduled one ( requires less synchronization between different queues )
+      bool sameQueue = (!results[q].empty()) && (predecessors.find(results[q].back().get().name) != end(predecessors));
+      bool better;
+      if (cyclic != pickedCyclic)
+        better = !cyclic;
+      else if (startTime != pickedStartTime)
+        better = startTime < pickedStartTime;
       else
+        better = sameQueue && !pickedSameQueue;
+      if (better)
       {
-        std::sort(it2, it, [&queueEndTime](uint32_t lhs, uint32_t rhs) { return queueEndTime[lhs] < queueEndTime[rhs]; }); // sort working queues by endTime
-        pickedQueue = q[0];
-        previousEndTime = queueEndTime[q[0]];
+        pickedQueue     = q;
+        pickedStartTime = startTime;
+        pickedCyclic    = cyclic;
+        pickedSameQueue = sameQueue;
       }
     }
+    CHECK_LOG_THROW(pickedQueue == std::numeric_limits<uint32_t>::max(), "No suitable queue for operation : " << scheduledOperation.get().name << ". Check available queue traits.");
+    CHECK_LOG_THROW(pickedCyclic, "Cannot schedule operation : " << scheduledOperation.get().name << " without circular dependency between queues. Check available queue traits.");
+    for (const auto& predecessor : predecessors)
+    {
+      uint32_t predecessorQueue = operationQueue[predecessor.first];
+      if (predecessorQueue != pickedQueue)
+        queueWaitsFor[pickedQueue].insert(predecessorQueue);
+    }
 
     // place operation in results
     results[pickedQueue].push_back(scheduledOperation);
-    float endTime                                   = previousEndTime + operationCost[scheduledOperation.get().name];
+    float endTime                                   = pickedStartTime + operationCost[scheduledOperation.get().name];
     queueEndTime[pickedQueue]                       = endTime;
     operationEndTime[scheduledOperation.get().name] = endTime;
+    operationQueue[scheduledOperation.get().name]   = pickedQueue;
 
     auto nextOperations = getNextOperations(renderGraph, scheduledOperation.get().name);
     for (auto nextOperation : nextOperations)
@@ -251,17 +382,38 @@ std::vector<std::vector<std::reference_wrapper<const RenderOperation>>> DefaultR
     LOG_INFO << "\n";
     LOG_INFO << "Q" << i << " ( +" << queueTraits[i].mustHave << " -" << queueTraits[i].mustNotHave << " p:" << queueTraits[i].priority << "), ";
     for (uint32_t j = 0; j < results[i].size(); ++j)
-      LOG_INFO << results[i][j].get().name << ", ";
+      LOG_INFO << results[i][j].get().name << " [" << operationEndTime[results[i][j].get().name] - operationCost[results[i][j].get().name] << "-" << operationEndTime[results[i][j].get().name] << "], ";
   }
   LOG_INFO << "\n" << std::endl;
   return results;
 }
 
+void DefaultRenderGraphCompiler::buildQueueDependencies(const RenderGraph& renderGraph, const std::vector<std::vector<std::reference_wrapper<const RenderOperation>>>& scheduledOperations, std::shared_ptr<RenderGraphExecutable> executable)
+{
+  std::map<std::string, uint32_t> operationQueue;
+  for (uint32_t i = 0; i < scheduledOperations.size(); ++i)
+    for (const auto& op : scheduledOperations[i])
+      operationQueue[op.get().name] = i;
+
+  executable->queueDependencies.assign(scheduledOperations.size(), std::set<uint32_t>());
+  for (const auto& transition : renderGraph.getTransitions())
+  {
+    if ((transition.entry().entryType & opeAllInputs) == 0)
+      continue;
+    uint32_t consumingQueue = operationQueue[transition.operationName()];
+    for (const auto& generatingTransition : renderGraph.getTransitionIO(transition.tid(), opeAllOutputs))
+    {
+      uint32_t generatingQueue = operationQueue[generatingTransition.get().operationName()];
+      if (generatingQueue != consumingQueue)
+        executable->queueDependencies[consumingQueue].insert(generatingQueue);
+    }
+  }
+}
+
 void DefaultRenderGraphCompiler::buildCommandSequences(const RenderGraph& renderGraph, const std::vector<std::vector<std::reference_wrapper<const RenderOperation>>>& scheduledOperations, std::shared_ptr<RenderGraphExecutable> executable)
 {
   for (const auto& schedule : scheduledOperations)
   {
-    ImageSize                                   lastOperationSize;
     std::shared_ptr<RenderPass>                 lastRenderPass;
     std::vector<std::shared_ptr<RenderCommand>> commands;
     for (const auto& operation : schedule)
@@ -271,7 +423,7 @@ void DefaultRenderGraphCompiler::buildCommandSequences(const RenderGraph& render
       {
       case opGraphics:
       {
-        if (lastOperationSize != operation.get().attachmentSize || lastRenderPass.get() == nullptr)
+        if (lastRenderPass.get() == nullptr || !canMergeWithRenderPass(renderGraph, operation.get(), lastRenderPass))
           lastRenderPass = std::make_shared<RenderPass>();
 
         auto renderSubPass = std::make_shared<RenderSubPass>();
@@ -314,56 +466,169 @@ void DefaultRenderGraphCompiler::buildCommandSequences(const RenderGraph& render
       default:
         break;
       }
-      lastOperationSize = operation.get().attachmentSize;
     }
     executable->commands.push_back(commands);
   }
 }
 
-std::vector<uint32_t> recursiveLongestPath(const std::vector<std::pair<uint32_t, uint32_t>>& resourcePairs, const std::set<uint32_t>& doneVertices = std::set<uint32_t>())
+bool DefaultRenderGraphCompiler::canMergeWithRenderPass(const RenderGraph& renderGraph, const RenderOperation& operation, std::shared_ptr<RenderPass> renderPass)
 {
-  std::set<uint32_t> vertices;
-  if (doneVertices.empty())
+  if (renderPassMergePolicy == rpmNever || renderPass->subPasses.empty())
+    return false;
+  // all subpasses must share the framebuffer and either all of them use multiview or none of them
+  std::set<std::string> passOperations;
+  for (auto sb : renderPass->subPasses)
   {
-    for (auto& rp : resourcePairs)
-      vertices.insert(rp.first);
-    for (auto& rp : resourcePairs)
-      vertices.erase(rp.second);
+    auto subpass = sb.lock();
+    if (subpass->operation.attachmentSize != operation.attachmentSize || (subpass->operation.multiViewMask != 0) != (operation.multiViewMask != 0))
+      return false;
+    passOperations.insert(subpass->operation.name);
   }
-  else
+  if (renderPassMergePolicy == rpmSameAttachmentSize)
+    return true;
+
+  // operation may only read results of the render pass through input attachments. Other reads would require a pipeline barrier in the middle of a render pass.
+  // Merging is also pointless when operation does not read anything from the render pass - there's no store/load round trip to avoid
+  bool attachmentDependency = false;
+  auto inputTransitions = renderGraph.getOperationIO(operation.name, opeAllInputs);
+  for (const auto& inputTransition : inputTransitions)
   {
-    for (auto& rp : resourcePairs)
+    auto generatingTransitions = renderGraph.getTransitionIO(inputTransition.get().tid(), opeAllOutputs);
+    for (const auto& generatingTransition : generatingTransitions)
     {
-      if (doneVertices.find(rp.first) == end(doneVertices))
+      if (passOperations.find(generatingTransition.get().operationName()) == end(passOperations))
         continue;
-      if (doneVertices.find(rp.second) != end(doneVertices))
-        continue;
-      vertices.insert(rp.second);
+      if ((inputTransition.get().entry().entryType & opeAllAttachmentInputs) == 0 || (generatingTransition.get().entry().entryType & opeAllAttachmentOutputs) == 0)
+        return false;
+      attachmentDependency = true;
+    }
+  }
+  return attachmentDependency;
+}
+
+// Lifetime of internal image expressed in final command order of a single queue
+struct TransientImageLifetime
+{
+  int32_t                                                       queueIndex   = -1; // -1 when image is used on more than one queue
+  uint32_t                                                      firstCommand = std::numeric_limits<uint32_t>::max();
+  uint32_t                                                      lastCommand  = 0;
+  uint32_t                                                      firstUse     = std::numeric_limits<uint32_t>::max(); // first command using the image
+  bool                                                          loadsContents = false; // first command reads the image or loads attachment - image keeps contents between frames
+  std::vector<std::reference_wrapper<const ResourceTransition>> transitions;
+};
+
+std::map<uint32_t, TransientImageLifetime> getTransientImageLifetimes(const RenderGraph& renderGraph, const RenderGraphExecutable& executable)
+{
+  std::map<uint32_t, TransientImageLifetime> results;
+  for (uint32_t queueIndex = 0; queueIndex < executable.commands.size(); ++queueIndex)
+  {
+    const auto& commandSequence = executable.commands[queueIndex];
+    auto renderPassOf = [&commandSequence](uint32_t commandIndex) -> RenderPass*
+    {
+      if (commandSequence[commandIndex]->commandType != RenderCommand::ctRenderSubPass)
+        return nullptr;
+      return std::dynamic_pointer_cast<RenderSubPass>(commandSequence[commandIndex])->renderPass.get();
+    };
+    for (uint32_t i = 0; i < commandSequence.size(); ++i)
+    {
+      // all attachments of a render pass are in use during the whole render pass
+      uint32_t first = i, last = i;
+      auto renderPass = renderPassOf(i);
+      if (renderPass != nullptr)
+      {
+        while (first > 0 && renderPassOf(first - 1) == renderPass)
+          first--;
+        while (last + 1 < commandSequence.size() && renderPassOf(last + 1) == renderPass)
+          last++;
+      }
+      auto transitions = renderGraph.getOperationIO(commandSequence[i]->operation.name, opeAllAttachments | opeAllImages);
+      for (const auto& transition : transitions)
+      {
+        auto targetIt = executable.imageInfo.find(executable.memoryObjectAliases.at(transition.get().oid()));
+        if (targetIt == end(executable.imageInfo) || targetIt->second.isSwapchainImage || !targetIt->second.externalMemoryImageName.empty())
+          continue;
+        auto lit = results.find(targetIt->first);
+        if (lit == end(results))
+        {
+          lit = results.insert({ targetIt->first, TransientImageLifetime() }).first;
+          lit->second.queueIndex = static_cast<int32_t>(queueIndex);
+        }
+        else if (lit->second.queueIndex != static_cast<int32_t>(queueIndex))
+          lit->second.queueIndex = -1;
+        lit->second.firstCommand = std::min(lit->second.firstCommand, first);
+        lit->second.lastCommand  = std::max(lit->second.lastCommand, last);
+        if (i < lit->second.firstUse)
+        {
+          lit->second.firstUse      = i;
+          lit->second.loadsContents = false;
+        }
+        if (i == lit->second.firstUse)
+          lit->second.loadsContents = lit->second.loadsContents || (transition.get().entry().entryType & opeAllInputs) != 0 || transition.get().entry().loadOp.loadType == LoadOp::Load;
+        lit->second.transitions.push_back(transition);
+      }
     }
   }
-  if (vertices.empty())
-    return std::vector<uint32_t>();
+  return results;
+}
+
+// Finds the longest path in a directed acyclic graph defined by resource pairs ( second image may reuse memory of the first one ).
+// Relation is transitive, so all images on a path may share the same memory. First vertex of the path is stored as the last element of the result
+std::vector<uint32_t> longestAliasingPath(const std::vector<std::pair<uint32_t, uint32_t>>& resourcePairs)
+{
+  std::map<uint32_t, std::vector<uint32_t>> successors;
+  std::map<uint32_t, uint32_t>              inDegree;
+  for (const auto& rp : resourcePairs)
+  {
+    successors[rp.first].push_back(rp.second);
+    inDegree[rp.first];
+    inDegree[rp.second]++;
+  }
 
-  std::vector<std::vector<uint32_t>> results;
-  for (const auto& x : vertices)
+  // topological sort
+  std::vector<uint32_t> sortedVertices;
+  for (const auto& v : inDegree)
+    if (v.second == 0)
+      sortedVertices.push_back(v.first);
+  for (std::size_t i = 0; i < sortedVertices.size(); ++i)
   {
-    auto a = doneVertices;
-    a.insert(x);
-    auto xx = recursiveLongestPath(resourcePairs, a);
-    xx.push_back(x);
-    results.push_back(xx);
+    for (auto s : successors[sortedVertices[i]])
+      if (--inDegree[s] == 0)
+        sortedVertices.push_back(s);
   }
-  uint32_t maxSize = 0;
-  int maxElt = -1;
-  for (uint32_t i = 0; i<results.size(); ++i)
+
+  // length of the longest path starting at each vertex
+  std::map<uint32_t, uint32_t> pathLength, nextVertex;
+  uint32_t startVertex = 0, maxLength = 0;
+  for (auto it = sortedVertices.rbegin(); it != sortedVertices.rend(); ++it)
   {
-    if (results[i].size() > maxSize)
+    uint32_t length = 1;
+    for (auto s : successors[*it])
     {
-      maxSize = results[i].size();
-      maxElt = i;
+      if (pathLength[s] + 1 > length)
+      {
+        length = pathLength[s] + 1;
+        nextVertex[*it] = s;
+      }
+    }
+    pathLength[*it] = length;
+    if (length >= maxLength)
+    {
+      maxLength   = length;
+      startVertex = *it;
     }
   }
-  return results[maxElt];
+
+  std::vector<uint32_t> results;
+  if (maxLength == 0)
+    return results;
+  for (uint32_t v = startVertex;; v = nextVertex[v])
+  {
+    results.push_back(v);
+    if (nextVertex.find(v) == end(nextVertex))
+      break;
+  }
+  std::reverse(begin(results), end(results));
+  return results;
 }
 
 void DefaultRenderGraphCompiler::buildImageInfo(const RenderGraph& renderGraph, const std::vector<std::reference_wrapper<const RenderOperation>>& partialOrdering, std::shared_ptr<RenderGraphExecutable> executable)
@@ -439,7 +704,7 @@ void DefaultRenderGraphCompiler::buildImageInfo(const RenderGraph& renderGraph,
   std::map<uint32_t, uint32_t> imageAliases;
   while (!potentialAliases.empty())
   {
-    auto longestPath = recursiveLongestPath(potentialAliases);
+    auto longestPath = longestAliasingPath(potentialAliases);
 
     std::vector<std::pair<uint32_t, uint32_t>> rp;
     std::copy_if(begin(potentialAliases), end(potentialAliases), std::back_inserter(rp),
@@ -469,9 +734,12 @@ void DefaultRenderGraphCompiler::buildImageInfo(const RenderGraph& renderGraph,
 
   executable->operationIndices = operationIndices;
   // Attachment will be created only when it aliases itself. Other attachments only alias existing ones
-  std::copy_if(begin(imageInfo), end(imageInfo), std::inserter(executable->imageInfo, end(executable->imageInfo)), [&imageAliases](const std::pair<uint32_t, RenderGraphImageInfo>& p0)
-  { return std::count_if(begin(imageAliases), end(imageAliases), [&p0](const std::pair<uint32_t, uint32_t>& p1)
-  { return p0.first == p1.second && p1.first != p1.second; }) == 0; });
+  std::set<uint32_t> aliasingSources;
+  for (const auto& alias : imageAliases)
+    if (alias.first != alias.second)
+      aliasingSources.insert(alias.first);
+  std::copy_if(begin(imageInfo), end(imageInfo), std::inserter(executable->imageInfo, end(executable->imageInfo)), [&aliasingSources](const std::pair<uint32_t, RenderGraphImageInfo>& p0)
+  { return aliasingSources.find(p0.first) == end(aliasingSources); });
   executable->memoryObjectAliases = imageAliases;
 
   // build memoryImages
@@ -483,7 +751,38 @@ void DefaultRenderGraphCompiler::buildImageInfo(const RenderGraph& renderGraph,
     ImageTraits imageTraits(image.second.attachmentDefinition.format, image.second.attachmentDefinition.attachmentSize, image.second.imageUsage, false, VK_IMAGE_LAYOUT_UNDEFINED, 0, imageType, VK_SHARING_MODE_EXCLUSIVE);
     SwapChainImageBehaviour scib = (image.second.isSwapchainImage) ? swForEachImage : swOnce;
     VkImageAspectFlags aspectMask = getAspectMask(image.second.attachmentDefinition.attachmentType);
-    executable->memoryImages.insert({ image.first, std::make_shared<MemoryImage>(imageTraits, executable->frameBufferAllocator, aspectMask, pbPerSurface, scib, false, false) });
+    auto memoryImage = std::make_shared<MemoryImage>(imageTraits, executable->frameBufferAllocator, aspectMask, pbPerSurface, scib, false, false);
+    // internal attachments may be reused by other render graphs and after recompilation
+    memoryImage->setTransientResourcePooling(!image.second.isSwapchainImage);
+    executable->memoryImages.insert({ image.first, memoryImage });
+  }
+
+  // Internal images with different attachment definitions cannot reuse the same MemoryImage, but they still may share device memory
+  // when their lifetimes do not overlap. Lifetimes come from final command order, because it is the order in which GPU executes the work.
+  // Images used on different queues are always in conflict - there is no way to order them without semaphores.
+  // Images that are read or loaded by their first command keep contents between frames, so they conflict with all other images.
+  // Aliasing barriers created in buildPipelineBarriers() make the next image wait for the previous one
+  auto lifetimes = getTransientImageLifetimes(renderGraph, *executable);
+  for (const auto& lifetime : lifetimes)
+  {
+    auto& conflicts = executable->transientConflicts[lifetime.first];
+    for (const auto& otherLifetime : lifetimes)
+    {
+      if (lifetime.first == otherLifetime.first)
+        continue;
+      bool sameQueue = lifetime.second.queueIndex >= 0 && lifetime.second.queueIndex == otherLifetime.second.queueIndex;
+      if (!sameQueue || lifetime.second.loadsContents || otherLifetime.second.loadsContents || (lifetime.second.lastCommand >= otherLifetime.second.firstCommand && otherLifetime.second.lastCommand >= lifetime.second.firstCommand))
+        conflicts.insert(otherLifetime.first);
+    }
+  }
+
+  LOG_INFO << "Transient images ( objectID : objects used at the same time ):\n";
+  for (const auto& conflicts : executable->transientConflicts)
+  {
+    LOG_INFO << conflicts.first << " :";
+    for (auto objectID : conflicts.second)
+      LOG_INFO << " " << objectID;
+    LOG_INFO << "\n";
   }
 
   LOG_INFO << "ImageInfo:\n";
@@ -919,7 +1218,14 @@ void DefaultRenderGraphCompiler::buildPipelineBarriers(const RenderGraph& render
             continue;
         }
 
-        if (((generatingTransition.get().entry().entryType & opeAllAttachmentOutputs) != 0) && ((consumingTransition.get().entry().entryType & opeAllAttachmentInputs) != 0))
+        auto generatingCommand = commandMap[generatingTransition.get().operationName()];
+        auto consumingCommand  = commandMap[consumingTransition.get().operationName()];
+        // pipeline barriers cannot be recorded between subpasses of the same render pass - such dependencies must become subpass dependencies
+        bool sameRenderPass = false;
+        if (generatingCommand->commandType == RenderCommand::ctRenderSubPass && consumingCommand->commandType == RenderCommand::ctRenderSubPass)
+          sameRenderPass = std::dynamic_pointer_cast<RenderSubPass>(generatingCommand)->renderPass.get() == std::dynamic_pointer_cast<RenderSubPass>(consumingCommand)->renderPass.get();
+
+        if (sameRenderPass || (((generatingTransition.get().entry().entryType & opeAllAttachmentOutputs) != 0) && ((consumingTransition.get().entry().entryType & opeAllAttachmentInputs) != 0)))
           createSubpassDependency(renderGraph, generatingTransition.get(), commandMap[generatingTransition.get().operationName()], consumingTransition, commandMap[consumingTransition.get().operationName()], queueNumber[generatingTransition.get().operationName()], queueNumber[consumingTransition.get().operationName()], executable);
         else
           createPipelineBarrier(renderGraph, generatingTransition.get(), commandMap[generatingTransition.get().operationName()], consumingTransition, commandMap[consumingTransition.get().operationName()], queueNumber[generatingTransition.get().operationName()], queueNumber[consumingTransition.get().operationName()], executable);
@@ -927,6 +1233,17 @@ void DefaultRenderGraphCompiler::buildPipelineBarriers(const RenderGraph& render
     }
   }
 
+  // transient images sharing device memory must wait until previous images stop using that memory
+  if (executable->aliasTransientMemory)
+    createAliasingBarriers(renderGraph, executable);
+
+  // merge, narrow and remove redundant barriers
+  uint32_t callsBefore = 0, barriersBefore = 0, callsAfter = 0, barriersAfter = 0;
+  countPipelineBarriers(executable, callsBefore, barriersBefore);
+  optimizePipelineBarriers(renderGraph, executable);
+  countPipelineBarriers(executable, callsAfter, barriersAfter);
+  LOG_INFO << "Render graph " << renderGraph.name << " : pipeline barrier calls " << callsBefore << " -> " << callsAfter << ", memory barriers " << barriersBefore << " -> " << barriersAfter << "\n";
+
   LOG_INFO << "Pipeline barriers :\n";
   for( auto& comSeq : executable->commands )
   { 
@@ -990,6 +1307,9 @@ void DefaultRenderGraphCompiler::createSubpassDependency(const RenderGraph& rend
   getPipelineStageMasks(generatingTransition, consumingTransition, srcStageMask, dstStageMask);
   getAccessMasks(generatingTransition, consumingTransition, srcAccessMask, dstAccessMask);
 
+  // framebuffer-local dependency is only possible when attachment is read as an attachment
+  bool                 framebufferLocal = ((generatingTransition.entry().entryType & opeAllAttachmentOutputs) != 0) && ((consumingTransition.entry().entryType & opeAllAttachmentInputs) != 0);
+
   uint32_t             srcSubpassIndex = VK_SUBPASS_EXTERNAL, dstSubpassIndex = VK_SUBPASS_EXTERNAL;
   // try to add subpass dependency to latter command
   if (consumingCommand->commandType == RenderCommand::ctRenderSubPass)
@@ -1008,12 +1328,14 @@ void DefaultRenderGraphCompiler::createSubpassDependency(const RenderGraph& rend
     auto dep = std::find_if(begin(consumingSubpass->renderPass->dependencies), end(consumingSubpass->renderPass->dependencies),
       [srcSubpassIndex, dstSubpassIndex](const SubpassDependencyDescription& sd) -> bool { return sd.srcSubpass == srcSubpassIndex && sd.dstSubpass == dstSubpassIndex; });
     if (dep == end(consumingSubpass->renderPass->dependencies))
-      dep = consumingSubpass->renderPass->dependencies.insert(end(consumingSubpass->renderPass->dependencies), SubpassDependencyDescription(srcSubpassIndex, dstSubpassIndex, 0, 0, 0, 0, 0));
+      dep = consumingSubpass->renderPass->dependencies.insert(end(consumingSubpass->renderPass->dependencies), SubpassDependencyDescription(srcSubpassIndex, dstSubpassIndex, 0, 0, 0, 0, VK_DEPENDENCY_BY_REGION_BIT));
     dep->srcStageMask    |= srcStageMask;
     dep->dstStageMask    |= dstStageMask;
     dep->srcAccessMask   |= srcAccessMask;
     dep->dstAccessMask   |= dstAccessMask;
-    dep->dependencyFlags |= VK_DEPENDENCY_BY_REGION_BIT;
+    // dependency stays framebuffer-local only when all transitions merged into it are framebuffer-local
+    if (!framebufferLocal || srcSubpassIndex == VK_SUBPASS_EXTERNAL || dstSubpassIndex == VK_SUBPASS_EXTERNAL)
+      dep->dependencyFlags &= ~VK_DEPENDENCY_BY_REGION_BIT;
   }
   else if (generatingCommand->commandType == RenderCommand::ctRenderSubPass) // consumingCommand is not a subpass - let's add it to generating command
   {
@@ -1023,12 +1345,14 @@ void DefaultRenderGraphCompiler::createSubpassDependency(const RenderGraph& rend
     auto dep = std::find_if(begin(generatingSubpass->renderPass->dependencies), end(generatingSubpass->renderPass->dependencies),
       [srcSubpassIndex, dstSubpassIndex](const SubpassDependencyDescription& sd) -> bool { return sd.srcSubpass == srcSubpassIndex && sd.dstSubpass == dstSubpassIndex; });
     if (dep == end(generatingSubpass->renderPass->dependencies))
-      dep = generatingSubpass->renderPass->dependencies.insert(end(generatingSubpass->renderPass->dependencies), SubpassDependencyDescription(srcSubpassIndex, dstSubpassIndex, 0, 0, 0, 0, 0));
+      dep = generatingSubpass->renderPass->dependencies.insert(end(generatingSubpass->renderPass->dependencies), SubpassDependencyDescription(srcSubpassIndex, dstSubpassIndex, 0, 0, 0, 0, VK_DEPENDENCY_BY_REGION_BIT));
     dep->srcStageMask    |= srcStageMask;
     dep->dstStageMask    |= dstStageMask;
     dep->srcAccessMask   |= srcAccessMask;
     dep->dstAccessMask   |= dstAccessMask;
-    dep->dependencyFlags |= VK_DEPENDENCY_BY_REGION_BIT;
+    // dependency stays framebuffer-local only when all transitions merged into it are framebuffer-local
+    if (!framebufferLocal || srcSubpassIndex == VK_SUBPASS_EXTERNAL || dstSubpassIndex == VK_SUBPASS_EXTERNAL)
+      dep->dependencyFlags &= ~VK_DEPENDENCY_BY_REGION_BIT;
   }
   else // none of the commands are subpasses - add pipeline barrier instead
     createPipelineBarrier(renderGraph, generatingTransition, generatingCommand, consumingTransition, consumingCommand, generatingQueueIndex, consumingQueueIndex, executable);
@@ -1036,7 +1360,7 @@ void DefaultRenderGraphCompiler::createSubpassDependency(const RenderGraph& rend
 
 void DefaultRenderGraphCompiler::createPipelineBarrier(const RenderGraph& renderGraph, const ResourceTransition& generatingTransition, std::shared_ptr<RenderCommand> generatingCommand, const ResourceTransition& consumingTransition, std::shared_ptr<RenderCommand> consumingCommand, uint32_t generatingQueueIndex, uint32_t consumingQueueIndex, std::shared_ptr<RenderGraphExecutable> executable)
 {
-  auto memoryObject = executable->getMemoryObject(generatingTransition.tid());
+  auto memoryObject = executable->getMemoryObject(generatingTransition.oid());
   if (memoryObject.get() == nullptr)
     return;
 
@@ -1072,6 +1396,215 @@ void DefaultRenderGraphCompiler::createPipelineBarrier(const RenderGraph& render
   }
 }
 
+const VkAccessFlags writeAccessFlags = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+// pipeline stages and accesses of a single transition
+void getTransitionMasks(const ResourceTransition& transition, VkPipelineStageFlags& stageMask, VkAccessFlags& accessMask)
+{
+  VkPipelineStageFlags unusedStageMask;
+  VkAccessFlags        unusedAccessMask;
+  if ((transition.entry().entryType & opeAllOutputs) != 0)
+  {
+    getPipelineStageMasks(transition, transition, stageMask, unusedStageMask);
+    getAccessMasks(transition, transition, accessMask, unusedAccessMask);
+  }
+  else
+  {
+    getPipelineStageMasks(transition, transition, unusedStageMask, stageMask);
+    getAccessMasks(transition, transition, unusedAccessMask, accessMask);
+  }
+}
+
+void DefaultRenderGraphCompiler::createAliasingBarriers(const RenderGraph& renderGraph, std::shared_ptr<RenderGraphExecutable> executable)
+{
+  // Memory offsets of transient images are known only after images are resized for a surface, so each transient image waits for all images
+  // that may share memory with it. Barrier is recorded before the first command using the image ( before its render pass ) and discards image contents.
+  // Pipeline barrier waits for all earlier commands in a queue, so images used at the end of previous frame are covered as well
+  auto lifetimes = getTransientImageLifetimes(renderGraph, *executable);
+  for (const auto& lifetime : lifetimes)
+  {
+    if (lifetime.second.queueIndex < 0)
+      continue;
+    const auto& conflicts = executable->transientConflicts.at(lifetime.first);
+    VkPipelineStageFlags srcStageMask  = 0;
+    VkAccessFlags        srcAccessMask = 0;
+    bool                 mayAlias      = false;
+    for (const auto& otherLifetime : lifetimes)
+    {
+      if (otherLifetime.first == lifetime.first || conflicts.find(otherLifetime.first) != end(conflicts))
+        continue;
+      mayAlias = true;
+      for (const auto& transition : otherLifetime.second.transitions)
+      {
+        VkPipelineStageFlags stageMask;
+        VkAccessFlags        accessMask;
+        getTransitionMasks(transition.get(), stageMask, accessMask);
+        srcStageMask  |= stageMask;
+        srcAccessMask |= accessMask & writeAccessFlags;
+      }
+    }
+    if (!mayAlias)
+      continue;
+
+    uint32_t queueIndex      = static_cast<uint32_t>(lifetime.second.queueIndex);
+    const auto& firstCommand = executable->commands[queueIndex][lifetime.second.firstUse];
+    VkPipelineStageFlags dstStageMask  = 0;
+    VkAccessFlags        dstAccessMask = 0;
+    VkImageLayout        newLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    for (const auto& transition : lifetime.second.transitions)
+    {
+      if (transition.get().operationName() != firstCommand->operation.name)
+        continue;
+      VkPipelineStageFlags stageMask;
+      VkAccessFlags        accessMask;
+      getTransitionMasks(transition.get(), stageMask, accessMask);
+      dstStageMask  |= stageMask;
+      dstAccessMask |= accessMask;
+      if (newLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+        newLayout = transition.get().entry().layout;
+    }
+    if (newLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+      continue;
+    if (srcStageMask == 0)
+      srcStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    if (dstStageMask == 0)
+      dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    const auto& attachmentDefinition = executable->imageInfo.at(lifetime.first).attachmentDefinition;
+    ImageSubresourceRange imageRange(getAspectMask(attachmentDefinition.attachmentType), 0, attachmentDefinition.attachmentSize.mipLevels, 0, attachmentDefinition.attachmentSize.arrayLayers);
+    MemoryObjectBarrierGroup rbg(srcStageMask, dstStageMask, 0);
+    auto& barriers = executable->commands[queueIndex][lifetime.second.firstCommand]->barriersBeforeOp[rbg];
+    barriers.push_back(MemoryObjectBarrier(srcAccessMask, dstAccessMask, queueIndex, queueIndex, executable->getMemoryObject(lifetime.first), VK_IMAGE_LAYOUT_UNDEFINED, newLayout, imageRange));
+  }
+}
+
+// barrier flattened from MemoryObjectBarrierGroup, so that each barrier may have its own stage masks during optimization
+struct FlatPipelineBarrier
+{
+  VkPipelineStageFlags srcStageMask;
+  VkPipelineStageFlags dstStageMask;
+  VkDependencyFlags    dependencyFlags;
+  MemoryObjectBarrier  barrier;
+};
+
+// true when both barriers touch the same memory in the same way ( second barrier may cover smaller range )
+bool barrierCovers(const MemoryObjectBarrier& first, const MemoryObjectBarrier& second)
+{
+  if (first.memoryObject != second.memoryObject || first.objectType != second.objectType || first.srcQueueIndex != second.srcQueueIndex || first.dstQueueIndex != second.dstQueueIndex)
+    return false;
+  if ((first.srcAccessMask & second.srcAccessMask) != second.srcAccessMask)
+    return false;
+  switch (first.objectType)
+  {
+  case MemoryObject::moBuffer:
+    return first.bufferRange.contains(second.bufferRange);
+  case MemoryObject::moImage:
+    return first.oldLayout == second.oldLayout && first.newLayout == second.newLayout && first.imageRange.aspectMask == second.imageRange.aspectMask && first.imageRange.contains(second.imageRange);
+  default:
+    return false;
+  }
+}
+
+void DefaultRenderGraphCompiler::countPipelineBarriers(std::shared_ptr<RenderGraphExecutable> executable, uint32_t& callCount, uint32_t& barrierCount)
+{
+  callCount    = 0;
+  barrierCount = 0;
+  for (auto& commandSequence : executable->commands)
+  {
+    for (auto& command : commandSequence)
+    {
+      for (auto barriers : { &command->barriersBeforeOp, &command->barriersAfterOp })
+      {
+        callCount += barriers->size();
+        for (auto& barrierGroup : *barriers)
+          barrierCount += barrierGroup.second.size();
+      }
+    }
+  }
+}
+
+void DefaultRenderGraphCompiler::optimizePipelineBarriers(const RenderGraph& renderGraph, std::shared_ptr<RenderGraphExecutable> executable)
+{
+  for (auto& commandSequence : executable->commands)
+  {
+    // flatten barriers of each command. Source access masks are narrowed to write accesses - only writes must be made available
+    std::vector<std::vector<FlatPipelineBarrier>> flatBarriers(commandSequence.size());
+    for (uint32_t i = 0; i < commandSequence.size(); ++i)
+    {
+      for (auto& barrierGroup : commandSequence[i]->barriersBeforeOp)
+      {
+        for (auto& barrier : barrierGroup.second)
+        {
+          FlatPipelineBarrier flatBarrier{ barrierGroup.first.srcStageMask, barrierGroup.first.dstStageMask, barrierGroup.first.dependencyFlags, barrier };
+          flatBarrier.barrier.srcAccessMask &= writeAccessFlags;
+          flatBarriers[i].push_back(flatBarrier);
+        }
+      }
+    }
+
+    // Barrier is redundant when an earlier barrier in the same queue made the same memory visible and the memory was not touched in between.
+    // Earlier barrier takes over destination masks of the redundant one
+    std::vector<std::pair<uint32_t, std::size_t>> activeBarriers;
+    for (uint32_t i = 0; i < commandSequence.size(); ++i)
+    {
+      std::vector<FlatPipelineBarrier> keptBarriers;
+      for (auto& flatBarrier : flatBarriers[i])
+      {
+        bool redundant = false;
+        if (flatBarrier.barrier.srcQueueIndex == flatBarrier.barrier.dstQueueIndex)
+        {
+          for (auto& active : activeBarriers)
+          {
+            auto& earlierBarrier = flatBarriers[active.first][active.second];
+            if (earlierBarrier.dependencyFlags != flatBarrier.dependencyFlags || (earlierBarrier.srcStageMask & flatBarrier.srcStageMask) != flatBarrier.srcStageMask || !barrierCovers(earlierBarrier.barrier, flatBarrier.barrier))
+              continue;
+            earlierBarrier.dstStageMask          |= flatBarrier.dstStageMask;
+            earlierBarrier.barrier.dstAccessMask |= flatBarrier.barrier.dstAccessMask;
+            redundant = true;
+            break;
+          }
+        }
+        if (!redundant)
+          keptBarriers.push_back(flatBarrier);
+      }
+      flatBarriers[i] = keptBarriers;
+
+      // memory objects used by this command as attachments or outputs invalidate earlier barriers, as do barriers that were kept at this point
+      std::set<MemoryObject*> touchedObjects;
+      for (auto& flatBarrier : flatBarriers[i])
+        touchedObjects.insert(flatBarrier.barrier.memoryObject.get());
+      for (const auto& entry : commandSequence[i]->entries)
+      {
+        const auto& transition = renderGraph.getTransition(entry.second).get();
+        if ((transition.entry().entryType & (opeAllAttachments | opeAllOutputs)) != 0)
+          touchedObjects.insert(executable->getMemoryObject(transition.oid()).get());
+      }
+      activeBarriers.erase(std::remove_if(begin(activeBarriers), end(activeBarriers), [&flatBarriers, &touchedObjects](const std::pair<uint32_t, std::size_t>& active)
+        { return touchedObjects.find(flatBarriers[active.first][active.second].barrier.memoryObject.get()) != end(touchedObjects); }), end(activeBarriers));
+      for (std::size_t j = 0; j < flatBarriers[i].size(); ++j)
+        if (flatBarriers[i][j].barrier.srcQueueIndex == flatBarriers[i][j].barrier.dstQueueIndex)
+          activeBarriers.push_back({ i, j });
+    }
+
+    // barriers are grouped again by stage masks and dependency flags, so that no barrier waits for stages it does not depend on. Identical barriers in a group are merged into one.
+    // barriersAfterOp is not optimized - compiler places all barriers before consuming commands and never fills it
+    for (uint32_t i = 0; i < commandSequence.size(); ++i)
+    {
+      commandSequence[i]->barriersBeforeOp.clear();
+      for (auto& flatBarrier : flatBarriers[i])
+      {
+        auto& barriers = commandSequence[i]->barriersBeforeOp[MemoryObjectBarrierGroup(flatBarrier.srcStageMask, flatBarrier.dstStageMask, flatBarrier.dependencyFlags)];
+        auto bit = std::find_if(begin(barriers), end(barriers), [&flatBarrier](const MemoryObjectBarrier& b)
+          { return barrierCovers(b, flatBarrier.barrier) && barrierCovers(flatBarrier.barrier, b); });
+        if (bit != end(barriers))
+          bit->dstAccessMask |= flatBarrier.barrier.dstAccessMask;
+        else
+          barriers.push_back(flatBarrier.barrier);
+      }
+    }
+  }
+}
+
 namespace pumex
 {
 
@@ -1264,4 +1797,92 @@ void getAccessMasks(const ResourceTransition& generatingTransition, const Resour
   }
 }
 
+// Structural key is built from plain values : numbers, enums, pointers and strings. Strings are prefixed with their length, so that two different graphs never produce the same key
+class StructuralKeyWriter
+{
+public:
+  template<typename T>
+  void write(const T& value)
+  {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, "StructuralKeyWriter accepts only plain values");
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void write(const std::string& value)
+  {
+    write(value.size());
+    key.append(value);
+  }
+  template<typename T>
+  void write(const std::shared_ptr<T>& value)
+  {
+    write(value.get());
+  }
+  template<typename Head, typename... Tail>
+  void write(const Head& value, const Tail&... tail)
+  {
+    write(value);
+    write(tail...);
+  }
+
+  std::string key;
+};
+
+std::string renderGraphStructuralKey(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits)
+{
+  StructuralKeyWriter writer;
+  auto writeImageSize = [&writer](const ImageSize& is)
+  {
+    writer.write(is.type, is.size.x, is.size.y, is.size.z, is.arrayLayers, is.mipLevels, is.samples);
+  };
+  auto writeResourceDefinition = [&writer, &writeImageSize](const ResourceDefinition& rd)
+  {
+    writer.write(rd.metaType, rd.name, rd.attachment.format, rd.attachment.attachmentType);
+    writer.write(static_cast<int>(rd.attachment.swizzles.r), static_cast<int>(rd.attachment.swizzles.g), static_cast<int>(rd.attachment.swizzles.b), static_cast<int>(rd.attachment.swizzles.a));
+    writeImageSize(rd.attachment.attachmentSize);
+  };
+
+  writer.write(renderGraph.name);
+  writer.write(renderGraph.getOperations().size());
+  for (const auto& op : renderGraph.getOperations())
+  {
+    // node is a part of the key, because render commands hold the node of the operation. Enabled state is not a part of the key - it may be changed without recompilation
+    writer.write(op.name, op.operationType, op.multiViewMask, op.sideEffects, op.node);
+    writeImageSize(op.attachmentSize);
+    for (const auto& entries : { std::cref(op.inputEntries), std::cref(op.outputEntries) })
+    {
+      writer.write(entries.get().size());
+      for (const auto& entry : entries.get())
+      {
+        const auto& e = entry.second;
+        writer.write(entry.first, e.entryType, e.loadOp.loadType, e.loadOp.clearColor.r, e.loadOp.clearColor.g, e.loadOp.clearColor.b, e.loadOp.clearColor.a, e.resolveSourceEntryName);
+        writer.write(e.imageRange.aspectMask, e.imageRange.baseMipLevel, e.imageRange.levelCount, e.imageRange.baseArrayLayer, e.imageRange.layerCount);
+        writer.write(e.layout, e.imageUsage, e.imageCreate, e.imageViewType);
+        writer.write(e.bufferRange.offset, e.bufferRange.range, e.pipelineStage, e.accessFlags, e.bufferFormat);
+        writeResourceDefinition(e.resourceDefinition);
+      }
+    }
+  }
+  writer.write(renderGraph.getTransitions().size());
+  for (const auto& transition : renderGraph.getTransitions())
+    writer.write(transition.rteid(), transition.tid(), transition.oid(), transition.operationName(), transition.entryName(), transition.externalMemoryObjectName(), transition.externalLayout());
+  writer.write(externalMemoryObjects.memoryObjects.size());
+  for (const auto& mo : externalMemoryObjects.memoryObjects)
+    writer.write(mo.first, mo.second);
+  writer.write(externalMemoryObjects.resourceDefinitions.size());
+  for (const auto& rd : externalMemoryObjects.resourceDefinitions)
+  {
+    writer.write(rd.first);
+    writeResourceDefinition(rd.second);
+  }
+  writer.write(queueTraits.size());
+  for (const auto& qt : queueTraits)
+    writer.write(qt.mustHave, qt.mustNotHave, qt.priority, qt.assignment);
+  return writer.key;
+}
+
+std::size_t renderGraphStructuralHash(const RenderGraph& renderGraph, const ExternalMemoryObjects& externalMemoryObjects, const std::vector<QueueTraits>& queueTraits)
+{
+  return std::hash<std::string>()(renderGraphStructuralKey(renderGraph, externalMemoryObjects, queueTraits));
+}
+
 }
@@ -20,7 +20,13 @@
 // SOFTWARE.
 //
 #include <pumex/RenderGraphExecution.h>
+#include <algorithm>
+#include <ostream>
+#include <sstream>
 #include <pumex/RenderPass.h>
+#include <pumex/Surface.h>
+#include <pumex/Device.h>
+#include <pumex/TransientResourcePool.h>
 #include <pumex/utils/Log.h>
 
 using namespace pumex;
@@ -54,6 +60,8 @@ RenderGraphExecutable::RenderGraphExecutable()
 
 void RenderGraphExecutable::resizeImages(const RenderContext& renderContext, std::vector<std::shared_ptr<Image>>& swapChainImages)
 {
+  std::vector<uint32_t>    transientIDs;
+  std::vector<ImageTraits> transientTraits;
   for (auto& memImage : memoryImages)
   {
     auto iiit = imageInfo.find(memImage.first);
@@ -74,11 +82,78 @@ void RenderGraphExecutable::resizeImages(const RenderContext& renderContext, std
         imageSize.size *= glm::vec3(renderContext.surface->swapChainSize.width, renderContext.surface->swapChainSize.height, 1);
       }
       ImageTraits imageTraits(info.attachmentDefinition.format, imageSize, info.imageUsage, false, info.initialLayout, info.imageCreate, imageType, VK_SHARING_MODE_EXCLUSIVE);
-      memImage.second->setImageTraits(renderContext.surface, imageTraits);
+      // transient images are created later, when memory offsets for all of them are known
+      if (aliasTransientMemory && transientConflicts.find(memImage.first) != end(transientConflicts))
+      {
+        transientIDs.push_back(memImage.first);
+        transientTraits.push_back(imageTraits);
+      }
+      else
+        memImage.second->setImageTraits(renderContext.surface, imageTraits);
     }
     else
       memImage.second->setImages(renderContext.surface, swapChainImages);
   }
+  if (!transientIDs.empty())
+    resizeTransientImages(renderContext, transientIDs, transientTraits);
+}
+
+void RenderGraphExecutable::resizeTransientImages(const RenderContext& renderContext, const std::vector<uint32_t>& objectIDs, const std::vector<ImageTraits>& imageTraits)
+{
+  TransientMemoryStatistics         statistics;
+  std::vector<VkMemoryRequirements> requirements;
+  std::vector<std::set<uint32_t>>   conflicts(objectIDs.size());
+  VkMemoryRequirements              sharedRequirements{ 0, 1, ~0u };
+  for (uint32_t i = 0; i < objectIDs.size(); ++i)
+  {
+    requirements.push_back(getImageMemoryRequirements(renderContext.device, imageTraits[i]));
+    sharedRequirements.alignment      = std::max(sharedRequirements.alignment, requirements.back().alignment);
+    sharedRequirements.memoryTypeBits &= requirements.back().memoryTypeBits;
+    statistics.separateSize           += requirements.back().size;
+    statistics.imageSizes[objectIDs[i]] = requirements.back().size;
+
+    const auto& objectConflicts = transientConflicts.at(objectIDs[i]);
+    for (uint32_t j = 0; j < objectIDs.size(); ++j)
+      if (objectConflicts.find(objectIDs[j]) != end(objectConflicts))
+        conflicts[i].insert(j);
+  }
+  // images cannot share memory when there's no common memory type for them
+  if (sharedRequirements.memoryTypeBits == 0)
+  {
+    LOG_WARNING << "Render graph " << name << " : transient images have no common memory type and will not share memory" << std::endl;
+    for (uint32_t i = 0; i < objectIDs.size(); ++i)
+      memoryImages.at(objectIDs[i])->setImageTraits(renderContext.surface, imageTraits[i]);
+    statistics.aliasedSize = statistics.separateSize;
+    statistics.imageCount  = objectIDs.size();
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    transientMemoryStatistics[renderContext.surface->getID()] = statistics;
+    return;
+  }
+
+  std::vector<VkDeviceSize> offsets;
+  sharedRequirements.size = placeAliasedObjects(requirements, conflicts, offsets);
+  statistics.aliasedSize  = sharedRequirements.size;
+  statistics.imageCount   = objectIDs.size();
+
+  auto sharedMemory = renderContext.device->getTransientResourcePool()->acquireMemoryBlock(frameBufferAllocator, sharedRequirements);
+  for (uint32_t i = 0; i < objectIDs.size(); ++i)
+  {
+    memoryImages.at(objectIDs[i])->setImageTraits(renderContext.surface, imageTraits[i], sharedMemory, offsets[i]);
+    statistics.imageOffsets[objectIDs[i]] = offsets[i];
+  }
+
+  LOG_INFO << "Render graph " << name << " : " << statistics.imageCount << " transient images use " << statistics.aliasedSize << " bytes of memory ( " << statistics.separateSize << " bytes without aliasing )" << std::endl;
+  std::lock_guard<std::mutex> lock(statisticsMutex);
+  transientMemoryStatistics[renderContext.surface->getID()] = statistics;
+}
+
+TransientMemoryStatistics RenderGraphExecutable::getTransientMemoryStatistics(uint32_t surfaceID) const
+{
+  std::lock_guard<std::mutex> lock(statisticsMutex);
+  auto it = transientMemoryStatistics.find(surfaceID);
+  if (it == end(transientMemoryStatistics))
+    return TransientMemoryStatistics();
+  return it->second;
 }
 
 void RenderGraphExecutable::setExternalMemoryObjects(const RenderGraph& renderGraph, const ExternalMemoryObjects& memoryObjects)
@@ -259,3 +334,454 @@ std::vector<uint32_t> RenderGraphExecutable::getOperationParticipants(uint32_t o
   }
   return results;
 }
+
+bool RenderGraphExecutable::setOperationEnabled(const std::string& operationName, bool enabled)
+{
+  CHECK_LOG_THROW(operationIndices.find(operationName) == end(operationIndices), "RenderGraphExecutable::setOperationEnabled() : render graph " << name << " does not have operation " << operationName);
+  std::lock_guard<std::mutex> lock(enabledMutex);
+  bool wasEnabled = disabledOperations.find(operationName) == end(disabledOperations);
+  if (wasEnabled == enabled)
+    return false;
+  if (enabled)
+    disabledOperations.erase(operationName);
+  else
+    disabledOperations.insert(operationName);
+  return true;
+}
+
+std::vector<std::string> RenderGraphExecutable::updateOperationsEnabled(const RenderGraph& renderGraph)
+{
+  // operations culled during compilation are not present in commands
+  std::vector<std::string> results;
+  std::lock_guard<std::mutex> lock(enabledMutex);
+  for (auto& commandSeq : commands)
+  {
+    for (auto& command : commandSeq)
+    {
+      bool enabled    = renderGraph.getRenderOperation(command->operation.name).enabled;
+      bool wasEnabled = disabledOperations.find(command->operation.name) == end(disabledOperations);
+      if (wasEnabled == enabled)
+        continue;
+      if (enabled)
+        disabledOperations.erase(command->operation.name);
+      else
+        disabledOperations.insert(command->operation.name);
+      results.push_back(command->operation.name);
+    }
+  }
+  return results;
+}
+
+bool RenderGraphExecutable::isOperationEnabled(const std::string& operationName) const
+{
+  std::lock_guard<std::mutex> lock(enabledMutex);
+  return disabledOperations.find(operationName) == end(disabledOperations);
+}
+
+std::set<std::string> RenderGraphExecutable::getDisabledOperations() const
+{
+  std::lock_guard<std::mutex> lock(enabledMutex);
+  return disabledOperations;
+}
+
+// escapes characters that have special meaning in JSON and Graphviz strings
+std::string escapeExportedString(const std::string& text)
+{
+  std::string result;
+  for (auto c : text)
+  {
+    switch (c)
+    {
+    case '"':  result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n";  break;
+    default:   result += c;      break;
+    }
+  }
+  return result;
+}
+
+const char* exportedOperationTypeName(OperationType operationType)
+{
+  switch (operationType)
+  {
+  case opGraphics: return "graphics";
+  case opCompute:  return "compute";
+  case opTransfer: return "transfer";
+  default:         return "unknown";
+  }
+}
+
+const char* exportedEntryTypeName(OperationEntryType entryType)
+{
+  switch (entryType)
+  {
+  case opeAttachmentInput:         return "attachment_input";
+  case opeAttachmentOutput:        return "attachment_output";
+  case opeAttachmentResolveOutput: return "attachment_resolve_output";
+  case opeAttachmentDepthOutput:   return "attachment_depth_output";
+  case opeAttachmentDepthInput:    return "attachment_depth_input";
+  case opeBufferInput:             return "buffer_input";
+  case opeBufferOutput:            return "buffer_output";
+  case opeImageInput:              return "image_input";
+  case opeImageOutput:             return "image_output";
+  default:                         return "unknown";
+  }
+}
+
+void exportBarrierGroupsJSON(std::ostream& stream, const std::map<MemoryObjectBarrierGroup, std::vector<MemoryObjectBarrier>>& barrierGroups, const std::map<const MemoryObject*, uint32_t>& objectIDs)
+{
+  stream << "[";
+  uint32_t groupIndex = 0;
+  for (const auto& barrierGroup : barrierGroups)
+  {
+    stream << (groupIndex++ > 0 ? ", " : "") << "{ \"srcStageMask\": " << barrierGroup.first.srcStageMask << ", \"dstStageMask\": " << barrierGroup.first.dstStageMask << ", \"dependencyFlags\": " << barrierGroup.first.dependencyFlags << ", \"barriers\": [";
+    for (uint32_t i = 0; i < barrierGroup.second.size(); ++i)
+    {
+      const auto& barrier = barrierGroup.second[i];
+      auto oit = objectIDs.find(barrier.memoryObject.get());
+      stream << (i > 0 ? ", " : "") << "{ \"object\": " << ((oit != end(objectIDs)) ? static_cast<int64_t>(oit->second) : -1);
+      stream << ", \"type\": \"" << ((barrier.objectType == MemoryObject::moImage) ? "image" : "buffer") << "\"";
+      stream << ", \"srcAccessMask\": " << barrier.srcAccessMask << ", \"dstAccessMask\": " << barrier.dstAccessMask << ", \"srcQueue\": " << barrier.srcQueueIndex << ", \"dstQueue\": " << barrier.dstQueueIndex;
+      if (barrier.objectType == MemoryObject::moImage)
+        stream << ", \"oldLayout\": " << barrier.oldLayout << ", \"newLayout\": " << barrier.newLayout;
+      else
+        stream << ", \"offset\": " << barrier.bufferRange.offset << ", \"range\": " << barrier.bufferRange.range;
+      stream << " }";
+    }
+    stream << "] }";
+  }
+  stream << "]";
+}
+
+void RenderGraphExecutable::exportGraphviz(const RenderGraph& renderGraph, std::ostream& stream) const
+{
+  stream << "digraph \"" << escapeExportedString(name) << "\"\n{\n";
+  stream << "  rankdir=LR;\n";
+  stream << "  node [shape=box];\n";
+  stream << "  edge [fontsize=10];\n";
+
+  // operations are grouped by queue and render pass. Edges in a queue show the order of execution
+  std::map<std::string, uint32_t> operationQueue;
+  uint32_t renderPassCount = 0;
+  for (uint32_t q = 0; q < commands.size(); ++q)
+  {
+    stream << "  subgraph cluster_queue" << q << "\n  {\n";
+    stream << "    label=\"queue " << q << "\";\n";
+    RenderPass* currentRenderPass = nullptr;
+    for (const auto& command : commands[q])
+    {
+      RenderPass* renderPass = (command->commandType == RenderCommand::ctRenderSubPass) ? std::dynamic_pointer_cast<RenderSubPass>(command)->renderPass.get() : nullptr;
+      if (renderPass != currentRenderPass)
+      {
+        if (currentRenderPass != nullptr)
+          stream << "    }\n";
+        if (renderPass != nullptr)
+          stream << "    subgraph cluster_renderpass" << renderPassCount++ << "\n    {\n    label=\"render pass\";\n    style=dashed;\n";
+        currentRenderPass = renderPass;
+      }
+      uint32_t barrierCount = 0;
+      for (const auto& barrierGroup : command->barriersBeforeOp)
+        barrierCount += barrierGroup.second.size();
+      for (const auto& barrierGroup : command->barriersAfterOp)
+        barrierCount += barrierGroup.second.size();
+      stream << "    \"" << escapeExportedString(command->operation.name) << "\" [label=\"" << escapeExportedString(command->operation.name) << "\\n#" << operationIndices.at(command->operation.name) << " " << exportedOperationTypeName(command->operation.operationType) << "\\nbarriers : " << barrierCount << "\"";
+      if (!isOperationEnabled(command->operation.name))
+        stream << ", style=dotted";
+      stream << "];\n";
+      operationQueue.insert({ command->operation.name, q });
+    }
+    if (currentRenderPass != nullptr)
+      stream << "    }\n";
+    for (uint32_t i = 1; i < commands[q].size(); ++i)
+      stream << "    \"" << escapeExportedString(commands[q][i - 1]->operation.name) << "\" -> \"" << escapeExportedString(commands[q][i]->operation.name) << "\" [color=gray, style=bold];\n";
+    stream << "  }\n";
+  }
+
+  // resource transitions. Transitions between queues are drawn with thick lines
+  std::set<uint32_t> visitedTransitions;
+  for (const auto& transition : renderGraph.getTransitions())
+  {
+    if (!visitedTransitions.insert(transition.tid()).second)
+      continue;
+    auto generatingTransitions = renderGraph.getTransitionIO(transition.tid(), opeAllOutputs);
+    auto consumingTransitions  = renderGraph.getTransitionIO(transition.tid(), opeAllInputs);
+    for (const auto& generatingTransition : generatingTransitions)
+    {
+      auto gqit = operationQueue.find(generatingTransition.get().operationName());
+      if (gqit == end(operationQueue))
+        continue;
+      for (const auto& consumingTransition : consumingTransitions)
+      {
+        auto cqit = operationQueue.find(consumingTransition.get().operationName());
+        if (cqit == end(operationQueue))
+          continue;
+        auto entryType = consumingTransition.get().entry().entryType;
+        const char* color = ((entryType & opeAllAttachments) != 0) ? "blue" : ((entryType & opeAllImages) != 0) ? "darkgreen" : "orange";
+        auto aliasIt = memoryObjectAliases.find(transition.oid());
+        stream << "  \"" << escapeExportedString(generatingTransition.get().operationName()) << "\" -> \"" << escapeExportedString(consumingTransition.get().operationName()) << "\" [color=" << color;
+        stream << ", label=\"" << escapeExportedString(consumingTransition.get().entryName()) << "\\nobject " << transition.oid();
+        if (aliasIt != end(memoryObjectAliases) && aliasIt->second != transition.oid())
+          stream << " ( alias of " << aliasIt->second << " )";
+        stream << "\"";
+        if (gqit->second != cqit->second)
+          stream << ", penwidth=3";
+        stream << "];\n";
+      }
+    }
+  }
+  stream << "}" << std::endl;
+}
+
+void RenderGraphExecutable::exportJSON(const RenderGraph& renderGraph, uint32_t surfaceID, std::ostream& stream) const
+{
+  std::map<uint32_t, std::string> operationNames;
+  for (const auto& opIndex : operationIndices)
+    operationNames.insert({ opIndex.second, opIndex.first });
+  std::map<const MemoryObject*, uint32_t> objectIDs;
+  for (const auto& memoryImage : memoryImages)
+    objectIDs.insert({ memoryImage.second.get(), memoryImage.first });
+  for (const auto& memoryBuffer : memoryBuffers)
+    objectIDs.insert({ memoryBuffer.second.get(), memoryBuffer.first });
+  auto statistics = getTransientMemoryStatistics(surfaceID);
+
+  stream << "{\n";
+  stream << "  \"name\": \"" << escapeExportedString(name) << "\",\n";
+
+  // queues with their operations in order of execution
+  stream << "  \"queues\": [\n";
+  for (uint32_t q = 0; q < commands.size(); ++q)
+  {
+    stream << "    { \"index\": " << q << ", \"dependsOn\": [";
+    if (q < queueDependencies.size())
+    {
+      uint32_t i = 0;
+      for (auto dependency : queueDependencies[q])
+        stream << (i++ > 0 ? ", " : "") << dependency;
+    }
+    stream << "], \"operations\": [";
+    for (uint32_t i = 0; i < commands[q].size(); ++i)
+      stream << (i > 0 ? ", " : "") << "\"" << escapeExportedString(commands[q][i]->operation.name) << "\"";
+    stream << "] }" << (q + 1 < commands.size() ? "," : "") << "\n";
+  }
+  stream << "  ],\n";
+
+  // operations with render pass placement and barriers
+  std::map<RenderPass*, uint32_t> renderPassIndices;
+  std::vector<RenderPass*>        renderPasses;
+  std::vector<std::string>        operationDescriptions;
+  for (uint32_t q = 0; q < commands.size(); ++q)
+  {
+    for (uint32_t i = 0; i < commands[q].size(); ++i)
+    {
+      const auto& command = commands[q][i];
+      std::ostringstream desc;
+      desc << "    { \"name\": \"" << escapeExportedString(command->operation.name) << "\", \"type\": \"" << exportedOperationTypeName(command->operation.operationType) << "\"";
+      desc << ", \"index\": " << operationIndices.at(command->operation.name) << ", \"queue\": " << q << ", \"position\": " << i << ", \"enabled\": " << (isOperationEnabled(command->operation.name) ? "true" : "false");
+      if (command->commandType == RenderCommand::ctRenderSubPass)
+      {
+        auto subpass = std::dynamic_pointer_cast<RenderSubPass>(command);
+        auto rpit = renderPassIndices.find(subpass->renderPass.get());
+        if (rpit == end(renderPassIndices))
+        {
+          rpit = renderPassIndices.insert({ subpass->renderPass.get(), renderPasses.size() }).first;
+          renderPasses.push_back(subpass->renderPass.get());
+        }
+        desc << ", \"renderPass\": " << rpit->second << ", \"subpass\": " << subpass->subpassIndex;
+      }
+      desc << ",\n      \"barriersBefore\": ";
+      exportBarrierGroupsJSON(desc, command->barriersBeforeOp, objectIDs);
+      desc << ",\n      \"barriersAfter\": ";
+      exportBarrierGroupsJSON(desc, command->barriersAfterOp, objectIDs);
+      desc << " }";
+      operationDescriptions.push_back(desc.str());
+    }
+  }
+  stream << "  \"operations\": [\n";
+  for (uint32_t i = 0; i < operationDescriptions.size(); ++i)
+    stream << operationDescriptions[i] << (i + 1 < operationDescriptions.size() ? "," : "") << "\n";
+  stream << "  ],\n";
+
+  // render passes with subpass dependencies. External subpass is written as -1
+  stream << "  \"renderPasses\": [\n";
+  for (uint32_t r = 0; r < renderPasses.size(); ++r)
+  {
+    stream << "    { \"index\": " << r << ", \"operations\": [";
+    for (uint32_t i = 0; i < renderPasses[r]->subPasses.size(); ++i)
+      stream << (i > 0 ? ", " : "") << "\"" << escapeExportedString(renderPasses[r]->subPasses[i].lock()->operation.name) << "\"";
+    stream << "], \"dependencies\": [";
+    for (uint32_t i = 0; i < renderPasses[r]->dependencies.size(); ++i)
+    {
+      const auto& dep = renderPasses[r]->dependencies[i];
+      stream << (i > 0 ? ", " : "") << "{ \"srcSubpass\": " << ((dep.srcSubpass == VK_SUBPASS_EXTERNAL) ? -1 : static_cast<int64_t>(dep.srcSubpass)) << ", \"dstSubpass\": " << ((dep.dstSubpass == VK_SUBPASS_EXTERNAL) ? -1 : static_cast<int64_t>(dep.dstSubpass));
+      stream << ", \"srcStageMask\": " << dep.srcStageMask << ", \"dstStageMask\": " << dep.dstStageMask << ", \"srcAccessMask\": " << dep.srcAccessMask << ", \"dstAccessMask\": " << dep.dstAccessMask << ", \"dependencyFlags\": " << dep.dependencyFlags << " }";
+    }
+    stream << "] }" << (r + 1 < renderPasses.size() ? "," : "") << "\n";
+  }
+  stream << "  ],\n";
+
+  // resource transitions of compiled operations
+  stream << "  \"transitions\": [";
+  std::set<uint32_t> visitedTransitions;
+  uint32_t transitionCount = 0;
+  for (const auto& transition : renderGraph.getTransitions())
+  {
+    if (!visitedTransitions.insert(transition.tid()).second)
+      continue;
+    auto transitionIO = renderGraph.getTransitionIO(transition.tid(), opeAllInputsOutputs);
+    std::vector<std::reference_wrapper<const ResourceTransition>> compiledIO;
+    std::copy_if(begin(transitionIO), end(transitionIO), std::back_inserter(compiledIO), [this](const ResourceTransition& tr) { return operationIndices.find(tr.operationName()) != end(operationIndices); });
+    if (compiledIO.empty())
+      continue;
+    auto aliasIt = memoryObjectAliases.find(transition.oid());
+    stream << (transitionCount++ > 0 ? "," : "") << "\n    { \"tid\": " << transition.tid() << ", \"object\": " << transition.oid() << ", \"memoryObject\": " << ((aliasIt != end(memoryObjectAliases)) ? aliasIt->second : transition.oid());
+    stream << ", \"external\": \"" << escapeExportedString(transition.externalMemoryObjectName()) << "\", \"entries\": [";
+    for (uint32_t i = 0; i < compiledIO.size(); ++i)
+      stream << (i > 0 ? ", " : "") << "{ \"operation\": \"" << escapeExportedString(compiledIO[i].get().operationName()) << "\", \"entry\": \"" << escapeExportedString(compiledIO[i].get().entryName()) << "\", \"type\": \"" << exportedEntryTypeName(compiledIO[i].get().entry().entryType) << "\" }";
+    stream << "] }";
+  }
+  stream << "\n  ],\n";
+
+  // images with their lifetimes ( first and last operation index ) and memory placement. Lifetimes of aliased objects are added to the image they alias
+  std::map<uint32_t, std::pair<uint32_t, uint32_t>> imageLifetimes;
+  for (const auto& ivInfo : imageViewInfo)
+  {
+    auto aliasIt  = memoryObjectAliases.find(ivInfo.oid);
+    uint32_t objectID = (aliasIt != end(memoryObjectAliases)) ? aliasIt->second : ivInfo.oid;
+    for (uint32_t i = 0; i < ivInfo.operationParticipants.size(); ++i)
+    {
+      if (ivInfo.operationParticipants[i] == 0)
+        continue;
+      auto it = imageLifetimes.find(objectID);
+      if (it == end(imageLifetimes))
+        imageLifetimes.insert({ objectID, { i, i } });
+      else
+      {
+        it->second.first  = std::min(it->second.first, i);
+        it->second.second = std::max(it->second.second, i);
+      }
+    }
+  }
+  stream << "  \"images\": [\n";
+  uint32_t imageCount = 0;
+  for (const auto& image : imageInfo)
+  {
+    stream << (imageCount++ > 0 ? ",\n" : "") << "    { \"object\": " << image.first << ", \"format\": " << image.second.attachmentDefinition.format << ", \"usage\": " << image.second.imageUsage;
+    stream << ", \"swapchain\": " << (image.second.isSwapchainImage ? "true" : "false") << ", \"external\": \"" << escapeExportedString(image.second.externalMemoryImageName) << "\"";
+    stream << ", \"transient\": " << (transientConflicts.find(image.first) != end(transientConflicts) ? "true" : "false");
+    auto sit = statistics.imageSizes.find(image.first);
+    if (sit != end(statistics.imageSizes))
+      stream << ", \"size\": " << sit->second;
+    auto oit = statistics.imageOffsets.find(image.first);
+    if (oit != end(statistics.imageOffsets))
+      stream << ", \"offset\": " << oit->second;
+    stream << ", \"aliases\": [";
+    uint32_t aliasCount = 0;
+    for (const auto& alias : memoryObjectAliases)
+      if (alias.second == image.first && alias.first != image.first)
+        stream << (aliasCount++ > 0 ? ", " : "") << alias.first;
+    stream << "]";
+    auto lit = imageLifetimes.find(image.first);
+    if (lit != end(imageLifetimes))
+      stream << ", \"firstOperation\": " << lit->second.first << ", \"lastOperation\": " << lit->second.second;
+    stream << " }";
+  }
+  stream << "\n  ],\n";
+
+  // layouts of each image view in operations that use it
+  stream << "  \"imageLayouts\": [\n";
+  for (uint32_t v = 0; v < imageViewInfo.size(); ++v)
+  {
+    const auto& ivInfo = imageViewInfo[v];
+    const auto& range  = ivInfo.imageView->subresourceRange;
+    stream << "    { \"object\": " << ivInfo.oid << ", \"aspectMask\": " << range.aspectMask << ", \"baseMipLevel\": " << range.baseMipLevel << ", \"levelCount\": " << range.levelCount << ", \"baseArrayLayer\": " << range.baseArrayLayer << ", \"layerCount\": " << range.layerCount << ", \"layouts\": [";
+    uint32_t layoutCount = 0;
+    for (uint32_t i = 0; i < ivInfo.operationParticipants.size() && i < ivInfo.layouts.size(); ++i)
+    {
+      if (ivInfo.operationParticipants[i] == 0)
+        continue;
+      auto nit = operationNames.find(i);
+      stream << (layoutCount++ > 0 ? ", " : "") << "{ \"operation\": \"" << escapeExportedString(nit != end(operationNames) ? nit->second : std::string()) << "\", \"layout\": " << ivInfo.layouts[i] << " }";
+    }
+    stream << "] }" << (v + 1 < imageViewInfo.size() ? "," : "") << "\n";
+  }
+  stream << "  ],\n";
+
+  // memory used by transient images : total and at each operation. Transient images with memory offset share a single SharedMemoryBlock, remaining ones use separate memory.
+  // "bytes" is the memory held by live images : the whole shared block when any of its images is live, plus separate memory of live images.
+  // "sharedBytes" is the part of the shared block used by live images ( images living at the same time never overlap in the block )
+  stream << "  \"memory\": { \"surface\": " << surfaceID << ", \"separateSize\": " << statistics.separateSize << ", \"aliasedSize\": " << statistics.aliasedSize << ", \"imageCount\": " << statistics.imageCount;
+  stream << ", \"sharedBlock\": { \"size\": " << (statistics.imageOffsets.empty() ? 0 : statistics.aliasedSize) << ", \"images\": [";
+  uint32_t sharedCount = 0;
+  for (const auto& imageOffset : statistics.imageOffsets)
+    stream << (sharedCount++ > 0 ? ", " : "") << imageOffset.first;
+  stream << "] } },\n";
+  stream << "  \"memoryTimeline\": [\n";
+  uint32_t timelineCount = 0;
+  for (const auto& opName : operationNames)
+  {
+    VkDeviceSize separateBytes = 0, sharedBytes = 0;
+    bool sharedBlockLive = false;
+    std::vector<uint32_t> liveImages;
+    for (const auto& imageSize : statistics.imageSizes)
+    {
+      auto lit = imageLifetimes.find(imageSize.first);
+      if (lit == end(imageLifetimes) || lit->second.first > opName.first || lit->second.second < opName.first)
+        continue;
+      if (statistics.imageOffsets.find(imageSize.first) != end(statistics.imageOffsets))
+      {
+        sharedBytes     += imageSize.second;
+        sharedBlockLive = true;
+      }
+      else
+        separateBytes += imageSize.second;
+      liveImages.push_back(imageSize.first);
+    }
+    VkDeviceSize liveBytes = separateBytes + (sharedBlockLive ? statistics.aliasedSize : 0);
+    stream << (timelineCount++ > 0 ? ",\n" : "") << "    { \"operation\": \"" << escapeExportedString(opName.second) << "\", \"index\": " << opName.first << ", \"bytes\": " << liveBytes << ", \"sharedBytes\": " << sharedBytes << ", \"separateBytes\": " << separateBytes << ", \"images\": [";
+    for (uint32_t i = 0; i < liveImages.size(); ++i)
+      stream << (i > 0 ? ", " : "") << liveImages[i];
+    stream << "] }";
+  }
+  stream << "\n  ]\n";
+  stream << "}" << std::endl;
+}
+
+namespace pumex
+{
+
+VkDeviceSize placeAliasedObjects(const std::vector<VkMemoryRequirements>& requirements, const std::vector<std::set<uint32_t>>& conflicts, std::vector<VkDeviceSize>& offsets)
+{
+  // greedy placement : largest objects first, each one goes into the lowest gap left by already placed objects it is in conflict with
+  std::vector<uint32_t> order(requirements.size());
+  for (uint32_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(begin(order), end(order), [&requirements](uint32_t lhs, uint32_t rhs) { return requirements[lhs].size > requirements[rhs].size; });
+
+  offsets.assign(requirements.size(), 0);
+  std::vector<bool> placed(requirements.size(), false);
+  VkDeviceSize totalSize = 0;
+  for (auto objectID : order)
+  {
+    std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+    for (auto conflictID : conflicts[objectID])
+      if (placed[conflictID])
+        occupied.push_back({ offsets[conflictID], offsets[conflictID] + requirements[conflictID].size });
+    std::sort(begin(occupied), end(occupied));
+
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements[objectID].alignment, 1);
+    VkDeviceSize offset    = 0;
+    for (const auto& interval : occupied)
+    {
+      if (offset + requirements[objectID].size <= interval.first)
+        break;
+      offset = std::max(offset, ((interval.second + alignment - 1) / alignment) * alignment);
+    }
+    offsets[objectID] = offset;
+    placed[objectID]  = true;
+    totalSize         = std::max(totalSize, offset + requirements[objectID].size);
+  }
+  return totalSize;
+}
+
+}
@@ -264,6 +264,33 @@ std::shared_ptr<BufferView> RenderCommand::getBufferViewByEntryName(const std::s
   return it2->second;
 }
 
+std::vector<std::shared_ptr<CommandBuffer>> RenderCommand::getParallelCommandBuffers(const RenderContext& renderContext, uint32_t queueFamilyIndex, uint32_t count)
+{
+  std::lock_guard<std::mutex> lock(parallelMutex);
+  auto& pcBuffers = parallelCommandBuffers[renderContext.surface->getID()];
+  // command buffers must be recreated when number of swapchain images grows
+  for (auto& pcb : pcBuffers)
+  {
+    if (pcb.imageCount >= renderContext.imageCount)
+      continue;
+    pcb.commandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_SECONDARY, renderContext.device, pcb.commandPool, renderContext.imageCount);
+    pcb.imageCount    = renderContext.imageCount;
+  }
+  while (pcBuffers.size() < count)
+  {
+    ParallelCommandBuffer pcb;
+    pcb.commandPool   = std::make_shared<CommandPool>(queueFamilyIndex);
+    pcb.commandPool->validate(renderContext.device);
+    pcb.commandBuffer = std::make_shared<CommandBuffer>(VK_COMMAND_BUFFER_LEVEL_SECONDARY, renderContext.device, pcb.commandPool, renderContext.imageCount);
+    pcb.imageCount    = renderContext.imageCount;
+    pcBuffers.push_back(pcb);
+  }
+  std::vector<std::shared_ptr<CommandBuffer>> results;
+  for (uint32_t i = 0; i < count; ++i)
+    results.push_back(pcBuffers[i].commandBuffer);
+  return results;
+}
+
 RenderSubPass::RenderSubPass()
   : RenderCommand(RenderCommand::ctRenderSubPass)
 {
@@ -281,6 +308,8 @@ void RenderSubPass::validate(const RenderContext& renderContext)
 
 void RenderSubPass::applyRenderContextVisitor(RenderContextVisitor& visitor)
 {
+  if (!visitor.renderContext.isOperationEnabled(operation))
+    return;
   visitor.renderContext.setFrameBuffer(renderPass->frameBuffer);
   visitor.renderContext.setRenderPass(renderPass);
   visitor.renderContext.setSubpassIndex(subpassIndex);
@@ -303,42 +332,62 @@ void RenderSubPass::buildCommandBuffer(BuildCommandBufferVisitor& commandVisitor
   for (auto& barrierGroup : barriersBeforeOp)
     commandVisitor.commandBuffer->cmdPipelineBarrier(commandVisitor.renderContext, barrierGroup.first, barrierGroup.second);
 
-  VkSubpassContents subpassContents = (operation.node.get() != nullptr && !operation.node->hasSecondaryBuffer()) ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
-  if (subpassIndex == 0)
+  // disabled operation still begins and ends its subpass, so that attachment load/store operations and layouts stay the same
+  bool enabled = commandVisitor.renderContext.isOperationEnabled(operation);
+  VkSubpassContents subpassContents = (!enabled || (operation.node.get() != nullptr && !operation.node->hasSecondaryBuffer())) ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+
+  // large operation recorded inline may be split into secondary command buffers recorded in parallel
+  std::shared_ptr<DrawList>  drawList;
+  std::vector<DrawListChunk> chunks;
+  if (enabled && subpassContents == VK_SUBPASS_CONTENTS_INLINE && commandVisitor.useDrawLists)
   {
-    VkRect2D rectangle;
-    VkViewport viewport;
-    // FIXME : what about viewport Z coordinates ?
-    switch (operation.attachmentSize.type)
-    {
-    case isSurfaceDependent:
-      rectangle = makeVkRect2D(operation.attachmentSize, commandVisitor.renderContext.surface->swapChainSize);
-      viewport  = makeVkViewport(0, 0, commandVisitor.renderContext.surface->swapChainSize.width * operation.attachmentSize.size.x, commandVisitor.renderContext.surface->swapChainSize.height * operation.attachmentSize.size.y, 0.0f, 1.0f);
-      break;
-    case isAbsolute:
-      rectangle = makeVkRect2D(operation.attachmentSize);
-      viewport  = makeVkViewport(0, 0, operation.attachmentSize.size.x, operation.attachmentSize.size.y, 0.0f, 1.0f);
-      break;
-    default:
-      rectangle = makeVkRect2D(0, 0, 1, 1);
-      viewport  = makeVkViewport(0, 0, 1, 1, 0.0f, 1.0f);
-      break;
-    }
+    drawList = commandVisitor.getDrawList(*operation.node);
+    chunks   = commandVisitor.splitDrawList(*drawList);
+    if (!chunks.empty())
+      subpassContents = VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+  }
+
+  VkRect2D rectangle;
+  VkViewport viewport;
+  // FIXME : what about viewport Z coordinates ?
+  switch (operation.attachmentSize.type)
+  {
+  case isSurfaceDependent:
+    rectangle = makeVkRect2D(operation.attachmentSize, commandVisitor.renderContext.surface->swapChainSize);
+    viewport  = makeVkViewport(0, 0, commandVisitor.renderContext.surface->swapChainSize.width * operation.attachmentSize.size.x, commandVisitor.renderContext.surface->swapChainSize.height * operation.attachmentSize.size.y, 0.0f, 1.0f);
+    break;
+  case isAbsolute:
+    rectangle = makeVkRect2D(operation.attachmentSize);
+    viewport  = makeVkViewport(0, 0, operation.attachmentSize.size.x, operation.attachmentSize.size.y, 0.0f, 1.0f);
+    break;
+  default:
+    rectangle = makeVkRect2D(0, 0, 1, 1);
+    viewport  = makeVkViewport(0, 0, 1, 1, 0.0f, 1.0f);
+    break;
+  }
 
+  if (subpassIndex == 0)
     commandVisitor.commandBuffer->cmdBeginRenderPass( commandVisitor.renderContext, this, rectangle, renderPass->clearValues, subpassContents );
+  else
+    commandVisitor.commandBuffer->cmdNextSubPass(this, subpassContents);
+  // commands may not be recorded inline in subpass with secondary command buffers - these set viewport and scissor on their own.
+  // Dynamic state is set in each inline subpass, because secondary command buffers executed in previous subpasses leave it undefined
+  if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
+  {
     commandVisitor.commandBuffer->cmdSetViewport(0, { viewport });
     commandVisitor.commandBuffer->cmdSetScissor(0, { rectangle });
   }
-  else
+
+  if (enabled)
   {
-    commandVisitor.commandBuffer->cmdNextSubPass(this, subpassContents);
+    if (!chunks.empty())
+      commandVisitor.recordParallel(*this, *drawList, chunks, renderPass->getHandle(commandVisitor.renderContext), subpassIndex, { viewport }, { rectangle });
+    else if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
+      commandVisitor.build(*operation.node);
+    else
+      commandVisitor.commandBuffer->executeCommandBuffer(commandVisitor.renderContext, operation.node->getSecondaryBuffer(commandVisitor.renderContext).get());
   }
 
-  if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
-    operation.node->accept(commandVisitor);
-  else
-    commandVisitor.commandBuffer->executeCommandBuffer(commandVisitor.renderContext, operation.node->getSecondaryBuffer(commandVisitor.renderContext).get());
-
   if (renderPass->subPasses.size() == subpassIndex + 1)
     commandVisitor.commandBuffer->cmdEndRenderPass();
 
@@ -362,6 +411,8 @@ void ComputePass::validate(const RenderContext& renderContext)
 
 void ComputePass::applyRenderContextVisitor(RenderContextVisitor& visitor)
 {
+  if (!visitor.renderContext.isOperationEnabled(operation))
+    return;
   visitor.renderContext.setRenderOperation(&operation);
 
   operation.node->accept(visitor);
@@ -376,11 +427,30 @@ void ComputePass::buildCommandBuffer(BuildCommandBufferVisitor& commandVisitor)
   for (auto& barrierGroup : barriersBeforeOp)
     commandVisitor.commandBuffer->cmdPipelineBarrier(commandVisitor.renderContext, barrierGroup.first, barrierGroup.second);
 
-  VkSubpassContents subpassContents = operation.node->hasSecondaryBuffer() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
-  if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
-    operation.node->accept(commandVisitor);
-  else
-    commandVisitor.commandBuffer->executeCommandBuffer(commandVisitor.renderContext, operation.node->getSecondaryBuffer(commandVisitor.renderContext).get());
+  // barriers of disabled operation are recorded, so that layouts of images used by following operations stay the same
+  if (commandVisitor.renderContext.isOperationEnabled(operation))
+  {
+    VkSubpassContents subpassContents = operation.node->hasSecondaryBuffer() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+    if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
+    {
+      // large operation may be split into secondary command buffers recorded in parallel
+      std::shared_ptr<DrawList>  drawList;
+      std::vector<DrawListChunk> chunks;
+      if (commandVisitor.useDrawLists)
+      {
+        drawList = commandVisitor.getDrawList(*operation.node);
+        chunks   = commandVisitor.splitDrawList(*drawList);
+      }
+      if (!chunks.empty())
+        commandVisitor.recordParallel(*this, *drawList, chunks, VK_NULL_HANDLE, 0, {}, {});
+      else if (drawList != nullptr)
+        commandVisitor.replay(*drawList);
+      else
+        commandVisitor.build(*operation.node);
+    }
+    else
+      commandVisitor.commandBuffer->executeCommandBuffer(commandVisitor.renderContext, operation.node->getSecondaryBuffer(commandVisitor.renderContext).get());
+  }
 
   for (auto& barrierGroup : barriersAfterOp)
     commandVisitor.commandBuffer->cmdPipelineBarrier(commandVisitor.renderContext, barrierGroup.first, barrierGroup.second);
@@ -400,6 +470,8 @@ void TransferPass::validate(const RenderContext& renderContext)
 
 void TransferPass::applyRenderContextVisitor(RenderContextVisitor& visitor)
 {
+  if (!visitor.renderContext.isOperationEnabled(operation))
+    return;
   visitor.renderContext.setRenderOperation(&operation);
 
   operation.node->accept(visitor);
@@ -414,11 +486,15 @@ void TransferPass::buildCommandBuffer(BuildCommandBufferVisitor& commandVisitor)
   for (auto& barrierGroup : barriersBeforeOp)
     commandVisitor.commandBuffer->cmdPipelineBarrier(commandVisitor.renderContext, barrierGroup.first, barrierGroup.second);
 
-  VkSubpassContents subpassContents = operation.node->hasSecondaryBuffer() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
-  if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
-    operation.node->accept(commandVisitor);
-  else
-    commandVisitor.commandBuffer->executeCommandBuffer(commandVisitor.renderContext, operation.node->getSecondaryBuffer(commandVisitor.renderContext).get());
+  // barriers of disabled operation are recorded, so that layouts of images used by following operations stay the same
+  if (commandVisitor.renderContext.isOperationEnabled(operation))
+  {
+    VkSubpassContents subpassContents = operation.node->hasSecondaryBuffer() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+    if (subpassContents == VK_SUBPASS_CONTENTS_INLINE)
+      commandVisitor.build(*operation.node);
+    else
+      commandVisitor.commandBuffer->executeCommandBuffer(commandVisitor.renderContext, operation.node->getSecondaryBuffer(commandVisitor.renderContext).get());
+  }
 
   for (auto& barrierGroup : barriersAfterOp)
     commandVisitor.commandBuffer->cmdPipelineBarrier(commandVisitor.renderContext, barrierGroup.first, barrierGroup.second);
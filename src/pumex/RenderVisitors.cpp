@@ -28,6 +28,14 @@
 #include <pumex/DispatchNode.h>
 #include <pumex/DrawNode.h>
 #include <pumex/CopyNode.h>
+#include <pumex/PushConstantsNode.h>
+#include <pumex/AssetBuffer.h>
+#include <pumex/Surface.h>
+#include <pumex/Command.h>
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <tbb/tbb.h>
 using namespace pumex;
 
 RenderContextVisitor::RenderContextVisitor(TraversalMode tm, const RenderContext& rc)
@@ -81,10 +89,15 @@ void ValidateDescriptorVisitor::apply(Node& node)
   if (buildingPrimary && node.hasSecondaryBuffer())
     return;
   for (auto dit = node.descriptorSetBegin(); dit != node.descriptorSetEnd(); ++dit)
-    dit->second->validate(renderContext);
+    dit->second->validate(renderContext, writeBatch);
   traverse(node);
 }
 
+void ValidateDescriptorVisitor::flush()
+{
+  writeBatch.flush(renderContext.vkDevice);
+}
+
 CompleteRenderContextVisitor::CompleteRenderContextVisitor(RenderContext& rc)
   : NodeVisitor{ Parents }, renderContext{ rc }
 {
@@ -107,8 +120,239 @@ void CompleteRenderContextVisitor::apply(AssetBufferNode& node)
     traverse(node);
 }
 
+DrawList::DrawList(const RenderContext& renderContext, bool bp)
+  : structureVersion{ Node::getStructureVersion() }, buildingPrimary{ bp }, pipelineLayout{ renderContext.currentPipelineLayout }, bindPoint{ renderContext.currentBindPoint }, assetBuffer{ renderContext.currentAssetBuffer }, renderMask{ renderContext.currentRenderMask }
+{
+}
+
+bool DrawList::isValid(const RenderContext& renderContext, bool bp) const
+{
+  return structureVersion == Node::getStructureVersion() &&
+    buildingPrimary == bp &&
+    pipelineLayout  == renderContext.currentPipelineLayout &&
+    bindPoint       == renderContext.currentBindPoint &&
+    assetBuffer     == renderContext.currentAssetBuffer &&
+    renderMask      == renderContext.currentRenderMask;
+}
+
+uint32_t DrawList::getDrawCount() const
+{
+  uint32_t drawCount = 0;
+  for (const auto& entry : entries)
+    if (entry.type == DrawListEntry::Draw || entry.type == DrawListEntry::Dispatch || entry.type == DrawListEntry::Copy)
+      drawCount++;
+  return drawCount;
+}
+
+std::vector<DrawListChunk> DrawList::split(uint32_t chunkCount) const
+{
+  std::vector<DrawListChunk> results;
+  uint32_t drawCount = getDrawCount();
+  if (chunkCount == 0 || drawCount < chunkCount)
+    return results;
+  // chunk ends at the draw command that reaches its share of all draws. Bind commands following that draw belong to the next chunk
+  size_t   first = 0;
+  uint32_t draws = 0;
+  for (size_t i = 0; i < entries.size() && results.size() + 1 < chunkCount; ++i)
+  {
+    if (entries[i].type != DrawListEntry::Draw && entries[i].type != DrawListEntry::Dispatch && entries[i].type != DrawListEntry::Copy)
+      continue;
+    draws++;
+    if (draws == (drawCount * (results.size() + 1)) / chunkCount)
+    {
+      results.push_back(DrawListChunk{ first, i + 1 });
+      first = i + 1;
+    }
+  }
+  results.push_back(DrawListChunk{ first, entries.size() });
+  return results;
+}
+
+std::vector<size_t> DrawList::getStateEntries(size_t position) const
+{
+  // pipelines and descriptor sets are tracked per bind point ( graphics, compute ), vertex and index buffers are tracked per vertex binding,
+  // push constants are tracked per shader stages and offset
+  const size_t noEntry = entries.size();
+  size_t                            pipeline[2]       = { noEntry, noEntry };
+  PipelineLayout*                   setLayout[2]      = { nullptr, nullptr };
+  std::map<uint32_t, size_t>        descriptorSets[2];
+  std::map<uint32_t, size_t>        vertexIndexBuffers;
+  std::map<std::pair<VkShaderStageFlags, uint32_t>, size_t> pushConstants;
+  for (size_t i = 0; i < position && i < entries.size(); ++i)
+  {
+    const auto& entry = entries[i];
+    uint32_t bp = (entry.bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) ? 1 : 0;
+    switch (entry.type)
+    {
+    case DrawListEntry::BindGraphicsPipeline:
+    case DrawListEntry::BindComputePipeline:
+      pipeline[bp] = i;
+      break;
+    case DrawListEntry::BindDescriptorSet:
+      // descriptor sets bound using different pipeline layout are treated as disturbed
+      if (setLayout[bp] != entry.pipelineLayout)
+      {
+        descriptorSets[bp].clear();
+        setLayout[bp] = entry.pipelineLayout;
+      }
+      descriptorSets[bp][entry.setIndex] = i;
+      break;
+    case DrawListEntry::BindVertexIndexBuffer:
+      vertexIndexBuffers[static_cast<AssetBufferNode*>(entry.node)->vertexBinding] = i;
+      break;
+    case DrawListEntry::PushConstants:
+    {
+      auto pushConstantsNode = static_cast<PushConstantsNode*>(entry.node);
+      pushConstants[{ pushConstantsNode->getStageFlags(), pushConstantsNode->getOffset() }] = i;
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  std::vector<size_t> results;
+  for (uint32_t bp = 0; bp < 2; ++bp)
+  {
+    if (pipeline[bp] != noEntry)
+      results.push_back(pipeline[bp]);
+    for (const auto& ds : descriptorSets[bp])
+      results.push_back(ds.second);
+  }
+  for (const auto& vib : vertexIndexBuffers)
+    results.push_back(vib.second);
+  for (const auto& pc : pushConstants)
+    results.push_back(pc.second);
+  // commands are recorded in original order, so that the last bound index buffer stays bound
+  std::sort(begin(results), end(results));
+  return results;
+}
+
+CompileDrawListVisitor::CompileDrawListVisitor(const RenderContext& rc, DrawList& dl)
+  : RenderContextVisitor{ AllChildren, rc }, drawList( dl )
+{
+}
+
+void CompileDrawListVisitor::apply(Node& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  applyDescriptorSets(node);
+  traverse(node);
+}
+
+void CompileDrawListVisitor::apply(GraphicsPipeline& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  PipelineLayout* previousPL     = renderContext.setCurrentPipelineLayout(node.pipelineLayout.get());
+  VkPipelineBindPoint previousBP = renderContext.setCurrentBindPoint(VK_PIPELINE_BIND_POINT_GRAPHICS);
+  addEntry(DrawListEntry::BindGraphicsPipeline, node);
+  applyDescriptorSets(node);
+  traverse(node);
+  renderContext.setCurrentPipelineLayout(previousPL);
+  renderContext.setCurrentBindPoint(previousBP);
+}
+
+void CompileDrawListVisitor::apply(ComputePipeline& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  PipelineLayout* previousPL     = renderContext.setCurrentPipelineLayout(node.pipelineLayout.get());
+  VkPipelineBindPoint previousBP = renderContext.setCurrentBindPoint(VK_PIPELINE_BIND_POINT_COMPUTE);
+  addEntry(DrawListEntry::BindComputePipeline, node);
+  applyDescriptorSets(node);
+  traverse(node);
+  renderContext.setCurrentPipelineLayout(previousPL);
+  renderContext.setCurrentBindPoint(previousBP);
+}
+
+void CompileDrawListVisitor::apply(AssetBufferNode& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  AssetBuffer* previousAB = renderContext.setCurrentAssetBuffer(node.assetBuffer.get());
+  uint32_t     previousRM = renderContext.setCurrentRenderMask(node.renderMask);
+  applyDescriptorSets(node);
+  addEntry(DrawListEntry::BindVertexIndexBuffer, node);
+  traverse(node);
+  renderContext.setCurrentAssetBuffer(previousAB);
+  renderContext.setCurrentRenderMask(previousRM);
+}
+
+void CompileDrawListVisitor::apply(DrawNode& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  applyDescriptorSets(node);
+  addEntry(DrawListEntry::Draw, node);
+  traverse(node);
+}
+
+void CompileDrawListVisitor::apply(DispatchNode& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  applyDescriptorSets(node);
+  addEntry(DrawListEntry::Dispatch, node);
+  traverse(node);
+}
+
+void CompileDrawListVisitor::apply(CopyNode& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  addEntry(DrawListEntry::Copy, node);
+  traverse(node);
+}
+
+void CompileDrawListVisitor::apply(PushConstantsNode& node)
+{
+  if (drawList.buildingPrimary && node.hasSecondaryBuffer())
+  {
+    addEntry(DrawListEntry::ExecuteSecondaryBuffer, node);
+    return;
+  }
+  applyDescriptorSets(node);
+  addEntry(DrawListEntry::PushConstants, node);
+  traverse(node);
+}
+
+void CompileDrawListVisitor::applyDescriptorSets(Node& node)
+{
+  if (renderContext.currentPipelineLayout == nullptr)
+    return;
+  for (auto it = node.descriptorSetBegin(); it != node.descriptorSetEnd(); ++it)
+    addEntry(DrawListEntry::BindDescriptorSet, node, it->first, it->second.get());
+}
+
+void CompileDrawListVisitor::addEntry(DrawListEntry::Type type, Node& node, uint32_t setIndex, DescriptorSet* descriptorSet)
+{
+  drawList.entries.push_back(DrawListEntry{ type, &node, renderContext.currentPipelineLayout, renderContext.currentBindPoint, renderContext.currentAssetBuffer, renderContext.currentRenderMask, setIndex, descriptorSet });
+}
+
 BuildCommandBufferVisitor::BuildCommandBufferVisitor(const RenderContext& rc, CommandBuffer* cb, bool bp)
-  : RenderContextVisitor{ AllChildren, rc }, commandBuffer{ cb }, buildingPrimary{ bp }
+  : RenderContextVisitor{ AllChildren, rc }, commandBuffer{ cb }, buildingPrimary{ bp }, useDrawLists{ rc.surface->surfaceTraits.useDrawLists }
 {
 }
 
@@ -135,7 +379,6 @@ void BuildCommandBufferVisitor::apply(GraphicsPipeline& node)
   commandBuffer->cmdBindPipeline(renderContext, &node);
   applyDescriptorSets(node);
   traverse(node);
-  // FIXME - bind previous ?
   renderContext.setCurrentPipelineLayout(previousPL);
   renderContext.setCurrentBindPoint(previousBP);
 }
@@ -152,7 +395,6 @@ void BuildCommandBufferVisitor::apply(ComputePipeline& node)
   commandBuffer->cmdBindPipeline(renderContext, &node);
   applyDescriptorSets(node);
   traverse(node);
-  // FIXME - bind previous ?
   renderContext.setCurrentPipelineLayout(previousPL);
   renderContext.setCurrentBindPoint(previousBP);
 }
@@ -170,7 +412,6 @@ void BuildCommandBufferVisitor::apply(AssetBufferNode& node)
   commandBuffer->addSource(&node);
   node.assetBuffer->cmdBindVertexIndexBuffer(renderContext, commandBuffer, node.renderMask, node.vertexBinding);
   traverse(node);
-  // FIXME - bind previous ?
   renderContext.setCurrentAssetBuffer(previousAB);
   renderContext.setCurrentRenderMask(previousRM);
 }
@@ -197,7 +438,7 @@ void BuildCommandBufferVisitor::apply(DispatchNode& node)
   }
   applyDescriptorSets(node);
   commandBuffer->addSource(&node);
-  commandBuffer->cmdDispatch(node.getX(), node.getY(), node.getZ());
+  node.cmdDispatch(renderContext, commandBuffer);
   traverse(node);
 }
 
@@ -213,6 +454,19 @@ void BuildCommandBufferVisitor::apply(CopyNode& node)
   traverse(node);
 }
 
+void BuildCommandBufferVisitor::apply(PushConstantsNode& node)
+{
+  if (buildingPrimary && node.hasSecondaryBuffer())
+  {
+    commandBuffer->executeCommandBuffer(renderContext, node.getSecondaryBuffer(renderContext).get());
+    return;
+  }
+  applyDescriptorSets(node);
+  commandBuffer->addSource(&node);
+  node.cmdPushConstants(renderContext, commandBuffer);
+  traverse(node);
+}
+
 void BuildCommandBufferVisitor::applyDescriptorSets(Node& node)
 {
   if (renderContext.currentPipelineLayout == nullptr)
@@ -222,3 +476,141 @@ void BuildCommandBufferVisitor::applyDescriptorSets(Node& node)
     commandBuffer->cmdBindDescriptorSets(renderContext, renderContext.currentPipelineLayout, it->first, it->second.get());
   }
 }
+
+void BuildCommandBufferVisitor::build(Node& node)
+{
+  if (!useDrawLists)
+  {
+    node.accept(*this);
+    return;
+  }
+  replay(*getDrawList(node));
+}
+
+std::shared_ptr<DrawList> BuildCommandBufferVisitor::getDrawList(Node& node)
+{
+  auto drawList = node.getDrawList();
+  if (drawList == nullptr || !drawList->isValid(renderContext, buildingPrimary))
+  {
+    drawList = std::make_shared<DrawList>(renderContext, buildingPrimary);
+    CompileDrawListVisitor compileVisitor(renderContext, *drawList);
+    node.accept(compileVisitor);
+    node.setDrawList(drawList);
+  }
+  return drawList;
+}
+
+void BuildCommandBufferVisitor::replay(const DrawList& drawList)
+{
+  replay(drawList, 0, drawList.entries.size());
+}
+
+void BuildCommandBufferVisitor::replay(const DrawList& drawList, size_t first, size_t last)
+{
+  PipelineLayout*     previousPL = renderContext.currentPipelineLayout;
+  VkPipelineBindPoint previousBP = renderContext.currentBindPoint;
+  AssetBuffer*        previousAB = renderContext.currentAssetBuffer;
+  uint32_t            previousRM = renderContext.currentRenderMask;
+  for (auto index : drawList.getStateEntries(first))
+    replayEntry(drawList.entries[index]);
+  for (size_t i = first; i < last; ++i)
+    replayEntry(drawList.entries[i]);
+  renderContext.currentPipelineLayout = previousPL;
+  renderContext.currentBindPoint      = previousBP;
+  renderContext.currentAssetBuffer    = previousAB;
+  renderContext.currentRenderMask     = previousRM;
+}
+
+std::vector<DrawListChunk> BuildCommandBufferVisitor::splitDrawList(const DrawList& drawList) const
+{
+  uint32_t drawsPerBuffer = renderContext.surface->surfaceTraits.drawsPerSecondaryBuffer;
+  // only primary command buffers may execute secondary command buffers
+  if (!useDrawLists || !buildingPrimary || drawsPerBuffer == 0)
+    return std::vector<DrawListChunk>();
+  for (const auto& entry : drawList.entries)
+    if (entry.type == DrawListEntry::ExecuteSecondaryBuffer)
+      return std::vector<DrawListChunk>();
+  uint32_t chunkCount = std::min(drawList.getDrawCount() / drawsPerBuffer, std::max(std::thread::hardware_concurrency(), 1u));
+  if (chunkCount < 2)
+    return std::vector<DrawListChunk>();
+  return drawList.split(chunkCount);
+}
+
+void BuildCommandBufferVisitor::recordParallel(RenderCommand& renderCommand, const DrawList& drawList, const std::vector<DrawListChunk>& chunks, VkRenderPass renderPass, uint32_t subpass, const std::vector<VkViewport>& viewports, const std::vector<VkRect2D>& scissors)
+{
+  auto chunkBuffers = renderCommand.getParallelCommandBuffers(renderContext, commandBuffer->commandPool.lock()->queueFamilyIndex, chunks.size());
+  VkCommandBufferUsageFlags usageFlags = (renderPass != VK_NULL_HANDLE) ? VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0;
+  // each chunk has its own command pool, so chunks may be recorded on any worker thread without synchronization
+  tbb::parallel_for
+  (
+    tbb::blocked_range<size_t>(0, chunks.size(), 1),
+    [&](const tbb::blocked_range<size_t>& r)
+    {
+      for (size_t i = r.begin(); i != r.end(); ++i)
+      {
+        CommandBuffer* chunkBuffer = chunkBuffers[i].get();
+        chunkBuffer->setActiveIndex(renderContext.activeIndex);
+        chunkBuffer->setBindFiltering(commandBuffer->getBindFiltering());
+        chunkBuffer->cmdBegin(usageFlags, renderPass, subpass);
+        if (!viewports.empty())
+          chunkBuffer->cmdSetViewport(0, viewports);
+        if (!scissors.empty())
+          chunkBuffer->cmdSetScissor(0, scissors);
+        BuildCommandBufferVisitor chunkVisitor(renderContext, chunkBuffer, false);
+        chunkVisitor.replay(drawList, chunks[i].first, chunks[i].last);
+        chunkBuffer->cmdEnd();
+      }
+    }
+  );
+  for (auto& chunkBuffer : chunkBuffers)
+    commandBuffer->executeCommandBuffer(renderContext, chunkBuffer.get());
+}
+
+void BuildCommandBufferVisitor::replayEntry(const DrawListEntry& entry)
+{
+  renderContext.currentPipelineLayout = entry.pipelineLayout;
+  renderContext.currentBindPoint      = entry.bindPoint;
+  renderContext.currentAssetBuffer    = entry.assetBuffer;
+  renderContext.currentRenderMask     = entry.renderMask;
+  switch (entry.type)
+  {
+  case DrawListEntry::ExecuteSecondaryBuffer:
+    commandBuffer->executeCommandBuffer(renderContext, entry.node->getSecondaryBuffer(renderContext).get());
+    break;
+  case DrawListEntry::BindGraphicsPipeline:
+    commandBuffer->cmdBindPipeline(renderContext, static_cast<GraphicsPipeline*>(entry.node));
+    break;
+  case DrawListEntry::BindComputePipeline:
+    commandBuffer->cmdBindPipeline(renderContext, static_cast<ComputePipeline*>(entry.node));
+    break;
+  case DrawListEntry::BindDescriptorSet:
+    commandBuffer->cmdBindDescriptorSets(renderContext, entry.pipelineLayout, entry.setIndex, entry.descriptorSet);
+    break;
+  case DrawListEntry::BindVertexIndexBuffer:
+  {
+    auto assetBufferNode = static_cast<AssetBufferNode*>(entry.node);
+    commandBuffer->addSource(assetBufferNode);
+    assetBufferNode->assetBuffer->cmdBindVertexIndexBuffer(renderContext, commandBuffer, assetBufferNode->renderMask, assetBufferNode->vertexBinding);
+    break;
+  }
+  case DrawListEntry::PushConstants:
+    commandBuffer->addSource(entry.node);
+    static_cast<PushConstantsNode*>(entry.node)->cmdPushConstants(renderContext, commandBuffer);
+    break;
+  case DrawListEntry::Draw:
+    commandBuffer->addSource(entry.node);
+    static_cast<DrawNode*>(entry.node)->cmdDraw(renderContext, commandBuffer);
+    break;
+  case DrawListEntry::Dispatch:
+  {
+    auto dispatchNode = static_cast<DispatchNode*>(entry.node);
+    commandBuffer->addSource(dispatchNode);
+    dispatchNode->cmdDispatch(renderContext, commandBuffer);
+    break;
+  }
+  case DrawListEntry::Copy:
+    commandBuffer->addSource(entry.node);
+    static_cast<CopyNode*>(entry.node)->cmdCopy(renderContext, commandBuffer);
+    break;
+  }
+}
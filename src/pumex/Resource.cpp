@@ -89,3 +89,8 @@ std::pair<bool, VkDescriptorType> Resource::getDefaultDescriptorType()
   CHECK_LOG_THROW(true, "This resource does not have default descriptor type");
   return{ false,VK_DESCRIPTOR_TYPE_MAX_ENUM };
 }
+
+uint32_t Resource::getDynamicOffset(const RenderContext& renderContext)
+{
+  return 0;
+}
@@ -28,6 +28,7 @@
 #include <pumex/Surface.h>
 #include <pumex/Descriptor.h>
 #include <pumex/Pipeline.h>
+#include <pumex/Command.h>
 #include <pumex/TimeStatistics.h>
 #include <pumex/Text.h>
 #include <pumex/MemoryBuffer.h>
@@ -37,6 +38,8 @@
 #include <pumex/CombinedImageSampler.h>
 #include <pumex/UniformBuffer.h>
 #include <pumex/Camera.h>
+#include <pumex/Device.h>
+#include <pumex/DeviceMemoryAllocator.h>
 #include <pumex/utils/Shapes.h>
 
 using namespace pumex;
@@ -44,9 +47,9 @@ using namespace pumex;
 TimeStatisticsHandler::TimeStatisticsHandler(std::shared_ptr<Viewer> viewer, std::shared_ptr<PipelineCache> pipelineCache, std::shared_ptr<DeviceMemoryAllocator> buffersAllocator, std::shared_ptr<DeviceMemoryAllocator> texturesAllocator, std::shared_ptr<MemoryBuffer> textCameraBuffer, VkSampleCountFlagBits rasterizationSamples )
 {
   showfFPS                   = { false, true, true };
-  viewerStatisticsToCollect  = { 0,  TSV_STAT_RENDER, TSV_STAT_UPDATE | TSV_STAT_RENDER | TSV_STAT_RENDER_EVENTS };
+  viewerStatisticsToCollect  = { 0,  TSV_STAT_RENDER, TSV_STAT_UPDATE | TSV_STAT_RENDER | TSV_STAT_RENDER_EVENTS | TSV_STAT_MEMORY };
   surfaceStatisticsToCollect = { 0,  0,              TSS_STAT_BASIC | TSS_STAT_BUFFERS | TSS_STAT_EVENTS };
-  viewerStatisticsGroups     = { {}, {}, { TSV_GROUP_UPDATE, TSV_GROUP_RENDER, TSV_GROUP_RENDER_EVENTS} };
+  viewerStatisticsGroups     = { {}, {}, { TSV_GROUP_UPDATE, TSV_GROUP_RENDER, TSV_GROUP_RENDER_EVENTS, TSV_GROUP_MEMORY } };
   surfaceStatisticsGroups    = { {}, {}, { TSS_GROUP_BASIC, TSS_GROUP_EVENTS, TSS_GROUP_SECONDARY_BUFFERS, TSS_GROUP_PRIMARY_BUFFERS, TSS_GROUP_PRIMARY_BUFFERS+1, TSS_GROUP_PRIMARY_BUFFERS+2, TSS_GROUP_PRIMARY_BUFFERS+3 } };
 
   // creating root node for statistics rendering
@@ -284,6 +287,9 @@ void TimeStatisticsHandler::collectData(Surface* surface, TimeStatistics* viewer
   {
     if (std::find(begin(viewerStatisticsGroups[statisticsCollection]), end(viewerStatisticsGroups[statisticsCollection]), group.first) == end(viewerStatisticsGroups[statisticsCollection]))
       continue;
+    // memory channels are not time channels - they are shown as text
+    if (group.first == TSV_GROUP_MEMORY)
+      continue;
     textSmall->setText(surface, 100 + group.first, glm::vec2(5, channelHeight -0.2*dHeight), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), group.second);
     auto channelIDs = viewerStatistics->getGroupChannelIDs(group.first);
     for (auto channelID : channelIDs)
@@ -298,6 +304,35 @@ void TimeStatisticsHandler::collectData(Surface* surface, TimeStatistics* viewer
   viewerStatistics->resetMinMaxValues();
   viewerStatistics->setFlags(viewerStatisticsToCollect[statisticsCollection]);
 
+  if (std::find(begin(viewerStatisticsGroups[statisticsCollection]), end(viewerStatisticsGroups[statisticsCollection]), TSV_GROUP_MEMORY) != end(viewerStatisticsGroups[statisticsCollection]))
+  {
+    const uint32_t TSH_MEMORY_ID = 300;
+    auto viewer = surface->viewer.lock();
+    VkDevice device = surface->device.lock()->device;
+    float memoryHeight = 80.0f;
+    uint32_t memoryIndex = 0;
+    for (auto& allocator : viewer->getDeviceMemoryAllocators())
+    {
+      auto stats = allocator->getStatistics(device);
+      std::wstringstream stream;
+      stream << std::wstring(begin(allocator->getName()), end(allocator->getName())) << std::fixed << std::setprecision(2)
+        << L" : used " << stats.usedSize / 1048576.0 << L" / " << stats.memorySize / 1048576.0 << L" MB"
+        << L", largest free " << stats.largestFreeBlock / 1048576.0 << L" MB"
+        << L", allocations " << stats.allocationCount
+        << L", fragmentation " << stats.getFragmentation();
+      textSmall->setText(surface, TSH_MEMORY_ID + memoryIndex, glm::vec2(renderWidth - 600.0f, memoryHeight), glm::vec4(0.1f, 1.0f, 0.1f, 1.0f), stream.str());
+      memoryHeight += 16.0f;
+      memoryIndex++;
+    }
+    auto bindStats = surface->getBindStatistics();
+    std::wstringstream stream;
+    stream << L"binds issued / skipped : pipelines " << bindStats.pipelinesIssued << L" / " << bindStats.pipelinesSkipped
+      << L", descriptor sets " << bindStats.descriptorSetsIssued << L" / " << bindStats.descriptorSetsSkipped
+      << L", vertex buffers " << bindStats.vertexBuffersIssued << L" / " << bindStats.vertexBuffersSkipped
+      << L", index buffers " << bindStats.indexBuffersIssued << L" / " << bindStats.indexBuffersSkipped;
+    textSmall->setText(surface, TSH_MEMORY_ID + memoryIndex, glm::vec2(renderWidth - 600.0f, memoryHeight), glm::vec4(0.1f, 1.0f, 0.1f, 1.0f), stream.str());
+  }
+
 
   for (const auto& group : surfaceStatistics->getGroups())
   {
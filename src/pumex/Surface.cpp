@@ -21,6 +21,7 @@
 //
 
 #include <pumex/Surface.h>
+#include <algorithm>
 #include <tbb/tbb.h>
 #include <pumex/Viewer.h>
 #include <pumex/Window.h>
@@ -30,8 +31,12 @@
 #include <pumex/FrameBuffer.h>
 #include <pumex/RenderGraphExecution.h>
 #include <pumex/MemoryImage.h>
+#include <pumex/Query.h>
+#include <pumex/RenderGraphCompiler.h>
 #include <pumex/utils/Log.h>
 #include <pumex/TimeStatistics.h>
+#include <pumex/TransientResourcePool.h>
+#include <pumex/Node.h>
 
 using namespace pumex;
 
@@ -291,10 +296,18 @@ void Surface::cleanup()
         frameBuffer->reset(this);
     }
     renderGraphData.clear();
+    validatedExecutables.clear();
+    disabledOperations.clear();
     for (auto& fence : waitFences)
       vkDestroyFence(dev, fence, nullptr);
     waitFences.clear();
 
+    for (auto& semaphores : queueDependencySemaphores)
+      for (auto& sem : semaphores.second)
+        vkDestroySemaphore(dev, sem.second, nullptr);
+    queueDependencySemaphores.clear();
+    operationTimers.clear();
+
     for (auto& semaphores : queueSubmissionCompletedSemaphores)
       for (auto sem : semaphores.second)
         vkDestroySemaphore(dev, sem, nullptr);
@@ -328,6 +341,8 @@ void Surface::recreateSwapChain()
   VkPhysicalDevice phDev = deviceSh->physical.lock()->physicalDevice;
 
   vkDeviceWaitIdle(vkDevice);
+  // resources released before this point are no longer used by GPU
+  deviceSh->getTransientResourcePool()->markDeviceIdle();
 
   VkSwapchainKHR oldSwapChain = swapChain;
 
@@ -371,6 +386,8 @@ void Surface::recreateSwapChain()
 
   CHECK_LOG_THROW( swapChainImageCount != 0 && newImageCount != swapChainImageCount, "Cannot change swapChainImageCount while working" );
   swapChainImageCount = newImageCount;
+  // each swapchain image may have its own frame in flight, and resources released during current frame may still be used by it
+  deviceSh->getTransientResourcePool()->setMinimumReuseDelay(swapChainImageCount + 1);
 
   if(presentCommandBuffer != nullptr)
     presentCommandBuffer->invalidate(std::numeric_limits<uint32_t>::max());
@@ -399,14 +416,19 @@ void Surface::validateRenderGraphs()
 {
   RenderContext renderContext(this, presentationQueueIndex);
   auto v = viewer.lock();
-  if (resized)
+  for (auto& rgData : renderGraphData)
   {
-    for (auto& rgData : renderGraphData)
+    auto renderGraphName = std::get<0>(rgData);
+    auto executable = v->getRenderGraphExecutable(renderGraphName);
+    if(executable == nullptr)
+      continue;
+    // enabled state may be changed by other threads - the same state must be used during whole frame
+    disabledOperations[renderGraphName] = executable->getDisabledOperations();
+    // render graph may have been replaced by Viewer::compileRenderGraph() - its images must be sized for this surface
+    auto& validated = validatedExecutables[renderGraphName];
+    if (resized || validated.lock() != executable)
     {
-      auto renderGraphName = std::get<0>(rgData);
-      auto executable = v->getRenderGraphExecutable(renderGraphName);
-      if(executable == nullptr)
-        continue;
+      validated = executable;
       executable->resizeImages(renderContext, swapChainImages);
       for (auto& frameBuffer : executable->frameBuffers)
       {
@@ -415,8 +437,8 @@ void Surface::validateRenderGraphs()
         frameBuffer->invalidate(renderContext);
       }
     }
-    resized = false;
   }
+  resized = false;
 
   for (auto& rgData : renderGraphData)
   {
@@ -537,6 +559,7 @@ void Surface::validatePrimaryDescriptors(uint32_t queueIndex)
       }
     }
   }
+  validateDescriptorVisitor.flush();
 }
 
 void Surface::buildPrimaryCommandBuffer(uint32_t queueIndex)
@@ -557,10 +580,26 @@ void Surface::buildPrimaryCommandBuffer(uint32_t queueIndex)
       if (qit->second[i] == queueIndex)
       {
         pcbit->second[i]->setActiveIndex(swapChainImageIndex);
+        OperationTimers* timers = measureOperationTimes ? prepareOperationTimers(renderGraphName, i, executable->commands[i]) : nullptr;
         pcbit->second[i]->cmdBegin();
+        const std::vector<TimedRange>* timedRanges = (timers != nullptr) ? &timers->timedRanges[swapChainImageIndex] : nullptr;
+        uint32_t firstQuery = (timers != nullptr) ? swapChainImageIndex * timers->queriesPerImage : 0;
+        if (timers != nullptr)
+          timers->queryPool->reset(this, pcbit->second[i], firstQuery, 2 * timedRanges->size());
         BuildCommandBufferVisitor cbVisitor(renderContext, pcbit->second[i].get(), true);
-        for (auto& command : executable->commands[i])
-          command->buildCommandBuffer(cbVisitor);
+        uint32_t rangeIndex = 0;
+        for (uint32_t j = 0; j < executable->commands[i].size(); ++j)
+        {
+          // timestamps are written before the first and after the last command of a range, so they never land inside a render pass
+          if (timers != nullptr && (*timedRanges)[rangeIndex].firstCommand == j)
+            timers->queryPool->queryTimeStamp(this, pcbit->second[i], firstQuery + 2 * rangeIndex, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+          executable->commands[i][j]->buildCommandBuffer(cbVisitor);
+          if (timers != nullptr && (*timedRanges)[rangeIndex].lastCommand == j)
+          {
+            timers->queryPool->queryTimeStamp(this, pcbit->second[i], firstQuery + 2 * rangeIndex + 1, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+            ++rangeIndex;
+          }
+        }
         pcbit->second[i]->cmdEnd();
       }
     }
@@ -617,6 +656,7 @@ void Surface::validateSecondaryDescriptors()
           renderContext.commandPool = secondaryCommandBufferNodes[i]->getSecondaryCommandPool(renderContext);
           ValidateDescriptorVisitor validateDescriptorVisitor(renderContext, false);
           secondaryCommandBufferNodes[i]->accept(validateDescriptorVisitor);
+          validateDescriptorVisitor.flush();
         }
       }
   );
@@ -650,7 +690,7 @@ void Surface::buildSecondaryCommandBuffers()
             if (secondaryCommandBufferRenderPasses[i] != VK_NULL_HANDLE)
               cbUsageFlags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
             commandBuffer->cmdBegin(cbUsageFlags, secondaryCommandBufferRenderPasses[i], secondaryCommandBufferSubPasses[i]);
-            secondaryCommandBufferNodes[i]->accept(cbVisitor);
+            cbVisitor.build(*secondaryCommandBufferNodes[i]);
             commandBuffer->cmdEnd();
           }
         }
@@ -660,49 +700,148 @@ void Surface::buildSecondaryCommandBuffers()
 
 void Surface::draw()
 {
-  std::vector<std::vector<CommandBuffer*>> commandBuffersToSubmit;
-  std::vector<std::vector<VkSemaphore>>    semaphoresToSubmit;
-  std::vector<VkSemaphore>                 submissionCompletedSemaphores;
+  std::vector<VkSemaphore> submissionCompletedSemaphores;
   auto v = viewer.lock();
-  // for each queue - collect all primary command buffers and "submission completed" semaphores in appropriate order
-  for (uint32_t queueIndex = 0; queueIndex < queues.size(); ++queueIndex)
+  // send command buffers to queues in an order respecting dependencies between queues of each render graph :
+  // - command buffers that do not depend on other queues must wait for imageAvailableSemaphore
+  // - command buffers that depend on other queues wait only for semaphores signaled by these queues
+  // - each command buffer submission ends with signaling appropriate semaphore
+  for (uint32_t rgIndex = 0; rgIndex < renderGraphData.size(); ++rgIndex)
   {
-    commandBuffersToSubmit.push_back(std::vector<CommandBuffer*>());
-    semaphoresToSubmit.push_back(std::vector<VkSemaphore>());
-    for (uint32_t rgIndex = 0; rgIndex<renderGraphData.size(); ++rgIndex)
+    auto renderGraphName = std::get<0>(renderGraphData[rgIndex]);
+    auto executable = v->getRenderGraphExecutable(renderGraphName);
+    if(executable == nullptr)
+      continue;
+    auto qit   = renderGraphQueueIndices.find(renderGraphName);
+    auto pcbit = primaryCommandBuffers.find(renderGraphName);
+    auto qcbit = queueSubmissionCompletedSemaphores.find(renderGraphName);
+    std::vector<std::set<uint32_t>> dependencies = executable->queueDependencies;
+    dependencies.resize(qit->second.size());
+
+    std::vector<bool> submitted(qit->second.size(), false);
+    uint32_t submittedCount = 0;
+    while (submittedCount < qit->second.size())
     {
-      auto renderGraphName = std::get<0>(renderGraphData[rgIndex]);
-      auto executable = v->getRenderGraphExecutable(renderGraphName);
-      if(executable == nullptr)
-        continue;
-      auto qit = renderGraphQueueIndices.find(renderGraphName);
-      auto pcbit = primaryCommandBuffers.find(renderGraphName);
-      auto qcbit = queueSubmissionCompletedSemaphores.find(renderGraphName);
+      uint32_t previousCount = submittedCount;
       for (uint32_t i = 0; i < qit->second.size(); ++i)
       {
-        if (qit->second[i] == queueIndex)
+        if (submitted[i] || std::any_of(begin(dependencies[i]), end(dependencies[i]), [&submitted](uint32_t d) { return !submitted[d]; }))
+          continue;
+        std::vector<VkSemaphore>          waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkSemaphore>          signalSemaphores{ qcbit->second[i] };
+        if (dependencies[i].empty())
         {
-          commandBuffersToSubmit.back().push_back(pcbit->second[i].get());
-          semaphoresToSubmit.back().push_back(qcbit->second[i]);
-          submissionCompletedSemaphores.push_back(qcbit->second[i]);
+          waitSemaphores.push_back(imageAvailableSemaphore);
+          waitStages.push_back(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
         }
+        for (auto d : dependencies[i])
+        {
+          waitSemaphores.push_back(getQueueDependencySemaphore(renderGraphName, d, i));
+          waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+        for (uint32_t j = 0; j < dependencies.size(); ++j)
+          if (dependencies[j].find(i) != end(dependencies[j]))
+            signalSemaphores.push_back(getQueueDependencySemaphore(renderGraphName, i, j));
+        pcbit->second[i]->queueSubmit(queues[qit->second[i]]->queue, waitSemaphores, waitStages, signalSemaphores, VK_NULL_HANDLE);
+        submissionCompletedSemaphores.push_back(qcbit->second[i]);
+        submitted[i] = true;
+        submittedCount++;
       }
+      CHECK_LOG_THROW(previousCount == submittedCount, "Circular dependency between queues in render graph : " << renderGraphName);
     }
   }
-  // send command buffers to queues:
-  // - all buffers must wait for imageAvailableSemaphore
-  // - each command buffer submission ends with signaling appropriate semaphore
-  for (uint32_t queueIndex = 0; queueIndex < queues.size(); ++queueIndex)
-  {
-    for (unsigned int i = 0; i < commandBuffersToSubmit[queueIndex].size(); ++i)
-      commandBuffersToSubmit[queueIndex][i]->queueSubmit(queues[queueIndex]->queue, { imageAvailableSemaphore }, { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT }, { semaphoresToSubmit[queueIndex][i] }, VK_NULL_HANDLE);
-  }
   // send to rendering a command buffer that transforms swapchain image layout into VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
   std::vector<VkPipelineStageFlags> waitStages;
   waitStages.resize(submissionCompletedSemaphores.size(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
   presentCommandBuffer->queueSubmit(queues[presentationQueueIndex]->queue, submissionCompletedSemaphores, waitStages, { renderFinishedSemaphore }, waitFences[swapChainImageIndex]);
 }
 
+VkSemaphore Surface::getQueueDependencySemaphore(const std::string& renderGraphName, uint32_t generatingQueue, uint32_t consumingQueue)
+{
+  auto& semaphores = queueDependencySemaphores[renderGraphName];
+  auto it = semaphores.find({ generatingQueue, consumingQueue });
+  if (it != end(semaphores))
+    return it->second;
+  VkSemaphoreCreateInfo semaphoreCreateInfo{};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  VkSemaphore semaphore;
+  VK_CHECK_LOG_THROW(vkCreateSemaphore(device.lock()->device, &semaphoreCreateInfo, nullptr, &semaphore), "Could not create queue dependency semaphore");
+  semaphores.insert({ { generatingQueue, consumingQueue }, semaphore });
+  return semaphore;
+}
+
+Surface::OperationTimers* Surface::prepareOperationTimers(const std::string& renderGraphName, uint32_t index, const std::vector<std::shared_ptr<RenderCommand>>& commands)
+{
+  auto v = viewer.lock();
+  auto costModel = v->getRenderGraphCostModel();
+  auto physicalDevice = device.lock()->physical.lock();
+  auto qit = renderGraphQueueIndices.find(renderGraphName);
+  if (commands.empty() || costModel == nullptr || physicalDevice->queueFamilyProperties[queues[qit->second[index]]->familyIndex].timestampValidBits == 0)
+    return nullptr;
+
+  OperationTimers* timers;
+  {
+    std::lock_guard<std::mutex> lock(operationTimersMutex);
+    auto tit = operationTimers.find(renderGraphName);
+    if (tit == end(operationTimers))
+      tit = operationTimers.insert({ renderGraphName, std::vector<OperationTimers>(qit->second.size()) }).first;
+    timers = &tit->second[index];
+  }
+  // group commands into ranges measured with a pair of timestamps : subpasses of one render pass form a single range
+  std::vector<TimedRange> ranges;
+  for (uint32_t j = 0; j < commands.size(); ++j)
+  {
+    bool continuesRenderPass = false;
+    if (!ranges.empty() && commands[j]->commandType == RenderCommand::ctRenderSubPass && commands[ranges.back().lastCommand]->commandType == RenderCommand::ctRenderSubPass)
+    {
+      auto previous = std::dynamic_pointer_cast<RenderSubPass>(commands[ranges.back().lastCommand]);
+      auto current  = std::dynamic_pointer_cast<RenderSubPass>(commands[j]);
+      continuesRenderPass = (previous->renderPass == current->renderPass) && (current->subpassIndex > 0);
+    }
+    if (continuesRenderPass)
+      ranges.back().lastCommand = j;
+    else
+      ranges.push_back(TimedRange{ j, j, std::vector<std::string>() });
+    ranges.back().operationNames.push_back(commands[j]->operation.name);
+  }
+
+  // replaced pools are released when all frames that could use them are finished ( their fences were waited for )
+  uint64_t currentEpoch = Node::getEpoch();
+  auto retiredEnd = std::remove_if(begin(timers->retiredQueryPools), end(timers->retiredQueryPools), [&](const RetiredQueryPool& rqp) { return rqp.epoch + swapChainImageCount + 1 <= currentEpoch; });
+  timers->retiredQueryPools.erase(retiredEnd, end(timers->retiredQueryPools));
+
+  uint32_t queriesRequired = 2 * ranges.size();
+  if (timers->queriesPerImage < queriesRequired)
+  {
+    if (timers->queryPool != nullptr)
+      timers->retiredQueryPools.push_back(RetiredQueryPool{ timers->queryPool, currentEpoch });
+    timers->queryPool = std::make_shared<QueryPool>(VK_QUERY_TYPE_TIMESTAMP, queriesRequired * swapChainImageCount);
+    timers->queryPool->validate(this);
+    timers->queriesPerImage = queriesRequired;
+    timers->timedRanges.assign(swapChainImageCount, std::vector<TimedRange>());
+  }
+
+  // collect results from the last frame that used this swapchain image ( its fence has been waited for in beginFrame() ).
+  // Primary command buffers are rebuilt every frame, so each frame delivers new samples
+  auto& timedRanges = timers->timedRanges[swapChainImageIndex];
+  if (!timedRanges.empty())
+  {
+    auto results = timers->queryPool->getResults(this, swapChainImageIndex * timers->queriesPerImage, 2 * timedRanges.size(), VK_QUERY_RESULT_64_BIT);
+    float timestampPeriod = physicalDevice->properties.limits.timestampPeriod;
+    for (uint32_t j = 0; j < timedRanges.size(); ++j)
+    {
+      if (results[2 * j + 1] <= results[2 * j])
+        continue;
+      float rangeTime = (results[2 * j + 1] - results[2 * j]) * timestampPeriod / 1000000.0f;
+      for (const auto& operationName : timedRanges[j].operationNames)
+        costModel->reportOperationTime(renderGraphName, operationName, rangeTime / timedRanges[j].operationNames.size());
+    }
+  }
+  timedRanges = ranges;
+  return timers;
+}
+
 void Surface::endFrame()
 {
   // present output image after its layout is transformed into VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
@@ -744,6 +883,35 @@ std::vector<uint32_t> Surface::getQueueIndices(const std::string renderGraphName
   return it->second;
 }
 
+bool Surface::isOperationEnabled(const std::string& renderGraphName, const std::string& operationName) const
+{
+  auto it = disabledOperations.find(renderGraphName);
+  if (it == end(disabledOperations))
+    return true;
+  return it->second.find(operationName) == end(it->second);
+}
+
+BindStatistics Surface::getBindStatistics() const
+{
+  BindStatistics result;
+  for (const auto& pcb : primaryCommandBuffers)
+  {
+    for (const auto& commandBuffer : pcb.second)
+    {
+      const auto& stats = commandBuffer->getBindStatistics();
+      result.pipelinesIssued       += stats.pipelinesIssued;
+      result.pipelinesSkipped      += stats.pipelinesSkipped;
+      result.descriptorSetsIssued  += stats.descriptorSetsIssued;
+      result.descriptorSetsSkipped += stats.descriptorSetsSkipped;
+      result.vertexBuffersIssued   += stats.vertexBuffersIssued;
+      result.vertexBuffersSkipped  += stats.vertexBuffersSkipped;
+      result.indexBuffersIssued    += stats.indexBuffersIssued;
+      result.indexBuffersSkipped   += stats.indexBuffersSkipped;
+    }
+  }
+  return result;
+}
+
 uint32_t Surface::getNumQueues() const
 {
   return queues.size();
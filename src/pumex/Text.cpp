@@ -191,8 +191,7 @@ void Text::cmdDraw(const RenderContext& renderContext, CommandBuffer* commandBuf
 
   commandBuffer->addSource(this);
   VkBuffer     vBuffer = vertexBuffer->getHandleBuffer(renderContext);
-  VkDeviceSize offsets = 0;
-  vkCmdBindVertexBuffers(commandBuffer->getHandle(), 0, 1, &vBuffer, &offsets);
+  commandBuffer->cmdBindVertexBuffer(0, vBuffer);
   commandBuffer->cmdDraw(sit->second->size(), 1, 0, 0, 0);
 }
 
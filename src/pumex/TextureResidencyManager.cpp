@@ -0,0 +1,255 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/TextureResidencyManager.h>
+#include <algorithm>
+#include <cstring>
+#include <pumex/Device.h>
+#include <pumex/PhysicalDevice.h>
+#include <pumex/DeviceMemoryAllocator.h>
+#include <pumex/MemoryImage.h>
+#include <pumex/Image.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+TextureResidencyManager::TextureEntry::TextureEntry(std::shared_ptr<MemoryImage> mi, std::shared_ptr<gli::texture> ft)
+  : memoryImage{ mi }, fullTexture{ ft }
+{
+}
+
+TextureResidencyManager::TextureResidencyManager(std::shared_ptr<DeviceMemoryAllocator> ta, VkDeviceSize mb, EvictionMode em)
+  : textureAllocator{ ta }, memoryBudget{ mb }, evictionMode{ em }
+{
+  CHECK_LOG_THROW(textureAllocator == nullptr, "TextureResidencyManager requires texture allocator");
+}
+
+TextureResidencyManager::~TextureResidencyManager()
+{
+}
+
+uint32_t TextureResidencyManager::registerTexture(std::shared_ptr<MemoryImage> memoryImage, std::shared_ptr<gli::texture> fullTexture)
+{
+  CHECK_LOG_THROW(memoryImage == nullptr || fullTexture == nullptr, "Cannot register empty texture in TextureResidencyManager");
+  CHECK_LOG_THROW(memoryImage->getAllocator() != textureAllocator, "Cannot register texture that uses different allocator than TextureResidencyManager");
+  std::lock_guard<std::mutex> lock(mutex);
+  textures.push_back(TextureEntry(memoryImage, fullTexture));
+  return textures.size() - 1;
+}
+
+void TextureResidencyManager::reportUsage(uint32_t textureID, unsigned long long frameNumber)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  CHECK_LOG_THROW(textureID >= textures.size(), "TextureResidencyManager : texture does not exist : " << textureID);
+  textures[textureID].lastUsedFrame = std::max(textures[textureID].lastUsedFrame, frameNumber);
+}
+
+void TextureResidencyManager::update(const std::vector<Device*>& devices, unsigned long long frameNumber)
+{
+  if (devices.empty())
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  // memory images are shared by all devices, so one decision is made for all of them : textures are evicted while any device
+  // is over its budget and restored only when restored texture fits within the budget of every device
+  std::vector<VkDeviceSize> residentSizes, budgets;
+  for (auto device : devices)
+  {
+    residentSizes.push_back(getResidentSizeNoLock(device));
+    budgets.push_back(computeMemoryBudget(device, residentSizes.back()));
+  }
+  auto overBudget = [&residentSizes, &budgets]()
+  {
+    for (uint32_t i = 0; i < residentSizes.size(); ++i)
+      if (residentSizes[i] > budgets[i])
+        return true;
+    return false;
+  };
+
+  std::vector<TextureEntry*> candidates;
+  uint32_t changes = 0;
+  if (overBudget())
+  {
+    // evict textures that were not used recently - least recently used go first
+    for (auto& entry : textures)
+    {
+      if (entry.lastUsedFrame + unusedFramesThreshold < frameNumber && entry.skippedLevels < getMaxSkippedLevels(entry) && !entry.memoryImage.expired())
+        candidates.push_back(&entry);
+    }
+    std::sort(begin(candidates), end(candidates), [](const TextureEntry* lhs, const TextureEntry* rhs) { return lhs->lastUsedFrame < rhs->lastUsedFrame; });
+    for (auto entry : candidates)
+    {
+      if (!overBudget() || changes >= maxChangesPerFrame)
+        break;
+      uint32_t skippedLevels = (evictionMode == EvictWholeTexture) ? getMaxSkippedLevels(*entry) : entry->skippedLevels + 1;
+      for (uint32_t i = 0; i < devices.size(); ++i)
+        residentSizes[i] -= getTextureSize(devices[i], *entry, entry->skippedLevels) - getTextureSize(devices[i], *entry, skippedLevels);
+      setSkippedLevels(*entry, skippedLevels);
+      changes++;
+    }
+  }
+  else
+  {
+    // restore textures that were used recently - most recently used go first
+    for (auto& entry : textures)
+    {
+      if (entry.lastUsedFrame + unusedFramesThreshold >= frameNumber && entry.skippedLevels > 0 && !entry.memoryImage.expired())
+        candidates.push_back(&entry);
+    }
+    std::sort(begin(candidates), end(candidates), [](const TextureEntry* lhs, const TextureEntry* rhs) { return lhs->lastUsedFrame > rhs->lastUsedFrame; });
+    for (auto entry : candidates)
+    {
+      if (changes >= maxChangesPerFrame)
+        break;
+      uint32_t skippedLevels = (evictionMode == EvictWholeTexture) ? 0 : entry->skippedLevels - 1;
+      std::vector<VkDeviceSize> growth;
+      bool fits = true;
+      for (uint32_t i = 0; i < devices.size(); ++i)
+      {
+        growth.push_back(getTextureSize(devices[i], *entry, skippedLevels) - getTextureSize(devices[i], *entry, entry->skippedLevels));
+        fits = fits && (residentSizes[i] + growth[i] <= budgets[i]);
+      }
+      if (!fits)
+        continue;
+      for (uint32_t i = 0; i < devices.size(); ++i)
+        residentSizes[i] += growth[i];
+      setSkippedLevels(*entry, skippedLevels);
+      changes++;
+    }
+  }
+}
+
+VkDeviceSize TextureResidencyManager::getMemoryBudget(Device* device) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return computeMemoryBudget(device, getResidentSizeNoLock(device));
+}
+
+VkDeviceSize TextureResidencyManager::getResidentSize(Device* device) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return getResidentSizeNoLock(device);
+}
+
+uint32_t TextureResidencyManager::getTextureCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return textures.size();
+}
+
+void TextureResidencyManager::setMemoryBudget(VkDeviceSize budget)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  memoryBudget = budget;
+}
+
+void TextureResidencyManager::setMaxChangesPerFrame(uint32_t changes)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  maxChangesPerFrame = changes;
+}
+
+void TextureResidencyManager::setUnusedFramesThreshold(uint32_t frames)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  unusedFramesThreshold = frames;
+}
+
+std::shared_ptr<gli::texture> TextureResidencyManager::createReducedTexture(const gli::texture& texture, uint32_t skippedLevels) const
+{
+  auto result = std::make_shared<gli::texture>(texture.target(), texture.format(), texture.extent(skippedLevels), texture.layers(), texture.faces(), texture.levels() - skippedLevels, texture.swizzles());
+  for (gli::texture::size_type layer = 0; layer < texture.layers(); ++layer)
+    for (gli::texture::size_type face = 0; face < texture.faces(); ++face)
+      for (gli::texture::size_type level = 0; level < result->levels(); ++level)
+        std::memcpy(result->data(layer, face, level), texture.data(layer, face, level + skippedLevels), texture.size(level + skippedLevels));
+  return result;
+}
+
+VkDeviceSize TextureResidencyManager::getTextureSize(Device* device, const TextureEntry& entry, uint32_t skippedLevels) const
+{
+  auto it = entry.memorySizes.find(device->device);
+  if (it == end(entry.memorySizes))
+  {
+    auto memoryImage        = entry.memoryImage.lock();
+    VkImageUsageFlags usage = (memoryImage != nullptr) ? memoryImage->getImageTraits().usage : VK_IMAGE_USAGE_SAMPLED_BIT;
+    ImageTraits traits      = getImageTraitsFromTexture(*entry.fullTexture, usage);
+    std::vector<VkDeviceSize> sizes;
+    for (gli::texture::size_type level = 0; level < entry.fullTexture->levels(); ++level)
+    {
+      auto extent                = entry.fullTexture->extent(level);
+      traits.imageSize.size      = glm::vec3(extent.x, extent.y, extent.z);
+      traits.imageSize.mipLevels = entry.fullTexture->levels() - level;
+      sizes.push_back(getImageMemoryRequirements(device, traits).size);
+    }
+    it = entry.memorySizes.insert({ device->device, sizes }).first;
+  }
+  return it->second[skippedLevels];
+}
+
+VkDeviceSize TextureResidencyManager::getResidentSizeNoLock(Device* device) const
+{
+  VkDeviceSize residentSize = 0;
+  for (const auto& entry : textures)
+    residentSize += getTextureSize(device, entry, entry.skippedLevels);
+  return residentSize;
+}
+
+uint32_t TextureResidencyManager::getMaxSkippedLevels(const TextureEntry& entry) const
+{
+  return entry.fullTexture->levels() - 1;
+}
+
+void TextureResidencyManager::setSkippedLevels(TextureEntry& entry, uint32_t skippedLevels)
+{
+  auto memoryImage = entry.memoryImage.lock();
+  if (memoryImage == nullptr)
+    return;
+  memoryImage->setTexture( (skippedLevels == 0) ? entry.fullTexture : createReducedTexture(*entry.fullTexture, skippedLevels) );
+  entry.skippedLevels = skippedLevels;
+}
+
+VkDeviceSize TextureResidencyManager::computeMemoryBudget(Device* device, VkDeviceSize residentSize) const
+{
+  VkDeviceSize allocatorSize = textureAllocator->getMemorySize();
+  VkDeviceSize budget        = (memoryBudget > 0) ? memoryBudget : allocatorSize;
+
+  // memory in allocator used by objects other than managed textures is not available
+  DeviceMemoryStatistics statistics = textureAllocator->getStatistics(device->device);
+  VkDeviceSize otherObjectsSize = (statistics.usedSize > residentSize) ? statistics.usedSize - residentSize : 0;
+  budget = std::min(budget, (allocatorSize > otherObjectsSize) ? allocatorSize - otherObjectsSize : 0);
+
+  // when driver reports that we use more memory than it is available on heap - we must decrease the budget
+  auto physicalDevice = device->physical.lock();
+  std::vector<VkDeviceSize> heapBudget, heapUsage;
+  if (device->enableMemoryBudget && physicalDevice != nullptr && physicalDevice->getMemoryBudget(heapBudget, heapUsage))
+  {
+    bool deviceLocal = (textureAllocator->getMemoryPropertyFlags() & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkDeviceSize overBudget = 0;
+    for (uint32_t i = 0; i < heapBudget.size(); ++i)
+    {
+      bool heapDeviceLocal = (physicalDevice->memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+      if (heapDeviceLocal == deviceLocal && heapUsage[i] > heapBudget[i])
+        overBudget += heapUsage[i] - heapBudget[i];
+    }
+    budget = (budget > overBudget) ? budget - overBudget : 0;
+  }
+  return budget;
+}
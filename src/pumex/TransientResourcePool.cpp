@@ -0,0 +1,212 @@
+//
+// Copyright(c) 2017-2018 Pawe Ksiopolski ( pumexx )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <pumex/TransientResourcePool.h>
+#include <algorithm>
+#include <iterator>
+#include <pumex/Device.h>
+#include <pumex/Image.h>
+#include <pumex/DeviceMemoryAllocator.h>
+#include <pumex/utils/Log.h>
+
+using namespace pumex;
+
+bool sameImageTraits(const ImageTraits& lhs, const ImageTraits& rhs)
+{
+  return lhs.format == rhs.format &&
+    lhs.imageSize     == rhs.imageSize &&
+    lhs.usage         == rhs.usage &&
+    lhs.linearTiling  == rhs.linearTiling &&
+    lhs.initialLayout == rhs.initialLayout &&
+    lhs.imageCreate   == rhs.imageCreate &&
+    lhs.imageType     == rhs.imageType &&
+    lhs.sharingMode   == rhs.sharingMode;
+}
+
+TransientResourcePool::TransientResourcePool(Device* d, uint32_t rd, uint32_t muf)
+  : device{ d }, reuseDelay{ rd }, maxUnusedFrames{ muf }
+{
+  CHECK_LOG_THROW(device == nullptr, "TransientResourcePool : device not defined");
+}
+
+TransientResourcePool::~TransientResourcePool()
+{
+  clear();
+}
+
+std::shared_ptr<Image> TransientResourcePool::acquireImage(const ImageTraits& imageTraits, std::shared_ptr<DeviceMemoryAllocator> allocator)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& entry : images)
+  {
+    if (entry.image.use_count() > 1 || !isReusable(entry.lastUsedFrame, entry.reusable))
+      continue;
+    if (entry.allocator != allocator || !sameImageTraits(entry.image->getImageTraits(), imageTraits))
+      continue;
+    entry.lastUsedFrame = frameNumber;
+    entry.reusable      = false;
+    statistics.hitCount++;
+    return entry.image;
+  }
+  ImageEntry entry{ std::make_shared<Image>(device, imageTraits, allocator), allocator, frameNumber, false };
+  images.push_back(entry);
+  statistics.missCount++;
+  return entry.image;
+}
+
+std::shared_ptr<SharedMemoryBlock> TransientResourcePool::acquireMemoryBlock(std::shared_ptr<DeviceMemoryAllocator> allocator, const VkMemoryRequirements& memoryRequirements)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  MemoryBlockEntry* bestEntry = nullptr;
+  for (auto& entry : memoryBlocks)
+  {
+    if (entry.memoryBlock.use_count() > 1 || !isReusable(entry.lastUsedFrame, entry.reusable))
+      continue;
+    if (entry.allocator != allocator)
+      continue;
+    // memory type chosen for the block must be acceptable for new requirements, offset of the block must be aligned
+    if ((entry.memoryRequirements.memoryTypeBits & memoryRequirements.memoryTypeBits) != entry.memoryRequirements.memoryTypeBits)
+      continue;
+    if (entry.memoryRequirements.alignment % memoryRequirements.alignment != 0)
+      continue;
+    // do not waste memory on blocks that are much larger than requested
+    VkDeviceSize blockSize = entry.memoryBlock->getMemoryBlock().alignedSize;
+    if (blockSize < memoryRequirements.size || blockSize > 2 * memoryRequirements.size)
+      continue;
+    if (bestEntry == nullptr || blockSize < bestEntry->memoryBlock->getMemoryBlock().alignedSize)
+      bestEntry = &entry;
+  }
+  if (bestEntry != nullptr)
+  {
+    bestEntry->lastUsedFrame = frameNumber;
+    bestEntry->reusable      = false;
+    statistics.hitCount++;
+    return bestEntry->memoryBlock;
+  }
+  MemoryBlockEntry entry{ std::make_shared<SharedMemoryBlock>(device, allocator, memoryRequirements), allocator, memoryRequirements, frameNumber, false };
+  memoryBlocks.push_back(entry);
+  statistics.missCount++;
+  return entry.memoryBlock;
+}
+
+void TransientResourcePool::update(unsigned long long fn)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  frameNumber = fn;
+  for (auto& entry : images)
+  {
+    if (entry.image.use_count() > 1)
+    {
+      entry.lastUsedFrame = frameNumber;
+      entry.reusable      = false;
+    }
+  }
+  for (auto& entry : memoryBlocks)
+  {
+    if (entry.memoryBlock.use_count() > 1)
+    {
+      entry.lastUsedFrame = frameNumber;
+      entry.reusable      = false;
+    }
+  }
+  auto imagesEnd = std::remove_if(begin(images), end(images), [this](const ImageEntry& entry) { return entry.image.use_count() == 1 && frameNumber > entry.lastUsedFrame + maxUnusedFrames; });
+  statistics.trimCount += std::distance(imagesEnd, end(images));
+  images.erase(imagesEnd, end(images));
+  auto blocksEnd = std::remove_if(begin(memoryBlocks), end(memoryBlocks), [this](const MemoryBlockEntry& entry) { return entry.memoryBlock.use_count() == 1 && frameNumber > entry.lastUsedFrame + maxUnusedFrames; });
+  statistics.trimCount += std::distance(blocksEnd, end(memoryBlocks));
+  memoryBlocks.erase(blocksEnd, end(memoryBlocks));
+}
+
+void TransientResourcePool::markDeviceIdle()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& entry : images)
+    if (entry.image.use_count() == 1)
+      entry.reusable = true;
+  for (auto& entry : memoryBlocks)
+    if (entry.memoryBlock.use_count() == 1)
+      entry.reusable = true;
+}
+
+void TransientResourcePool::trim()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto imagesEnd = std::remove_if(begin(images), end(images), [](const ImageEntry& entry) { return entry.image.use_count() == 1; });
+  statistics.trimCount += std::distance(imagesEnd, end(images));
+  images.erase(imagesEnd, end(images));
+  auto blocksEnd = std::remove_if(begin(memoryBlocks), end(memoryBlocks), [](const MemoryBlockEntry& entry) { return entry.memoryBlock.use_count() == 1; });
+  statistics.trimCount += std::distance(blocksEnd, end(memoryBlocks));
+  memoryBlocks.erase(blocksEnd, end(memoryBlocks));
+}
+
+void TransientResourcePool::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  images.clear();
+  memoryBlocks.clear();
+}
+
+void TransientResourcePool::setReuseDelay(uint32_t frames)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  reuseDelay = frames;
+}
+
+void TransientResourcePool::setMinimumReuseDelay(uint32_t frames)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  reuseDelay = std::max(reuseDelay, frames);
+}
+
+void TransientResourcePool::setMaxUnusedFrames(uint32_t frames)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  maxUnusedFrames = frames;
+}
+
+TransientResourceStatistics TransientResourcePool::getStatistics() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  TransientResourceStatistics result = statistics;
+  result.imageCount       = images.size();
+  result.memoryBlockCount = memoryBlocks.size();
+  for (const auto& entry : images)
+  {
+    if (entry.image.use_count() > 1)
+      continue;
+    result.freeImageCount++;
+    result.freeMemorySize += entry.image->getMemorySize();
+  }
+  for (const auto& entry : memoryBlocks)
+  {
+    if (entry.memoryBlock.use_count() > 1)
+      continue;
+    result.freeMemoryBlockCount++;
+    result.freeMemorySize += entry.memoryBlock->getMemoryBlock().alignedSize;
+  }
+  return result;
+}
+
+bool TransientResourcePool::isReusable(unsigned long long lastUsedFrame, bool reusable) const
+{
+  return reusable || frameNumber >= lastUsedFrame + reuseDelay;
+}
@@ -30,8 +30,12 @@
 #include <pumex/Device.h>
 #include <pumex/Window.h>
 #include <pumex/Surface.h>
+#include <pumex/Node.h>
 #include <pumex/RenderGraphCompiler.h>
 #include <pumex/TimeStatistics.h>
+#include <pumex/TransientResourcePool.h>
+#include <pumex/TextureResidencyManager.h>
+#include <pumex/MaterialSet.h>
 #include <pumex/InputEvent.h>
 #include <pumex/Asset.h>
 #include <pumex/Image.h>
@@ -74,6 +78,7 @@ Viewer::Viewer(const ViewerTraits& vt)
 {
   externalMemoryObjects = std::make_shared<ExternalMemoryObjects>();
   renderGraphCompiler = std::dynamic_pointer_cast<RenderGraphCompiler>(std::make_shared<DefaultRenderGraphCompiler>());
+  renderGraphCostModel = std::make_shared<RenderGraphCostModel>();
   viewerStartTime     = HPClock::now();
 
   for(uint32_t i=0; i<3;++i)
@@ -83,13 +88,14 @@ Viewer::Viewer(const ViewerTraits& vt)
   timeStatistics->registerGroup(TSV_GROUP_UPDATE, L"Update operations");
   timeStatistics->registerGroup(TSV_GROUP_RENDER, L"Render operation");
   timeStatistics->registerGroup(TSV_GROUP_RENDER_EVENTS, L"Render events");
+  timeStatistics->registerGroup(TSV_GROUP_MEMORY, L"Memory");
   timeStatistics->registerChannel(TSV_CHANNEL_INPUTEVENTS,         TSV_GROUP_UPDATE,        L"Input events",               glm::vec4(0.8f, 0.8f, 0.1f, 0.5f));
   timeStatistics->registerChannel(TSV_CHANNEL_UPDATE,              TSV_GROUP_UPDATE,        L"Full update",                glm::vec4(0.8f, 0.1f, 0.1f, 0.5f));
   timeStatistics->registerChannel(TSV_CHANNEL_RENDER,              TSV_GROUP_RENDER,        L"Full render",                glm::vec4(0.1f, 0.1f, 0.8f, 0.5f));
   timeStatistics->registerChannel(TSV_CHANNEL_FRAME,               TSV_GROUP_RENDER,        L"Frame time",                 glm::vec4(0.5f, 0.5f, 0.5f, 0.5f));
   timeStatistics->registerChannel(TSV_CHANNEL_EVENT_RENDER_START,  TSV_GROUP_RENDER_EVENTS, L"Viewer event render start",  glm::vec4(0.8f, 0.8f, 0.1f, 0.5f));
   timeStatistics->registerChannel(TSV_CHANNEL_EVENT_RENDER_FINISH, TSV_GROUP_RENDER_EVENTS, L"Viewer event render finish", glm::vec4(0.8f, 0.1f, 0.1f, 0.5f));
-  timeStatistics->setFlags(TSV_STAT_UPDATE | TSV_STAT_RENDER | TSV_STAT_RENDER_EVENTS);
+  timeStatistics->setFlags(TSV_STAT_UPDATE | TSV_STAT_RENDER | TSV_STAT_RENDER_EVENTS | TSV_STAT_MEMORY);
 
   // Register basic directories - directories listed in PUMEX_DATA_DIR environment variable, separated by colon or semicolon
   // This step is kipped on Android because current NDK(r18) does not have std::filesystem implemented ( even in experimental form )
@@ -275,6 +281,12 @@ void Viewer::run()
       try
       {
         frameNumber++;
+        Node::advanceEpoch();
+        for (auto& d : devices)
+          if (d.second->isRealized())
+            d.second->getTransientResourcePool()->update(frameNumber);
+        updateTextureResidency();
+        updateTextureRegistries();
         renderContinueRun = !terminating();
         if (renderContinueRun)
         {
@@ -295,6 +307,8 @@ void Viewer::run()
         timeStatistics->setValues(TSV_CHANNEL_RENDER, inSeconds(renderStartTime - viewerStartTime), inSeconds(renderEndTime - renderStartTime));
         timeStatistics->setValues(TSV_CHANNEL_FRAME, inSeconds(prevRenderStartTime - viewerStartTime), inSeconds(renderStartTime - prevRenderStartTime));
       }
+      if (timeStatistics->hasFlags(TSV_STAT_MEMORY))
+        collectMemoryStatistics();
 
       if (!renderContinueRun || !updateContinueRun)
       {
@@ -387,9 +401,18 @@ void Viewer::cleanup()
   eventRenderFinish = nullptr;
   updateGraph.reset();
   executionFlowGraph.reset();
-  renderGraphs.clear();
+  {
+    std::lock_guard<std::mutex> lock(renderGraphMutex);
+    renderGraphs.clear();
+    renderGraphCache.clear();
+  }
   externalMemoryObjects = nullptr;
   frameBufferAllocator = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+    deviceMemoryAllocators.clear();
+    textureResidencyManagers.clear();
+  }
   if (instance != VK_NULL_HANDLE)
   {
     if (isRealized())
@@ -504,23 +527,198 @@ void Viewer::compileRenderGraph(std::shared_ptr<RenderGraph> renderGraph, const
 {
 //  auto tickStart = HPClock::now();
   renderGraph->addMissingResourceTransitions();
-  std::shared_ptr<RenderGraphExecutable> executable = renderGraphCompiler->compile(*renderGraph, *externalMemoryObjects, qt, frameBufferAllocator);
-  renderGraphs.insert({ renderGraph->name, executable });
-  queueTraits.insert({ renderGraph->name, qt });
+  auto key = renderGraphStructuralKey(*renderGraph, *externalMemoryObjects, qt);
+  std::shared_ptr<RenderGraphExecutable> executable;
+  {
+    std::lock_guard<std::mutex> lock(renderGraphMutex);
+    auto cit = renderGraphCache.find(key);
+    if (cit != end(renderGraphCache) && cit->second.first->frameBufferAllocator == frameBufferAllocator)
+    {
+      executable         = cit->second.first;
+      cit->second.second = ++renderGraphCacheTime;
+    }
+  }
+  // render graphs that differ only in enabled operations share the same executable
+  if (executable != nullptr)
+  {
+    auto changedOperations = executable->updateOperationsEnabled(*renderGraph);
+    for (const auto& opName : changedOperations)
+      LOG_INFO << "Render graph " << renderGraph->name << " : operation " << opName << (renderGraph->getRenderOperation(opName).enabled ? " enabled" : " disabled") << std::endl;
+  }
+  if (executable == nullptr)
+  {
+    executable = renderGraphCompiler->compile(*renderGraph, *externalMemoryObjects, qt, frameBufferAllocator, renderGraphCostModel);
+    std::lock_guard<std::mutex> lock(renderGraphMutex);
+    renderGraphCache[key] = { executable, ++renderGraphCacheTime };
+    trimRenderGraphCache();
+  }
+  std::lock_guard<std::mutex> lock(renderGraphMutex);
+  renderGraphs[renderGraph->name] = executable;
+  queueTraits[renderGraph->name]  = qt;
 //  auto tickEnd = HPClock::now();
 //  LOG_ERROR << "Compilation of render graph " << renderGraph->name << " took " << 1000.0f * inSeconds(tickEnd - tickStart) << " ms " <<std::endl;
 }
 
+void Viewer::setFrameBufferAllocator(std::shared_ptr<DeviceMemoryAllocator> fba)
+{
+  frameBufferAllocator = fba;
+  if (frameBufferAllocator != nullptr)
+    registerDeviceMemoryAllocator(frameBufferAllocator);
+}
+
+void Viewer::registerDeviceMemoryAllocator(std::shared_ptr<DeviceMemoryAllocator> allocator)
+{
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  auto it = std::find_if(begin(deviceMemoryAllocators), end(deviceMemoryAllocators), [&allocator](const std::pair<std::weak_ptr<DeviceMemoryAllocator>, uint32_t>& a) { return a.first.lock() == allocator; });
+  if (it != end(deviceMemoryAllocators))
+    return;
+  uint32_t channelID = nextMemoryChannelID++;
+  std::wstring channelName(begin(allocator->getName()), end(allocator->getName()));
+  timeStatistics->registerChannel(channelID, TSV_GROUP_MEMORY, channelName, glm::vec4(0.1f, 0.8f, 0.1f, 0.5f));
+  deviceMemoryAllocators.push_back({ allocator, channelID });
+}
+
+void Viewer::unregisterDeviceMemoryAllocator(std::shared_ptr<DeviceMemoryAllocator> allocator)
+{
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  auto it = std::find_if(begin(deviceMemoryAllocators), end(deviceMemoryAllocators), [&allocator](const std::pair<std::weak_ptr<DeviceMemoryAllocator>, uint32_t>& a) { return a.first.lock() == allocator; });
+  CHECK_LOG_RETURN_VOID(it == end(deviceMemoryAllocators), "Viewer::unregisterDeviceMemoryAllocator() : allocator was not registered : " << allocator->getName());
+  timeStatistics->unregisterChannel(it->second);
+  deviceMemoryAllocators.erase(it);
+}
+
+void Viewer::addTextureResidencyManager(std::shared_ptr<TextureResidencyManager> residencyManager)
+{
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  auto it = std::find_if(begin(textureResidencyManagers), end(textureResidencyManagers), [&residencyManager](const std::weak_ptr<TextureResidencyManager>& rm) { return rm.lock() == residencyManager; });
+  if (it != end(textureResidencyManagers))
+    return;
+  textureResidencyManagers.push_back(residencyManager);
+}
+
+void Viewer::removeTextureResidencyManager(std::shared_ptr<TextureResidencyManager> residencyManager)
+{
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  auto it = std::find_if(begin(textureResidencyManagers), end(textureResidencyManagers), [&residencyManager](const std::weak_ptr<TextureResidencyManager>& rm) { return rm.lock() == residencyManager; });
+  CHECK_LOG_RETURN_VOID(it == end(textureResidencyManagers), "Viewer::removeTextureResidencyManager() : residency manager was not registered");
+  textureResidencyManagers.erase(it);
+}
+
+void Viewer::updateTextureResidency()
+{
+  std::vector<std::shared_ptr<TextureResidencyManager>> managers;
+  {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+    for (auto it = begin(textureResidencyManagers); it != end(textureResidencyManagers); )
+    {
+      auto rm = it->lock();
+      if (rm == nullptr)
+      {
+        it = textureResidencyManagers.erase(it);
+        continue;
+      }
+      managers.push_back(rm);
+      ++it;
+    }
+  }
+  // memory images modified by residency managers are validated later in this frame
+  std::vector<Device*> realizedDevices;
+  for (auto& d : devices)
+    if (d.second->isRealized())
+      realizedDevices.push_back(d.second.get());
+  for (auto& rm : managers)
+    rm->update(realizedDevices, frameNumber);
+}
+
+void Viewer::addTextureRegistry(std::shared_ptr<TextureRegistryBase> textureRegistry)
+{
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  auto it = std::find_if(begin(textureRegistries), end(textureRegistries), [&textureRegistry](const std::weak_ptr<TextureRegistryBase>& tr) { return tr.lock() == textureRegistry; });
+  if (it != end(textureRegistries))
+    return;
+  textureRegistries.push_back(textureRegistry);
+}
+
+void Viewer::updateTextureRegistries()
+{
+  std::vector<std::shared_ptr<TextureRegistryBase>> registries;
+  {
+    std::lock_guard<std::mutex> lock(allocatorMutex);
+    for (auto it = begin(textureRegistries); it != end(textureRegistries); )
+    {
+      auto tr = it->lock();
+      if (tr == nullptr)
+      {
+        it = textureRegistries.erase(it);
+        continue;
+      }
+      registries.push_back(tr);
+      ++it;
+    }
+  }
+  for (auto& tr : registries)
+    tr->update(frameNumber);
+}
+
+std::vector<std::shared_ptr<DeviceMemoryAllocator>> Viewer::getDeviceMemoryAllocators() const
+{
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  std::vector<std::shared_ptr<DeviceMemoryAllocator>> result;
+  for (const auto& a : deviceMemoryAllocators)
+  {
+    auto allocator = a.first.lock();
+    if (allocator != nullptr)
+      result.push_back(allocator);
+  }
+  return result;
+}
+
+DeviceMemoryStatistics Viewer::getDeviceMemoryStatistics(uint32_t deviceID) const
+{
+  DeviceMemoryStatistics result;
+  auto it = devices.find(deviceID);
+  if (it == end(devices) || !it->second->isRealized())
+    return result;
+  for (auto& allocator : getDeviceMemoryAllocators())
+    result += allocator->getStatistics(it->second->device);
+  return result;
+}
+
 std::shared_ptr<RenderGraphExecutable> Viewer::getRenderGraphExecutable(const std::string& name) const
 {
+  std::lock_guard<std::mutex> lock(renderGraphMutex);
   auto it = renderGraphs.find(name);
   if(it == end(renderGraphs))
       return std::shared_ptr<RenderGraphExecutable>();
   return it->second;
 }
 
-const std::vector<QueueTraits>& Viewer::getRenderGraphQueueTraits(const std::string& name) const
+void Viewer::clearRenderGraphCache()
+{
+  std::lock_guard<std::mutex> lock(renderGraphMutex);
+  renderGraphCache.clear();
+}
+
+void Viewer::setRenderGraphCacheSize(uint32_t cacheSize)
+{
+  std::lock_guard<std::mutex> lock(renderGraphMutex);
+  renderGraphCacheSize = cacheSize;
+  trimRenderGraphCache();
+}
+
+void Viewer::trimRenderGraphCache()
+{
+  // render graphs in use are kept alive by renderGraphs, so removing them from cache only forces recompilation when they are needed again
+  while (renderGraphCache.size() > renderGraphCacheSize)
+  {
+    auto oldest = std::min_element(begin(renderGraphCache), end(renderGraphCache), [](const decltype(renderGraphCache)::value_type& lhs, const decltype(renderGraphCache)::value_type& rhs) { return lhs.second.second < rhs.second.second; });
+    renderGraphCache.erase(oldest);
+  }
+}
+
+std::vector<QueueTraits> Viewer::getRenderGraphQueueTraits(const std::string& name) const
 {
+  std::lock_guard<std::mutex> lock(renderGraphMutex);
   auto it = queueTraits.find(name);
   CHECK_LOG_THROW(it == end(queueTraits), "Viewer does not have registered queue traits for render graph : " << name);
   return it->second;
@@ -668,6 +866,7 @@ void Viewer::loadExtensionFunctions()
     {
       pfn_vkGetPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
       pfn_vkGetPhysicalDeviceFeatures2   = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>  (vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+      pfn_vkGetPhysicalDeviceMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2"));
     }
   }
 }
@@ -1062,6 +1261,25 @@ void Viewer::buildExecutionFlowGraph()
   }
 }
 
+void Viewer::collectMemoryStatistics()
+{
+  double currentTime = inSeconds(renderStartTime - viewerStartTime);
+  std::lock_guard<std::mutex> lock(allocatorMutex);
+  for (auto it = begin(deviceMemoryAllocators); it != end(deviceMemoryAllocators); )
+  {
+    auto allocator = it->first.lock();
+    // allocator was destroyed by the user - remove it from registry
+    if (allocator == nullptr)
+    {
+      timeStatistics->unregisterChannel(it->second);
+      it = deviceMemoryAllocators.erase(it);
+      continue;
+    }
+    timeStatistics->setValues(it->second, currentTime, static_cast<double>(allocator->getStatistics().usedSize));
+    ++it;
+  }
+}
+
 // put a breakpoint inside this function if you want to see what code generated layer error
 VkBool32 pumex::messageCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType, uint64_t srcObject, size_t location, int32_t msgCode, const char* pLayerPrefix, const char* pMsg, void* pUserData)
 {
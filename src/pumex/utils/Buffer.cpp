@@ -168,10 +168,97 @@ void StagingBuffer::unmapMemory()
   vkUnmapMemory(device, memory);
 }
 
+StagingRingBuffer::StagingRingBuffer(Device* d, VkDeviceSize s)
+  : device{ d->device }
+{
+  memorySize = createBuffer(d, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, s, &buffer, &memory);
+  CHECK_LOG_THROW(memorySize == 0, "Cannot create staging ring buffer");
+  // memory may be larger than requested buffer size
+  memorySize = s;
+  void *mapAddress;
+  VK_CHECK_LOG_THROW(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapAddress), "Cannot map memory");
+  mappedData = static_cast<unsigned char*>(mapAddress);
+}
+
+StagingRingBuffer::~StagingRingBuffer()
+{
+  vkUnmapMemory(device, memory);
+  destroyBuffer(device, buffer, memory);
+}
+
+bool StagingRingBuffer::allocate(const void* owner, VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation)
+{
+  reclaim();
+  if (size == 0 || size > memorySize)
+    return false;
+
+  VkDeviceSize offset;
+  if (regions.empty())
+  {
+    offset = 0;
+  }
+  else
+  {
+    VkDeviceSize tail = regions.front().begin;
+    // regions are wrapped when the newest region lies before the oldest one
+    bool wrapped      = regions.back().begin < tail;
+    offset            = ((head + alignment - 1) / alignment) * alignment;
+    if (wrapped)
+    {
+      if (offset + size > tail)
+        return false;
+    }
+    else if (offset + size > memorySize)
+    {
+      // not enough space at the end of the ring - wrap around
+      if (size > tail)
+        return false;
+      offset = 0;
+    }
+  }
+  regions.push_back({ owner, offset, offset + size, false });
+  head = offset + size;
+  used += size;
+
+  allocation.buffer         = buffer;
+  allocation.offset         = offset;
+  allocation.size           = size;
+  allocation.mappedData     = mappedData + offset;
+  allocation.overflowBuffer = nullptr;
+  return true;
+}
+
+void StagingRingBuffer::release(const void* owner)
+{
+  for (auto& region : regions)
+    if (region.owner == owner)
+      region.released = true;
+  reclaim();
+}
+
+bool StagingRingBuffer::hasPendingAllocations(const void* owner) const
+{
+  for (const auto& region : regions)
+    if (!region.released && region.owner != owner)
+      return true;
+  return false;
+}
+
+void StagingRingBuffer::reclaim()
+{
+  while (!regions.empty() && regions.front().released)
+  {
+    used -= regions.front().end - regions.front().begin;
+    regions.pop_front();
+  }
+  if (regions.empty())
+    head = 0;
+}
 
 
 
 
 
 
-}
+
+}